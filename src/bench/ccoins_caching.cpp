@@ -3,10 +3,13 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <arith_uint256.h>
 #include <coins.h>
 #include <policy/policy.h>
 #include <script/signingprovider.h>
+#include <script/standard.h>
 
+#include <iostream>
 #include <vector>
 
 // FIXME: Dedup with SetupDummyInputs in test/transaction_tests.cpp.
@@ -86,3 +89,70 @@ static void CCoinsCaching(benchmark::State& state)
 }
 
 BENCHMARK(CCoinsCaching, 170 * 1000);
+
+// Number of coins in the cache of the insert and lookup benchmarks
+static const uint32_t CACHE_BENCH_COINS = 100000;
+
+static std::vector<COutPoint> MakeOutPoints()
+{
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(CACHE_BENCH_COINS);
+    for (uint32_t i = 0; i < CACHE_BENCH_COINS; i++) {
+        outpoints.emplace_back(ArithToUint256(arith_uint256(i + 1)), i % 3);
+    }
+    return outpoints;
+}
+
+static Coin MakeCoin()
+{
+    // A P2PKH output, the script fits into the inline storage of CScript as for most coins
+    return Coin(CTxOut(COIN, GetScriptForDestination(PKHash(CKeyID()))), 1, false, false);
+}
+
+// Add coins to an empty cache, as block connection does, and report how many coins fit into a GiB of -dbcache
+// according to the cache's (pool based) memory accounting.
+static void CCoinsCacheInsert(benchmark::State& state)
+{
+    CCoinsView coinsDummy;
+    const std::vector<COutPoint> outpoints = MakeOutPoints();
+    const Coin coin = MakeCoin();
+
+    size_t nUsage = 0;
+    while (state.KeepRunning()) {
+        CCoinsViewCache cache(&coinsDummy);
+        for (const COutPoint& outpoint : outpoints) {
+            cache.AddCoin(outpoint, Coin(coin), false);
+        }
+        nUsage = cache.DynamicMemoryUsage();
+    }
+
+    static bool fReported = false;
+    if (!fReported) {
+        std::cerr << "# " << state.m_name << ": " << (uint64_t)CACHE_BENCH_COINS * (1 << 30) / nUsage
+                  << " coins per GiB of coins cache (" << nUsage / CACHE_BENCH_COINS << " bytes per coin)" << std::endl;
+        fReported = true;
+    }
+}
+
+// Look up coins in a populated cache, half of them hits and half misses
+static void CCoinsCacheLookup(benchmark::State& state)
+{
+    CCoinsView coinsDummy;
+    CCoinsViewCache cache(&coinsDummy);
+    const std::vector<COutPoint> outpoints = MakeOutPoints();
+    const Coin coin = MakeCoin();
+    for (uint32_t i = 0; i < CACHE_BENCH_COINS; i += 2) {
+        cache.AddCoin(outpoints[i], Coin(coin), false);
+    }
+
+    while (state.KeepRunning()) {
+        size_t nFound = 0;
+        for (const COutPoint& outpoint : outpoints) {
+            nFound += !cache.AccessCoin(outpoint).IsSpent();
+        }
+        assert(nFound == CACHE_BENCH_COINS / 2);
+    }
+}
+
+BENCHMARK(CCoinsCacheInsert, 10);
+BENCHMARK(CCoinsCacheLookup, 20);
@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 #include <util/system.h>
 #include <checkqueue.h>
+#include <crypto/sha256.h>
 #include <prevector.h>
 #include <vector>
 #include <boost/thread/thread.hpp>
@@ -59,3 +60,54 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     tg.join_all();
 }
 BENCHMARK(CCheckQueueSpeedPrevectorJob, 1400);
+
+// A job with a small amount of real work, so that the scaling benchmarks below
+// show the cost of distributing the work rather than only the cost of the queue.
+struct HashJob {
+    unsigned char data[CSHA256::OUTPUT_SIZE] = {};
+    bool operator()()
+    {
+        for (int i = 0; i < 8; i++) {
+            CSHA256().Write(data, sizeof(data)).Finalize(data);
+        }
+        return true;
+    }
+    void swap(HashJob& x) { std::swap(data, x.data); }
+};
+
+// Verify a block worth of jobs with a given number of threads (including the
+// master), to show how the queue scales with the number of cores.
+static void CCheckQueueScaling(benchmark::State& state, int nThreads)
+{
+    CCheckQueue<HashJob> queue {QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    for (auto x = 0; x < nThreads - 1; ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+    while (state.KeepRunning()) {
+        CCheckQueueControl<HashJob> control(&queue);
+        for (size_t i = 0; i < BATCHES; ++i) {
+            std::vector<HashJob> vChecks(BATCH_SIZE);
+            control.Add(vChecks);
+        }
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+static void CCheckQueueScaling1(benchmark::State& state) { CCheckQueueScaling(state, 1); }
+static void CCheckQueueScaling2(benchmark::State& state) { CCheckQueueScaling(state, 2); }
+static void CCheckQueueScaling4(benchmark::State& state) { CCheckQueueScaling(state, 4); }
+static void CCheckQueueScaling8(benchmark::State& state) { CCheckQueueScaling(state, 8); }
+static void CCheckQueueScaling16(benchmark::State& state) { CCheckQueueScaling(state, 16); }
+static void CCheckQueueScaling32(benchmark::State& state) { CCheckQueueScaling(state, 32); }
+static void CCheckQueueScaling64(benchmark::State& state) { CCheckQueueScaling(state, 64); }
+
+BENCHMARK(CCheckQueueScaling1, 50);
+BENCHMARK(CCheckQueueScaling2, 50);
+BENCHMARK(CCheckQueueScaling4, 50);
+BENCHMARK(CCheckQueueScaling8, 50);
+BENCHMARK(CCheckQueueScaling16, 50);
+BENCHMARK(CCheckQueueScaling32, 50);
+BENCHMARK(CCheckQueueScaling64, 50);
@@ -0,0 +1,129 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <arith_uint256.h>
+#include <coins.h>
+#include <primitives/block.h>
+#include <util/memory.h>
+#include <validation.h>
+
+#include <chrono>
+#include <map>
+#include <thread>
+
+#include <boost/thread/thread.hpp>
+
+static const int BLOCK_TXS = 250;
+static const int INPUTS_PER_TX = 2;
+static const int PREFETCH_THREADS = 8;
+// Time a read from the coins database takes when neither LevelDB nor the OS has the coin cached
+static const std::chrono::microseconds COLD_READ_LATENCY(100);
+
+// Coins database stand-in which pays the latency of a cold read on every lookup. Safe to read from several threads.
+class CCoinsViewColdDB : public CCoinsView
+{
+private:
+    std::map<COutPoint, Coin> mapCoins;
+
+public:
+    void Add(const COutPoint& outpoint, const Coin& coin) { mapCoins.emplace(outpoint, coin); }
+
+    bool GetCoin(const COutPoint& outpoint, Coin& coin) const override
+    {
+        std::this_thread::sleep_for(COLD_READ_LATENCY);
+        auto it = mapCoins.find(outpoint);
+        if (it == mapCoins.end()) {
+            return false;
+        }
+        coin = it->second;
+        return true;
+    }
+
+    bool HaveCoin(const COutPoint& outpoint) const override
+    {
+        Coin coin;
+        return GetCoin(outpoint, coin);
+    }
+};
+
+static CBlock MakeBlock(CCoinsViewColdDB& db)
+{
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.resize(1);
+    block.vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+
+    for (int i = 0; i < BLOCK_TXS; i++) {
+        CMutableTransaction tx;
+        for (int j = 0; j < INPUTS_PER_TX; j++) {
+            COutPoint prevout(ArithToUint256(arith_uint256(i * INPUTS_PER_TX + j + 1)), j);
+            db.Add(prevout, Coin(CTxOut(COIN, CScript() << OP_TRUE), 1, false, false));
+            tx.vin.emplace_back(prevout);
+        }
+        tx.vout.emplace_back(INPUTS_PER_TX * COIN, CScript() << OP_TRUE);
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+    return block;
+}
+
+// The coins view work of ConnectBlock: check and spend the inputs, add the outputs
+static void ConnectInputs(const CBlock& block, CCoinsViewCache& view)
+{
+    for (const CTransactionRef& tx : block.vtx) {
+        if (!tx->IsCoinBase()) {
+            assert(view.HaveInputs(*tx));
+            assert(view.GetValueIn(*tx) == INPUTS_PER_TX * COIN);
+            for (const CTxIn& txin : tx->vin) {
+                view.SpendCoin(txin.prevout);
+            }
+        }
+        AddCoins(view, *tx, 2);
+    }
+}
+
+// Connect a block on top of a coins tip cache which is either empty (cold) or already holds the spent coins (warm),
+// optionally reading the spent coins on the coin prefetch threads first, as ConnectTip does.
+static void ConnectBlockCoins(benchmark::State& state, bool fWarm, bool fPrefetch)
+{
+    CCoinsViewColdDB db;
+    const CBlock block = MakeBlock(db);
+
+    boost::thread_group threadGroup;
+    nCoinPrefetchThreads = fPrefetch ? PREFETCH_THREADS : 0;
+    for (int i = 0; i < nCoinPrefetchThreads; i++) {
+        threadGroup.create_thread([i]() { return ThreadCoinPrefetch(i); });
+    }
+
+    auto tip = MakeUnique<CCoinsViewCache>(&db);
+    if (fWarm) {
+        CCoinsViewCache view(tip.get());
+        ConnectInputs(block, view);
+    }
+
+    while (state.KeepRunning()) {
+        if (!fWarm) {
+            tip = MakeUnique<CCoinsViewCache>(&db);
+        }
+        PrefetchBlockInputs(block, *tip, db);
+        CCoinsViewCache view(tip.get());
+        ConnectInputs(block, view);
+    }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    nCoinPrefetchThreads = 0;
+}
+
+static void ConnectBlockCoinsCold(benchmark::State& state) { ConnectBlockCoins(state, false, false); }
+static void ConnectBlockCoinsColdPrefetch(benchmark::State& state) { ConnectBlockCoins(state, false, true); }
+static void ConnectBlockCoinsWarm(benchmark::State& state) { ConnectBlockCoins(state, true, false); }
+static void ConnectBlockCoinsWarmPrefetch(benchmark::State& state) { ConnectBlockCoins(state, true, true); }
+
+BENCHMARK(ConnectBlockCoinsCold, 5);
+BENCHMARK(ConnectBlockCoinsColdPrefetch, 5);
+BENCHMARK(ConnectBlockCoinsWarm, 500);
+BENCHMARK(ConnectBlockCoinsWarmPrefetch, 500);
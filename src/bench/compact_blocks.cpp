@@ -0,0 +1,99 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+
+#include <blockencodings.h>
+#include <streams.h>
+#include <txmempool.h>
+#include <validation.h>
+
+// Every n-th transaction of the block was InstantSend-locked and left the mempool before the block arrived
+static const size_t LOCKED_TX_INTERVAL = 50;
+
+static void AddTx(const CTransactionRef& tx, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    LockPoints lp;
+    pool.addUnchecked(CTxMemPoolEntry(tx, 1000, 0, 1, false, 4, lp));
+}
+
+// The recorded block with a coinstake and a quorum commitment added, as they appear in blocks on our chain
+static CBlock MakeRecordedBlock()
+{
+    CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
+    CBlock block;
+    stream >> block;
+
+    CMutableTransaction coinstake;
+    coinstake.vin.resize(1);
+    coinstake.vin[0].prevout = COutPoint(block.vtx[1]->GetHash(), 0);
+    coinstake.vout.resize(2);
+    coinstake.vout[0].SetEmpty();
+    coinstake.vout[1] = block.vtx[0]->vout[0];
+    coinstake.nVersion = 3;
+    coinstake.nType = TRANSACTION_STAKE;
+
+    CMutableTransaction qc;
+    qc.nVersion = 2;
+    qc.nType = TRANSACTION_QUORUM_COMMITMENT;
+    qc.vExtraPayload.resize(300);
+
+    block.vtx.insert(block.vtx.begin() + 1, MakeTransactionRef(std::move(coinstake)));
+    block.vtx.insert(block.vtx.begin() + 2, MakeTransactionRef(std::move(qc)));
+    return block;
+}
+
+// Build a compact block on the sending side, then reconstruct it on the receiving side from the mempool and, if
+// fUseLockedTxs is set, the locked transactions which left it. Every transaction which can't be reconstructed would
+// need a getblocktxn round trip.
+static void CompactBlockReconstruction(benchmark::State& state, bool fUseLockedTxs)
+{
+    const CBlock block = MakeRecordedBlock();
+
+    CTxMemPool pool;
+    std::vector<std::pair<uint256, CTransactionRef>> vLockedTxs;
+    size_t nPredictable = 0;
+    {
+        LOCK2(cs_main, pool.cs);
+        for (size_t i = 1; i < block.vtx.size(); i++) {
+            const CTransactionRef& tx = block.vtx[i];
+            if (tx->IsCoinStake() || tx->nType == TRANSACTION_QUORUM_COMMITMENT) {
+                nPredictable++;
+            } else if (i % LOCKED_TX_INTERVAL == 0) {
+                vLockedTxs.emplace_back(tx->GetWitnessHash(), tx);
+            } else {
+                AddTx(tx, pool);
+            }
+        }
+    }
+    assert(nPredictable == 2);
+    const std::vector<std::pair<uint256, CTransactionRef>> vNoExtraTxs;
+
+    while (state.KeepRunning()) {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << CBlockHeaderAndShortTxIDs(block, true);
+
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        stream >> cmpctblock;
+
+        PartiallyDownloadedBlock partialBlock(&pool);
+        ReadStatus status = partialBlock.InitData(cmpctblock, fUseLockedTxs ? vLockedTxs : vNoExtraTxs);
+        assert(status == READ_STATUS_OK);
+
+        size_t nMissing = 0;
+        for (size_t i = 0; i < cmpctblock.BlockTxCount(); i++) {
+            if (!partialBlock.IsTxAvailable(i)) {
+                nMissing++;
+            }
+        }
+        assert(nMissing == (fUseLockedTxs ? 0 : vLockedTxs.size()));
+    }
+}
+
+static void CompactBlockReconstructionLocked(benchmark::State& state) { CompactBlockReconstruction(state, true); }
+static void CompactBlockReconstructionRoundTrip(benchmark::State& state) { CompactBlockReconstruction(state, false); }
+
+BENCHMARK(CompactBlockReconstructionLocked, 100);
+BENCHMARK(CompactBlockReconstructionRoundTrip, 100);
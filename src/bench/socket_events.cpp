@@ -0,0 +1,141 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <hash.h>
+#include <net.h>
+#include <netbase.h>
+#include <netmessagemaker.h>
+
+#include <limits>
+
+#ifndef WIN32
+#include <sys/socket.h>
+
+// Gives the benchmark access to the socket handler loop of CConnman without starting any threads
+struct CConnmanTest : public CConnman {
+    CConnmanTest() : CConnman(0x1337, 0x1337) {}
+
+    bool Setup(SocketEventsMode mode)
+    {
+        Options options;
+        options.socketEventsMode = mode;
+        options.nReceiveFloodSize = std::numeric_limits<unsigned int>::max();
+        options.nSendBufferMaxSize = std::numeric_limits<unsigned int>::max();
+        Init(options);
+        return InitSocketEvents();
+    }
+
+    void AddTestNode(CNode* pnode)
+    {
+        RegisterEvents(pnode);
+        LOCK(cs_vNodes);
+        vNodes.push_back(pnode);
+    }
+
+    void ClearTestNodes()
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes) {
+            delete pnode;
+        }
+        vNodes.clear();
+    }
+
+    void RunSocketHandler()
+    {
+        SocketHandler();
+
+        // there is no message handler thread, so drop whatever was received
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vNodes) {
+            LOCK(pnode->cs_vProcessMsg);
+            pnode->vProcessMsg.clear();
+            pnode->nProcessQueueSize = 0;
+        }
+    }
+};
+
+static std::vector<unsigned char> MakeSerializedPing()
+{
+    CSerializedNetMsg msg = CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::PING, uint64_t(0));
+
+    uint256 hash = Hash(msg.data.data(), msg.data.data() + msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), msg.data.size());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+
+    std::vector<unsigned char> vData;
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, vData, 0, hdr};
+    vData.insert(vData.end(), msg.data.begin(), msg.data.end());
+    return vData;
+}
+
+// One iteration of the socket handler loop with nPeers connected peers, of which only a single one has
+// data to receive. This is the common case on masternodes with many idle inbound and quorum connections and
+// shows how the per-iteration cost of each backend scales with the number of peers.
+static void SocketEventsLoop(benchmark::State& state, SocketEventsMode mode, size_t nPeers)
+{
+    CConnmanTest connman;
+    if (!connman.Setup(mode)) {
+        return;
+    }
+
+    std::vector<SOCKET> vRemoteSockets;
+    for (size_t i = 0; i < nPeers; i++) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            break;
+        }
+        SetSocketNonBlocking(fds[0], true);
+        CAddress addr(CService(CNetAddr(), 0), NODE_NONE);
+        connman.AddTestNode(new CNode(i, NODE_NETWORK, 0, fds[0], addr, 0, 0, CAddress(), "", true));
+        vRemoteSockets.push_back(fds[1]);
+    }
+
+    const std::vector<unsigned char> vPing = MakeSerializedPing();
+    size_t nPeer = 0;
+    while (state.KeepRunning()) {
+        SOCKET hRemote = vRemoteSockets[nPeer++ % vRemoteSockets.size()];
+        if (send(hRemote, (const char*)vPing.data(), vPing.size(), MSG_NOSIGNAL) != (ssize_t)vPing.size()) {
+            break;
+        }
+        connman.RunSocketHandler();
+    }
+
+    connman.ClearTestNodes();
+    for (SOCKET hSocket : vRemoteSockets) {
+        CloseSocket(hSocket);
+    }
+}
+
+static void SocketEventsSelect_16(benchmark::State& state) { SocketEventsLoop(state, SocketEventsMode::Select, 16); }
+static void SocketEventsSelect_128(benchmark::State& state) { SocketEventsLoop(state, SocketEventsMode::Select, 128); }
+static void SocketEventsSelect_384(benchmark::State& state) { SocketEventsLoop(state, SocketEventsMode::Select, 384); }
+
+BENCHMARK(SocketEventsSelect_16, 50 * 1000);
+BENCHMARK(SocketEventsSelect_128, 10 * 1000);
+BENCHMARK(SocketEventsSelect_384, 3 * 1000);
+
+#ifdef USE_POLL
+static void SocketEventsPoll_16(benchmark::State& state) { SocketEventsLoop(state, SocketEventsMode::Poll, 16); }
+static void SocketEventsPoll_128(benchmark::State& state) { SocketEventsLoop(state, SocketEventsMode::Poll, 128); }
+static void SocketEventsPoll_384(benchmark::State& state) { SocketEventsLoop(state, SocketEventsMode::Poll, 384); }
+
+BENCHMARK(SocketEventsPoll_16, 50 * 1000);
+BENCHMARK(SocketEventsPoll_128, 10 * 1000);
+BENCHMARK(SocketEventsPoll_384, 3 * 1000);
+#endif
+
+#ifdef USE_EPOLL
+static void SocketEventsEpoll_16(benchmark::State& state) { SocketEventsLoop(state, SocketEventsMode::EPoll, 16); }
+static void SocketEventsEpoll_128(benchmark::State& state) { SocketEventsLoop(state, SocketEventsMode::EPoll, 128); }
+static void SocketEventsEpoll_384(benchmark::State& state) { SocketEventsLoop(state, SocketEventsMode::EPoll, 384); }
+
+BENCHMARK(SocketEventsEpoll_16, 50 * 1000);
+BENCHMARK(SocketEventsEpoll_128, 10 * 1000);
+BENCHMARK(SocketEventsEpoll_384, 3 * 1000);
+#endif
+
+#endif // WIN32
@@ -8,6 +8,10 @@
 #include <sync.h>
 
 #include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -25,12 +29,42 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * The verifications are added in groups (e.g. the scripts of one block),
+  * each with its own result. The master can end a group and continue
+  * adding the next one while the workers are still processing it, and
+  * join the result of the group later.
+  *
+  * The verifications are distributed through a lock-free ring buffer
+  * (a bounded multi-consumer queue with a sequence number per slot), so
+  * workers taking batches of work don't contend on a lock. The mutex is
+  * only used to put idle threads to sleep and wake them up.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! A group of verifications with its own result, see EndGroup
+    struct Group {
+        //! Number of verifications of the group that haven't completed yet.
+        //! This includes elements that are no longer queued, but still in the
+        //! worker's own batches.
+        std::atomic<unsigned int> nTodo{0};
+
+        //! The temporary evaluation result of the group.
+        std::atomic<bool> fAllOk{true};
+    };
+
+    //! A slot of the ring buffer. It is free for the element at position
+    //! nSequence, and holds the element at position nSequence - 1 once that
+    //! element was added, until it is taken.
+    struct Slot {
+        std::atomic<uint64_t> nSequence{0};
+        T check;
+        Group* group{nullptr};
+    };
+
+    //! Mutex to put idle threads to sleep
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,88 +73,129 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! The ring buffer of elements to be processed, as a FIFO, so that the
+    //! groups added first are finished first.
+    std::vector<Slot> vSlots;
+    const uint64_t nSlotMask;
+
+    //! Position of the next element to be added (only written by the master)
+    std::atomic<uint64_t> nEnqueuePos{0};
+
+    //! Position of the next element to be taken
+    std::atomic<uint64_t> nDequeuePos{0};
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The groups with unfinished verifications or uncollected results, by
+    //! id. Only accessed by the master.
+    std::map<unsigned int, std::unique_ptr<Group>> groups;
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The id of the group elements are added to.
+    unsigned int nGroup{0};
 
-    //! The temporary evaluation result.
-    bool fAllOk;
+    //! The number of worker threads that are sleeping.
+    std::atomic<int> nIdle{0};
 
-    /**
-     * Number of verifications that haven't completed yet.
-     * This includes elements that are no longer queued, but still in the
-     * worker's own batches.
-     */
-    unsigned int nTodo;
+    //! The total number of worker threads.
+    std::atomic<int> nTotal{0};
 
     //! The maximum number of elements to be processed in one batch
-    unsigned int nBatchSize;
+    const unsigned int nBatchSize;
 
-    /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    static uint64_t SlotCount(unsigned int nBatchSizeIn)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
-        std::vector<T> vChecks;
-        vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
+        // Room for a good number of batches, so the master rarely finds the buffer full
+        uint64_t nCount = 1024;
+        while (nCount < 16 * (uint64_t)nBatchSizeIn)
+            nCount *= 2;
+        return nCount;
+    }
+
+    bool Empty() const
+    {
+        return nDequeuePos.load() == nEnqueuePos.load();
+    }
+
+    /** Add an element to the ring buffer. Only called by the master, which helps with the work while the buffer is full. */
+    void Push(T& check, Group* group, std::vector<T>& vChecks, std::vector<Group*>& vGroups)
+    {
+        const uint64_t nPos = nEnqueuePos.load(std::memory_order_relaxed);
+        Slot& slot = vSlots[nPos & nSlotMask];
+        while (slot.nSequence.load(std::memory_order_acquire) != nPos) {
+            if (!RunBatch(vChecks, vGroups))
+                std::this_thread::yield();
+        }
+        slot.check.swap(check);
+        slot.group = group;
+        slot.nSequence.store(nPos + 1, std::memory_order_release);
+        nEnqueuePos.store(nPos + 1);
+    }
+
+    /** Take a batch of consecutive elements off the ring buffer. Returns false if there were none. */
+    bool Pop(std::vector<T>& vChecks, std::vector<Group*>& vGroups)
+    {
+        uint64_t nPos = nDequeuePos.load(std::memory_order_relaxed);
+        unsigned int nNow;
         do {
-            {
+            // Decide how many work units to process now.
+            // * Do not try to do everything at once, but aim for increasingly smaller batches so
+            //   all workers finish approximately simultaneously.
+            // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
+            const uint64_t nQueued = nEnqueuePos.load(std::memory_order_relaxed) - nPos;
+            const unsigned int nMax = std::max<uint64_t>(1, std::min<uint64_t>(nBatchSize, nQueued / (nTotal.load(std::memory_order_relaxed) + 1)));
+            nNow = 0;
+            while (nNow < nMax && vSlots[(nPos + nNow) & nSlotMask].nSequence.load(std::memory_order_acquire) == nPos + nNow + 1)
+                nNow++;
+            if (nNow == 0) {
+                const uint64_t nPosNow = nDequeuePos.load(std::memory_order_relaxed);
+                if (nPosNow == nPos)
+                    return false;
+                nPos = nPosNow;
+                continue;
+            }
+            // Claim the elements; if another thread was faster, retry from the position it left
+        } while (nNow == 0 || !nDequeuePos.compare_exchange_weak(nPos, nPos + nNow, std::memory_order_relaxed));
+        vChecks.resize(nNow);
+        vGroups.resize(nNow);
+        for (unsigned int i = 0; i < nNow; i++) {
+            // Swap the jobs out of the ring buffer instead of copying them.
+            Slot& slot = vSlots[(nPos + i) & nSlotMask];
+            vChecks[i].swap(slot.check);
+            vGroups[i] = slot.group;
+            slot.nSequence.store(nPos + i + nSlotMask + 1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    /** Take a batch of elements off the ring buffer and process it. Returns false if there was no work. */
+    bool RunBatch(std::vector<T>& vChecks, std::vector<Group*>& vGroups)
+    {
+        if (!Pop(vChecks, vGroups))
+            return false;
+        // execute work, skipping the rest of a group in the batch once one of its elements failed
+        bool fOk = true;
+        for (size_t i = 0; i < vChecks.size(); i++) {
+            if (i == 0 || vGroups[i] != vGroups[i - 1])
+                fOk = vGroups[i]->fAllOk.load(std::memory_order_relaxed);
+            if (fOk && !vChecks[i]()) {
+                fOk = false;
+                vGroups[i]->fAllOk.store(false, std::memory_order_relaxed);
+            }
+        }
+        // destroy the checks before reporting them done
+        vChecks.clear();
+        for (size_t i = 0; i < vGroups.size(); i++) {
+            unsigned int nSame = 1;
+            while (i + 1 < vGroups.size() && vGroups[i + 1] == vGroups[i]) {
+                i++;
+                nSame++;
+            }
+            if (vGroups[i]->nTodo.fetch_sub(nSame, std::memory_order_acq_rel) == nSame) {
+                // We processed the last element of the group; inform the master it can return the result
                 boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                condMaster.notify_one();
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
-        } while (true);
+        }
+        vGroups.clear();
+        return true;
     }
 
 public:
@@ -128,33 +203,94 @@ public:
     boost::mutex ControlMutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    explicit CCheckQueue(unsigned int nBatchSizeIn) : vSlots(SlotCount(nBatchSizeIn)), nSlotMask(vSlots.size() - 1), nBatchSize(nBatchSizeIn)
+    {
+        for (size_t i = 0; i < vSlots.size(); i++)
+            vSlots[i].nSequence.store(i, std::memory_order_relaxed);
+    }
 
     //! Worker thread
     void Thread()
     {
-        Loop();
+        std::vector<T> vChecks;
+        std::vector<Group*> vGroups;
+        vChecks.reserve(nBatchSize);
+        vGroups.reserve(nBatchSize);
+        nTotal++;
+        while (true) {
+            if (RunBatch(vChecks, vGroups))
+                continue;
+            boost::unique_lock<boost::mutex> lock(mutex);
+            // The master checks nIdle after adding work, so either it wakes us or we see the work here
+            nIdle++;
+            while (Empty())
+                condWorker.wait(lock); // wait
+            nIdle--;
+        }
     }
 
-    //! Wait until execution finishes, and return whether all evaluations were successful.
+    //! Wait until execution of all groups finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true);
+        std::vector<unsigned int> vWait;
+        nGroup++;
+        for (const auto& group : groups)
+            vWait.push_back(group.first);
+        bool fRet = true;
+        for (unsigned int nWaitGroup : vWait)
+            fRet &= Wait(nWaitGroup);
+        return fRet;
     }
 
-    //! Add a batch of checks to the queue
+    //! Wait until execution of the group nWaitGroup finishes, and return whether all its evaluations were successful.
+    bool Wait(unsigned int nWaitGroup)
+    {
+        auto it = groups.find(nWaitGroup);
+        if (it == groups.end())
+            return true;
+        Group& group = *it->second;
+        std::vector<T> vChecks;
+        std::vector<Group*> vGroups;
+        // help with the work until the rest of the group is being processed by the workers
+        while (group.nTodo.load(std::memory_order_acquire) != 0) {
+            if (RunBatch(vChecks, vGroups))
+                continue;
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (group.nTodo.load(std::memory_order_acquire) != 0)
+                condMaster.wait(lock);
+        }
+        bool fRet = group.fAllOk.load(std::memory_order_relaxed);
+        // the result is collected, forget the group
+        groups.erase(it);
+        return fRet;
+    }
+
+    //! Add a batch of checks to the current group
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+        if (vChecks.empty())
+            return;
+        std::unique_ptr<Group>& group = groups[nGroup];
+        if (!group)
+            group.reset(new Group);
+        group->nTodo.fetch_add(vChecks.size(), std::memory_order_relaxed);
+        std::vector<T> vHelpChecks;
+        std::vector<Group*> vHelpGroups;
+        for (T& check : vChecks)
+            Push(check, group.get(), vHelpChecks, vHelpGroups);
+        if (nIdle.load() > 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (vChecks.size() == 1)
+                condWorker.notify_one();
+            else
+                condWorker.notify_all();
         }
-        nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
+    }
+
+    //! End the current group, later checks are added to a new one. Returns the id of the ended group.
+    unsigned int EndGroup()
+    {
+        return nGroup++;
     }
 
     ~CCheckQueue()
@@ -195,12 +331,28 @@ public:
         return fRet;
     }
 
+    //! Wait for the checks of a group ended with EndGroup, and return whether they were all successful.
+    bool Wait(unsigned int nGroup)
+    {
+        if (pqueue == nullptr)
+            return true;
+        return pqueue->Wait(nGroup);
+    }
+
     void Add(std::vector<T>& vChecks)
     {
         if (pqueue != nullptr)
             pqueue->Add(vChecks);
     }
 
+    //! End the current group of checks without waiting for them. Returns the id to pass to Wait.
+    unsigned int EndGroup()
+    {
+        if (pqueue == nullptr)
+            return 0;
+        return pqueue->EndGroup();
+    }
+
     ~CCheckQueueControl()
     {
         if (!fDone)
@@ -12,6 +12,7 @@
 #include <crypto/siphash.h>
 #include <memusage.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <uint256.h>
 
 #include <assert.h>
@@ -137,7 +138,14 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * The nodes of CCoinsMap are allocated from a pool owned by the map (see PoolAllocator), which saves the per
+ * allocation overhead and rounding of malloc on every cached coin. The largest block is sized for the node of the
+ * standard library's hash map: the entry, the hash and a few pointers.
+ */
+using CCoinsMapAllocator = PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                                         sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4>;
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>, CCoinsMapAllocator> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -292,6 +300,12 @@ public:
      */
     void Uncache(const COutPoint &outpoint);
 
+    /**
+     * Add a coin which was read from the base view ahead of time, as FetchCoin would have added it.
+     * Has no effect if the outpoint is cached already, as the cached entry may be newer than the base.
+     */
+    void AddPrefetchedCoin(const COutPoint& outpoint, Coin&& coin);
+
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
@@ -317,6 +331,12 @@ private:
      * memory usage.
      */
     CCoinsMap::iterator FetchCoin(const COutPoint &outpoint) const;
+
+    /**
+     * Replace the (emptied) map by a new one with a new pool, releasing the memory of the old pool. The base may
+     * still be using the old pool, e.g. if it took over the flushed entries.
+     */
+    void ReallocateCache();
 };
 
 //! Utility function to add all of a transaction's outputs to a cache.
@@ -9,11 +9,35 @@
 #include <clientversion.h>
 #include <fs.h>
 #include <hash.h>
+#include <random.h>
 #include <streams.h>
+#include <util/system.h>
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * True if T can write its changes to an append log between checkpoints. Such a type provides
+ *  - void GetLogRecords(std::vector<std::vector<unsigned char>>& vRecords), which appends one record for every
+ *    entry that changed since the previous call and
+ *  - void ApplyLogRecord(const std::vector<unsigned char>& vRecord), which applies a record written by GetLogRecords
+ *    and may throw if the record is malformed.
+ */
+template <typename T, typename = void>
+struct FlatDBHasLog : std::false_type {};
+
+template <typename T>
+struct FlatDBHasLog<T, decltype(std::declval<T&>().ApplyLogRecord(std::declval<const std::vector<unsigned char>&>()), void())> : std::true_type {};
 
 /**
 *   Generic Dumping and Loading
 *   ---------------------------
+*
+*   The whole object is written to a checkpoint file (e.g. governance.dat) on Dump. Types supporting it (see
+*   FlatDBHasLog) can additionally append their changes to a log file (e.g. governance.log) with Flush, which is
+*   replayed on top of the checkpoint by Load. Each log record is chained to the previous one and the log itself
+*   to the checksum of its checkpoint, so replay stops at a torn write and a log never applies to the wrong checkpoint.
 */
 
 template<typename T>
@@ -32,6 +56,7 @@ private:
     };
 
     fs::path pathDB;
+    fs::path pathLog;
     std::string strFilename;
     std::string strMagicMessage;
 
@@ -41,86 +66,98 @@ private:
 
         int64_t nStart = GetTimeMillis();
 
-        // serialize, checksum data up to that point, then append checksum
-        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
-        ssObj << strMagicMessage; // specific magic message for this type of object
-        ssObj << Params().MessageStart(); // network specific magic number
-        ssObj << objToSave;
-        uint256 hash = Hash(ssObj.begin(), ssObj.end());
-        ssObj << hash;
+        // Write to a temporary file first and move it into place afterwards, so that a crash
+        // while writing never leaves a truncated file behind
+        unsigned short randv = 0;
+        GetRandBytes((unsigned char*)&randv, sizeof(randv));
+        fs::path pathTmp = GetDataDir() / strprintf("%s.%04x", strFilename, randv);
 
         // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        FILE *file = fsbridge::fopen(pathTmp, "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
-        if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+        if (fileout.IsNull()) {
+            fileout.fclose();
+            remove(pathTmp);
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
+        }
 
-        // Write and commit header, data
+        // serialize straight into the file while checksumming data up to that point, then append checksum.
+        // This never buffers the whole serialized object in memory.
         try {
-            fileout << ssObj;
+            CHashedSinkWriter<CAutoFile> writer(&fileout);
+            writer << strMagicMessage; // specific magic message for this type of object
+            writer << Params().MessageStart(); // network specific magic number
+            writer << objToSave;
+            fileout << writer.GetHash();
         }
         catch (std::exception &e) {
+            fileout.fclose();
+            remove(pathTmp);
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        if (!FileCommit(fileout.Get())) {
+            fileout.fclose();
+            remove(pathTmp);
+            return error("%s: Failed to flush file %s", __func__, pathTmp.string());
+        }
         fileout.fclose();
 
+        // replace existing file, if any, with new file
+        if (!RenameOver(pathTmp, pathDB)) {
+            remove(pathTmp);
+            return error("%s: Rename-into-place failed", __func__);
+        }
+
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
 
         return true;
     }
 
-    ReadResult Read(T& objToLoad, bool fDryRun = false)
+    /**
+     * Verify checksum and file header without deserializing the stored object.
+     * On success filein is positioned at the start of the serialized object.
+     */
+    ReadResult ReadHeader(CAutoFile& filein, uint256& hashIn)
     {
-        //LOCK(objToLoad.cs);
-
-        int64_t nStart = GetTimeMillis();
-        // open input file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "rb");
-        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
-        if (filein.IsNull())
-        {
-            error("%s: Failed to open file %s", __func__, pathDB.string());
-            return FileError;
+        // use file size to know where the checksum starts
+        uint64_t fileSize = fs::file_size(pathDB);
+        if (fileSize < sizeof(uint256)) {
+            error("%s: File %s is too small", __func__, pathDB.string());
+            return HashReadError;
         }
+        uint64_t dataSize = fileSize - sizeof(uint256);
+        uint256 hashTmp;
 
-        // use file size to size memory buffer
-        int fileSize = fs::file_size(pathDB);
-        int dataSize = fileSize - sizeof(uint256);
-        // Don't try to resize to a negative number if file is small
-        if (dataSize < 0)
-            dataSize = 0;
-        std::vector<unsigned char> vchData;
-        vchData.resize(dataSize);
-        uint256 hashIn;
-
-        // read data and checksum from file
+        // hash data in small chunks and read checksum from file
         try {
-            filein.read((char *)&vchData[0], dataSize);
+            CHashVerifier<CAutoFile> verifier(&filein);
+            verifier.ignore(dataSize);
+            hashTmp = verifier.GetHash();
             filein >> hashIn;
         }
         catch (std::exception &e) {
             error("%s: Deserialize or I/O error - %s", __func__, e.what());
             return HashReadError;
         }
-        filein.fclose();
-
-        CDataStream ssObj(vchData, SER_DISK, CLIENT_VERSION);
 
         // verify stored checksum matches input data
-        uint256 hashTmp = Hash(ssObj.begin(), ssObj.end());
         if (hashIn != hashTmp)
         {
             error("%s: Checksum mismatch, data corrupted", __func__);
             return IncorrectHash;
         }
 
+        if (fseek(filein.Get(), 0, SEEK_SET)) {
+            error("%s: Failed to rewind file %s", __func__, pathDB.string());
+            return FileError;
+        }
 
         unsigned char pchMsgTmp[4];
         std::string strMagicMessageTmp;
         try {
             // de-serialize file header (file specific magic message) and ..
-            ssObj >> strMagicMessageTmp;
+            filein >> strMagicMessageTmp;
 
             // ... verify the message matches predefined one
             if (strMagicMessage != strMagicMessageTmp)
@@ -131,7 +168,7 @@ private:
 
 
             // de-serialize file header (network specific magic number) and ..
-            ssObj >> pchMsgTmp;
+            filein >> pchMsgTmp;
 
             // ... verify the network matches ours
             if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
@@ -139,32 +176,320 @@ private:
                 error("%s: Invalid network magic number", __func__);
                 return IncorrectMagicNumber;
             }
+        }
+        catch (std::exception &e) {
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return IncorrectFormat;
+        }
+
+        return Ok;
+    }
+
+    ReadResult Read(T& objToLoad)
+    {
+        //LOCK(objToLoad.cs);
+
+        int64_t nStart = GetTimeMillis();
+        // open input file, and associate with CAutoFile
+        FILE *file = fsbridge::fopen(pathDB, "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+        {
+            error("%s: Failed to open file %s", __func__, pathDB.string());
+            return FileError;
+        }
 
-            // de-serialize data into T object
-            ssObj >> objToLoad;
+        uint256 hashCheckpoint;
+        ReadResult headerResult = ReadHeader(filein, hashCheckpoint);
+        if (headerResult != Ok) {
+            return headerResult;
+        }
+
+        try {
+            // de-serialize data into T object, straight from the file
+            filein >> objToLoad;
         }
         catch (std::exception &e) {
             objToLoad.Clear();
             error("%s: Deserialize or I/O error - %s", __func__, e.what());
             return IncorrectFormat;
         }
+        filein.fclose();
+
+        ReplayLog(objToLoad, hashCheckpoint, FlatDBHasLog<T>());
+        // everything loaded so far is on disk already
+        ResetLog(objToLoad, FlatDBHasLog<T>());
 
         LogPrintf("Loaded info from %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToLoad.ToString());
-        if(!fDryRun) {
-            LogPrintf("%s: Cleaning....\n", __func__);
-            objToLoad.CheckAndRemove();
-            LogPrintf("     %s\n", objToLoad.ToString());
-        }
+        LogPrintf("%s: Cleaning....\n", __func__);
+        objToLoad.CheckAndRemove();
+        LogPrintf("     %s\n", objToLoad.ToString());
 
         return Ok;
     }
 
+    /// Like Read, but only verifies checksum and header instead of loading a whole copy of the object
+    ReadResult Verify()
+    {
+        FILE *file = fsbridge::fopen(pathDB, "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+        {
+            error("%s: Failed to open file %s", __func__, pathDB.string());
+            return FileError;
+        }
+        uint256 hashCheckpoint;
+        return ReadHeader(filein, hashCheckpoint);
+    }
+
+    /** Read the checksum at the end of the checkpoint file, which the log is chained to */
+    bool ReadCheckpointHash(uint256& hashCheckpoint, uint64_t& nCheckpointSize)
+    {
+        FILE *file = fsbridge::fopen(pathDB, "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull()) {
+            return false;
+        }
+        try {
+            nCheckpointSize = fs::file_size(pathDB);
+            if (nCheckpointSize < sizeof(uint256) || fseek(filein.Get(), -(long)sizeof(uint256), SEEK_END)) {
+                return false;
+            }
+            filein >> hashCheckpoint;
+        }
+        catch (std::exception &e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+        return true;
+    }
+
+    /**
+     * Check the log header against hashCheckpoint and walk its records, passing each of them to pobj if it is set.
+     * Stops at the first record which can't be read or doesn't match its hash, i.e. at a torn write.
+     * Returns false if the log doesn't belong to the checkpoint, otherwise nEnd and hashLast are set to the end
+     * and hash of the last valid record.
+     */
+    bool ScanLog(CAutoFile& filelog, const uint256& hashCheckpoint, T* pobj, long& nEnd, uint256& hashLast, size_t& nRecords)
+    {
+        try {
+            std::string strMagicMessageTmp;
+            unsigned char pchMsgTmp[4];
+            uint256 hashCheckpointTmp;
+            filelog >> strMagicMessageTmp;
+            filelog >> pchMsgTmp;
+            filelog >> hashCheckpointTmp;
+            if (strMagicMessageTmp != strMagicMessage || memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp))
+                || hashCheckpointTmp != hashCheckpoint) {
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+
+        hashLast = hashCheckpoint;
+        nEnd = ftell(filelog.Get());
+        nRecords = 0;
+        while (true) {
+            std::vector<unsigned char> vRecord;
+            uint256 hashRecord;
+            try {
+                filelog >> vRecord;
+                filelog >> hashRecord;
+            }
+            catch (const std::exception&) {
+                break;
+            }
+            if (HashLogRecord(hashLast, vRecord) != hashRecord) {
+                LogPrintf("%s: Ignoring torn record at the end of %s\n", __func__, pathLog.filename().string());
+                break;
+            }
+            if (pobj != nullptr) {
+                try {
+                    pobj->ApplyLogRecord(vRecord);
+                }
+                catch (std::exception &e) {
+                    error("%s: Failed to apply record - %s", __func__, e.what());
+                    break;
+                }
+            }
+            hashLast = hashRecord;
+            nEnd = ftell(filelog.Get());
+            nRecords++;
+        }
+        return true;
+    }
+
+    static uint256 HashLogRecord(const uint256& hashPrev, const std::vector<unsigned char>& vRecord)
+    {
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << hashPrev << vRecord;
+        return ss.GetHash();
+    }
+
+    void ReplayLog(T& objToLoad, const uint256& hashCheckpoint, std::true_type)
+    {
+        FILE *file = fsbridge::fopen(pathLog, "rb");
+        CAutoFile filelog(file, SER_DISK, CLIENT_VERSION);
+        if (filelog.IsNull()) {
+            return;
+        }
+        long nEnd;
+        uint256 hashLast;
+        size_t nRecords;
+        if (!ScanLog(filelog, hashCheckpoint, &objToLoad, nEnd, hashLast, nRecords)) {
+            LogPrintf("%s: %s doesn't belong to %s, ignoring it\n", __func__, pathLog.filename().string(), strFilename);
+            return;
+        }
+        LogPrintf("Replayed %d records from %s\n", nRecords, pathLog.filename().string());
+    }
+
+    void ReplayLog(T& objToLoad, const uint256& hashCheckpoint, std::false_type) {}
+
+    /** Mark the current state of objToSave as written, so that the next Flush only logs later changes */
+    void ResetLog(T& objToSave, std::true_type)
+    {
+        std::vector<std::vector<unsigned char>> vRecords;
+        objToSave.GetLogRecords(vRecords);
+    }
+
+    void ResetLog(T& objToSave, std::false_type) {}
+
+    FILE* OpenLogForAppend()
+    {
+        FILE *file = fsbridge::fopen(pathLog, "rb+");
+        if (file == nullptr) {
+            file = fsbridge::fopen(pathLog, "wb+");
+        }
+        if (file == nullptr) {
+            error("%s: Failed to open file %s", __func__, pathLog.string());
+        }
+        return file;
+    }
+
+    /** Find where to append to the log of hashCheckpoint. A log which belongs to another checkpoint is started over. */
+    void FindLogEnd(CAutoFile& filelog, const uint256& hashCheckpoint, long& nEnd, uint256& hashLast)
+    {
+        size_t nRecords;
+        if (!ScanLog(filelog, hashCheckpoint, nullptr, nEnd, hashLast, nRecords)) {
+            // missing or stale header, start a new log for the current checkpoint
+            nEnd = 0;
+            hashLast = hashCheckpoint;
+        }
+    }
+
+    /** Append vRecords to filelog at nEnd, chained to hashLast, see FindLogEnd */
+    bool AppendLog(CAutoFile& filelog, const uint256& hashCheckpoint, long nEnd, uint256 hashLast,
+                   const std::vector<std::vector<unsigned char>>& vRecords)
+    {
+        try {
+            if (fseek(filelog.Get(), nEnd, SEEK_SET)) {
+                throw std::ios_base::failure("seek failed");
+            }
+            if (nEnd == 0) {
+                filelog << strMagicMessage;
+                filelog << Params().MessageStart();
+                filelog << hashCheckpoint;
+            }
+            for (const auto& vRecord : vRecords) {
+                hashLast = HashLogRecord(hashLast, vRecord);
+                filelog << vRecord;
+                filelog << hashLast;
+            }
+            nEnd = ftell(filelog.Get());
+            // drop a torn record left behind by a previous crash
+            if (!FileCommit(filelog.Get()) || !TruncateFile(filelog.Get(), nEnd)) {
+                throw std::ios_base::failure("commit failed");
+            }
+        }
+        catch (std::exception &e) {
+            return error("%s: Failed to append to %s - %s", __func__, pathLog.string(), e.what());
+        }
+        return true;
+    }
+
+    /**
+     * Write a checkpoint of objToSave. vPending holds the records of changes which were already taken from the
+     * change tracking of objToSave but aren't on disk yet. They, and all changes up to the checkpoint, are only
+     * dropped once they are on disk: in the new checkpoint, or appended to the log of the previous checkpoint if
+     * the new one can't be written.
+     */
+    bool WriteCheckpoint(T& objToSave, std::vector<std::vector<unsigned char>>& vPending, std::true_type)
+    {
+        // Changes made while writing end up in the checkpoint and possibly once more in the next log, which is harmless
+        objToSave.GetLogRecords(vPending);
+        if (Write(objToSave)) {
+            // the log was chained to the previous checkpoint, so it wouldn't be replayed anymore anyway
+            fs::remove(pathLog);
+            return true;
+        }
+        if (vPending.empty()) {
+            return false;
+        }
+
+        // The previous checkpoint and its log stay in place, keep the log complete
+        uint256 hashCheckpoint;
+        uint64_t nCheckpointSize;
+        if (ReadCheckpointHash(hashCheckpoint, nCheckpointSize)) {
+            CAutoFile filelog(OpenLogForAppend(), SER_DISK, CLIENT_VERSION);
+            if (!filelog.IsNull()) {
+                long nEnd;
+                uint256 hashLast;
+                FindLogEnd(filelog, hashCheckpoint, nEnd, hashLast);
+                if (AppendLog(filelog, hashCheckpoint, nEnd, hashLast, vPending)) {
+                    return false;
+                }
+            }
+        }
+        // A log with a gap would replay into an inconsistent state. Drop the cache instead, so that the next flush
+        // writes a checkpoint and a restart starts over from an empty cache.
+        LogPrintf("%s: Unable to keep %s complete, removing %s\n", __func__, pathLog.filename().string(), strFilename);
+        fs::remove(pathLog);
+        fs::remove(pathDB);
+        return false;
+    }
+
+    bool WriteCheckpoint(T& objToSave, std::vector<std::vector<unsigned char>>& vPending, std::false_type)
+    {
+        return Write(objToSave);
+    }
+
+    bool Dump(T& objToSave, std::vector<std::vector<unsigned char>>& vPending)
+    {
+        int64_t nStart = GetTimeMillis();
+
+        LogPrintf("Verifying %s format...\n", strFilename);
+        ReadResult readResult = Verify();
+
+        // there was an error and it was not an error on file opening => do not proceed
+        if (readResult == FileError)
+            LogPrintf("Missing file %s, will try to recreate\n", strFilename);
+        else if (readResult != Ok)
+        {
+            LogPrintf("Error reading %s: ", strFilename);
+            if(readResult == IncorrectFormat)
+                LogPrintf("%s: Magic is ok but data has invalid format, will try to recreate\n", __func__);
+            else
+            {
+                LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
+                return false;
+            }
+        }
+
+        LogPrintf("Writing info to %s...\n", strFilename);
+        bool fWritten = WriteCheckpoint(objToSave, vPending, FlatDBHasLog<T>());
+        LogPrintf("%s dump %s  %dms\n", strFilename, fWritten ? "finished" : "failed", GetTimeMillis() - nStart);
+
+        return fWritten;
+    }
+
 
 public:
     CFlatDB(std::string strFilenameIn, std::string strMagicMessageIn)
     {
         pathDB = GetDataDir() / strFilenameIn;
+        pathLog = fs::path(pathDB).replace_extension(".log");
         strFilename = strFilenameIn;
         strMagicMessage = strMagicMessageIn;
     }
@@ -193,31 +518,54 @@ public:
 
     bool Dump(T& objToSave)
     {
+        std::vector<std::vector<unsigned char>> vPending;
+        return Dump(objToSave, vPending);
+    }
+
+    /**
+     * Append the entries of objToSave which changed since the last Load, Dump or Flush to the log.
+     * Writes a new checkpoint instead if there is none yet or the log has grown larger than the checkpoint.
+     */
+    bool Flush(T& objToSave)
+    {
+        static_assert(FlatDBHasLog<T>::value, "CFlatDB::Flush requires a type with log support");
+
         int64_t nStart = GetTimeMillis();
+        std::vector<std::vector<unsigned char>> vRecords;
+        uint256 hashCheckpoint;
+        uint64_t nCheckpointSize;
+        if (!ReadCheckpointHash(hashCheckpoint, nCheckpointSize)) {
+            return Dump(objToSave, vRecords);
+        }
 
-        LogPrintf("Verifying %s format...\n", strFilename);
-        T tmpObjToLoad;
-        ReadResult readResult = Read(tmpObjToLoad, true);
+        CAutoFile filelog(OpenLogForAppend(), SER_DISK, CLIENT_VERSION);
+        if (filelog.IsNull()) {
+            return false;
+        }
+        long nEnd;
+        uint256 hashLast;
+        FindLogEnd(filelog, hashCheckpoint, nEnd, hashLast);
+        if ((uint64_t)nEnd > nCheckpointSize) {
+            filelog.fclose();
+            return Dump(objToSave, vRecords);
+        }
 
-        // there was an error and it was not an error on file opening => do not proceed
-        if (readResult == FileError)
-            LogPrintf("Missing file %s, will try to recreate\n", strFilename);
-        else if (readResult != Ok)
-        {
-            LogPrintf("Error reading %s: ", strFilename);
-            if(readResult == IncorrectFormat)
-                LogPrintf("%s: Magic is ok but data has invalid format, will try to recreate\n", __func__);
-            else
-            {
-                LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
-                return false;
-            }
+        objToSave.GetLogRecords(vRecords);
+        if (vRecords.empty()) {
+            return true;
         }
 
-        LogPrintf("Writing info to %s...\n", strFilename);
-        Write(objToSave);
-        LogPrintf("%s dump finished  %dms\n", strFilename, GetTimeMillis() - nStart);
+        if (!AppendLog(filelog, hashCheckpoint, nEnd, hashLast, vRecords)) {
+            filelog.fclose();
+            // the changes are no longer tracked as dirty, write them with a full checkpoint instead
+            return Dump(objToSave, vRecords);
+        }
 
+        size_t nBytes = 0;
+        for (const auto& vRecord : vRecords) {
+            nBytes += vRecord.size();
+        }
+        LogPrint(BCLog::BENCHMARK, "Flushed %d records (%d bytes) to %s  %dms\n", vRecords.size(), nBytes, pathLog.filename().string(), GetTimeMillis() - nStart);
         return true;
     }
 
@@ -120,6 +120,7 @@ bool CGovernanceTriggerManager::AddNewTrigger(uint256 nHash)
     pSuperblock->SetStatus(SEEN_OBJECT_IS_VALID);
 
     mapTrigger.insert(std::make_pair(nHash, pSuperblock));
+    SetIndexDirty();
 
     return true;
 }
@@ -165,6 +166,7 @@ void CGovernanceTriggerManager::CleanAndRemove()
                 if (pSuperblock->IsExpired()) {
                     // update corresponding object
                     pObj->SetExpired();
+                    governance.SetObjectDirty(it->first);
                     remove = true;
                 }
                 break;
@@ -181,10 +183,12 @@ void CGovernanceTriggerManager::CleanAndRemove()
                 strDataAsPlainString = pObj->GetDataAsPlainString();
                 // mark corresponding object for deletion
                 pObj->PrepareDeletion(GetAdjustedTime());
+                governance.SetObjectDirty(it->first);
             }
             LogPrint(BCLog::GOBJECT, "CGovernanceTriggerManager::CleanAndRemove -- Removing trigger object %s\n", strDataAsPlainString);
             // delete the trigger
             mapTrigger.erase(it++);
+            SetIndexDirty();
         } else {
             ++it;
         }
@@ -192,26 +196,47 @@ void CGovernanceTriggerManager::CleanAndRemove()
 }
 
 /**
-*   Get Active Triggers
+*   Update Index
 *
-*   - Look through triggers and scan for active ones
-*   - Return the triggers in a list
+*   - Rebuild the per height trigger index and pick the winning trigger for each height
 */
 
-std::vector<CSuperblock_sptr> CGovernanceTriggerManager::GetActiveTriggers()
+void CGovernanceTriggerManager::UpdateIndex()
 {
     AssertLockHeld(governance.cs);
-    std::vector<CSuperblock_sptr> vecResults;
 
-    // LOOK AT THESE OBJECTS AND COMPILE A VALID LIST OF TRIGGERS
+    if (!fIndexDirty) {
+        return;
+    }
+    // reset first, so that changes happening while we rebuild are not lost
+    fIndexDirty = false;
+
+    mapTriggersByHeight.clear();
+    mapBestSuperblocks.clear();
+
+    std::map<int, int> mapBestYesCount;
     for (const auto& pair : mapTrigger) {
+        const CSuperblock_sptr& pSuperblock = pair.second;
+        if (!pSuperblock) {
+            continue;
+        }
         CGovernanceObject* pObj = governance.FindGovernanceObject(pair.first);
-        if (pObj) {
-            vecResults.push_back(pair.second);
+        if (!pObj) {
+            continue;
+        }
+        int nBlockHeight = pSuperblock->GetBlockHeight();
+        mapTriggersByHeight[nBlockHeight].push_back(pSuperblock);
+
+        // DO WE HAVE A NEW WINNER?
+        int nYesCount = pObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING);
+        if (nYesCount > mapBestYesCount[nBlockHeight]) {
+            mapBestYesCount[nBlockHeight] = nYesCount;
+            mapBestSuperblocks[nBlockHeight] = pSuperblock;
         }
     }
 
-    return vecResults;
+    LogPrint(BCLog::GOBJECT, "CGovernanceTriggerManager::UpdateIndex -- %d heights with triggers, %d with a winner\n",
+        mapTriggersByHeight.size(), mapBestSuperblocks.size());
 }
 
 /**
@@ -228,8 +253,14 @@ bool CSuperblockManager::IsSuperblockTriggered(int nBlockHeight)
     }
 
     LOCK(governance.cs);
-    // GET ALL ACTIVE TRIGGERS
-    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers();
+    // GET ALL ACTIVE TRIGGERS FOR THIS HEIGHT
+    triggerman.UpdateIndex();
+    auto itTriggers = triggerman.mapTriggersByHeight.find(nBlockHeight);
+    if (itTriggers == triggerman.mapTriggersByHeight.end()) {
+        LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- no triggers for nBlockHeight = %d\n", nBlockHeight);
+        return false;
+    }
+    const std::vector<CSuperblock_sptr>& vecTriggers = itTriggers->second;
 
     LogPrint(BCLog::GOBJECT, "CSuperblockManager::IsSuperblockTriggered -- vecTriggers.size() = %d\n", vecTriggers.size());
 
@@ -280,30 +311,15 @@ bool CSuperblockManager::GetBestSuperblock(CSuperblock_sptr& pSuperblockRet, int
     }
 
     AssertLockHeld(governance.cs);
-    std::vector<CSuperblock_sptr> vecTriggers = triggerman.GetActiveTriggers();
-    int nYesCount = 0;
-
-    for (const auto& pSuperblock : vecTriggers) {
-        if (!pSuperblock || nBlockHeight != pSuperblock->GetBlockHeight()) {
-            continue;
-        }
-
-        CGovernanceObject* pObj = pSuperblock->GetGovernanceObject();
-
-        if (!pObj) {
-            continue;
-        }
-
-        // DO WE HAVE A NEW WINNER?
+    triggerman.UpdateIndex();
 
-        int nTempYesCount = pObj->GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING);
-        if (nTempYesCount > nYesCount) {
-            nYesCount = nTempYesCount;
-            pSuperblockRet = pSuperblock;
-        }
+    auto it = triggerman.mapBestSuperblocks.find(nBlockHeight);
+    if (it == triggerman.mapBestSuperblocks.end()) {
+        return false;
     }
 
-    return nYesCount > 0;
+    pSuperblockRet = it->second;
+    return true;
 }
 
 /**
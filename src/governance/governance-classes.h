@@ -11,6 +11,8 @@
 #include <script/standard.h>
 #include <util/system.h>
 
+#include <atomic>
+
 class CSuperblock;
 class CGovernanceTriggerManager;
 class CSuperblockManager;
@@ -38,13 +40,26 @@ private:
 
     trigger_m_t mapTrigger;
 
-    std::vector<CSuperblock_sptr> GetActiveTriggers();
+    // Active triggers indexed by superblock height and the trigger with the most funding votes per height.
+    // Rebuilt on the next lookup after triggers or votes on triggers changed, so that block creation and
+    // validation at superblock heights don't have to rescan all triggers and count their votes.
+    std::map<int, std::vector<CSuperblock_sptr>> mapTriggersByHeight;
+    std::map<int, CSuperblock_sptr> mapBestSuperblocks;
+    std::atomic<bool> fIndexDirty;
+
     bool AddNewTrigger(uint256 nHash);
     void CleanAndRemove();
+    void UpdateIndex();
 
 public:
     CGovernanceTriggerManager() :
-        mapTrigger() {}
+        mapTrigger(),
+        mapTriggersByHeight(),
+        mapBestSuperblocks(),
+        fIndexDirty(true) {}
+
+    /// Called whenever triggers or votes on triggers changed
+    void SetIndexDirty() { fIndexDirty = true; }
 };
 
 /**
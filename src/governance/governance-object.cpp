@@ -39,6 +39,7 @@ CGovernanceObject::CGovernanceObject() :
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteTallies(),
     fileVotes()
 {
     // PARSE JSON DATA STORAGE (VCHDATA)
@@ -66,6 +67,7 @@ CGovernanceObject::CGovernanceObject(const uint256& nHashParentIn, int nRevision
     fExpired(false),
     fUnparsable(false),
     mapCurrentMNVotes(),
+    voteTallies(),
     fileVotes()
 {
     // PARSE JSON DATA STORAGE (VCHDATA)
@@ -93,6 +95,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
     fExpired(other.fExpired),
     fUnparsable(other.fUnparsable),
     mapCurrentMNVotes(other.mapCurrentMNVotes),
+    voteTallies(other.voteTallies),
     fileVotes(other.fileVotes)
 {
 }
@@ -100,7 +103,8 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other) :
 bool CGovernanceObject::ProcessVote(CNode* pfrom,
     const CGovernanceVote& vote,
     CGovernanceException& exception,
-    CConnman& connman)
+    CConnman& connman,
+    bool fSignatureVerified)
 {
     LOCK(cs);
 
@@ -141,8 +145,11 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         exception = CGovernanceException(ostr.str(), GOVERNANCE_EXCEPTION_PERMANENT_ERROR, 20);
         return false;
     }
-    vote_instance_m_it it2 = voteRecordRef.mapInstances.emplace(vote_instance_m_t::value_type(int(eSignal), vote_instance_t())).first;
-    vote_instance_t& voteInstanceRef = it2->second;
+    auto instancePair = voteRecordRef.mapInstances.emplace(vote_instance_m_t::value_type(int(eSignal), vote_instance_t()));
+    if (instancePair.second) {
+        UpdateVoteTally(eSignal, VOTE_OUTCOME_NONE, 1);
+    }
+    vote_instance_t& voteInstanceRef = instancePair.first->second;
 
     // Reject obsolete votes
     if (vote.GetTimestamp() < voteInstanceRef.nCreationTime) {
@@ -188,7 +195,7 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
     bool onlyVotingKeyAllowed = nObjectType == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
 
     // Finally check that the vote is actually valid (done last because of cost of signature verification)
-    if (!vote.IsValid(onlyVotingKeyAllowed)) {
+    if (!vote.IsValid(onlyVotingKeyAllowed, !fSignatureVerified)) {
         std::ostringstream ostr;
         ostr << "CGovernanceObject::ProcessVote -- Invalid vote"
              << ", MN outpoint = " << vote.GetMasternodeOutpoint().ToStringShort()
@@ -210,9 +217,11 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         return false;
     }
 
+    UpdateVoteTally(eSignal, voteInstanceRef.eOutcome, -1);
     voteInstanceRef = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
+    UpdateVoteTally(eSignal, voteInstanceRef.eOutcome, 1);
     fileVotes.AddVote(vote);
-    fDirtyCache = true;
+    SetVotesChanged();
     return true;
 }
 
@@ -226,8 +235,11 @@ void CGovernanceObject::ClearMasternodeVotes()
     while (it != mapCurrentMNVotes.end()) {
         if (!mnList.HasMNByCollateral(it->first)) {
             fileVotes.RemoveVotesFromMasternode(it->first);
+            for (const auto& instancePair : it->second.mapInstances) {
+                UpdateVoteTally(instancePair.first, instancePair.second.eOutcome, -1);
+            }
             mapCurrentMNVotes.erase(it++);
-            fDirtyCache = true;
+            SetVotesChanged();
         } else {
             ++it;
         }
@@ -254,6 +266,7 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
         CGovernanceVote tmpVote(mnOutpoint, nParentHash, (vote_signal_enum_t)jt->first, jt->second.eOutcome);
         tmpVote.SetTime(jt->second.nCreationTime);
         if (removedVotes.count(tmpVote.GetHash())) {
+            UpdateVoteTally(jt->first, jt->second.eOutcome, -1);
             jt = it->second.mapInstances.erase(jt);
         } else {
             ++jt;
@@ -269,12 +282,79 @@ std::set<uint256> CGovernanceObject::RemoveInvalidVotes(const COutPoint& mnOutpo
             removedStr += strprintf("  %s\n", h.ToString());
         }
         LogPrintf("CGovernanceObject::%s -- Removed %d invalid votes for %s from MN %s:\n%s", __func__, removedVotes.size(), nParentHash.ToString(), mnOutpoint.ToString(), removedStr);
-        fDirtyCache = true;
+        SetVotesChanged();
     }
 
     return removedVotes;
 }
 
+void CGovernanceObject::EraseVotes()
+{
+    LOCK(cs);
+    fileVotes.EraseAll();
+    mapCurrentMNVotes.clear();
+    voteTallies = vote_tally_t();
+    SetVotesChanged();
+}
+
+bool CGovernanceObject::RestoreVote(const CGovernanceVote& vote)
+{
+    LOCK(cs);
+    if (!fileVotes.RestoreVote(vote)) {
+        return false;
+    }
+    vote_rec_t& voteRecordRef = mapCurrentMNVotes[vote.GetMasternodeOutpoint()];
+    auto instancePair = voteRecordRef.mapInstances.emplace(int(vote.GetSignal()), vote_instance_t());
+    if (instancePair.second) {
+        UpdateVoteTally(vote.GetSignal(), VOTE_OUTCOME_NONE, 1);
+    }
+    vote_instance_t& voteInstanceRef = instancePair.first->second;
+    if (vote.GetTimestamp() > voteInstanceRef.nCreationTime) {
+        UpdateVoteTally(vote.GetSignal(), voteInstanceRef.eOutcome, -1);
+        voteInstanceRef = vote_instance_t(vote.GetOutcome(), vote.GetTimestamp(), vote.GetTimestamp());
+        UpdateVoteTally(vote.GetSignal(), voteInstanceRef.eOutcome, 1);
+    }
+    SetVotesChanged();
+    return true;
+}
+
+size_t CGovernanceObject::RemoveMissingVotes()
+{
+    LOCK(cs);
+    size_t nRemoved = fileVotes.RemoveMissingVotes();
+    if (nRemoved) {
+        SetVotesChanged();
+    }
+    return nRemoved;
+}
+
+void CGovernanceObject::UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta)
+{
+    if (nSignal < 0 || nSignal > MAX_SUPPORTED_VOTE_SIGNAL || eOutcome < VOTE_OUTCOME_NONE || eOutcome > VOTE_OUTCOME_ABSTAIN) {
+        return;
+    }
+    voteTallies[nSignal][eOutcome] += nDelta;
+}
+
+void CGovernanceObject::RebuildVoteTallies()
+{
+    voteTallies = vote_tally_t();
+    for (const auto& votepair : mapCurrentMNVotes) {
+        for (const auto& instancePair : votepair.second.mapInstances) {
+            UpdateVoteTally(instancePair.first, instancePair.second.eOutcome, 1);
+        }
+    }
+}
+
+void CGovernanceObject::SetVotesChanged()
+{
+    fDirtyCache = true;
+    if (nObjectType == GOVERNANCE_OBJECT_TRIGGER) {
+        // vote counts of triggers decide which superblock wins
+        triggerman.SetIndexDirty();
+    }
+}
+
 uint256 CGovernanceObject::GetHash() const
 {
     // Note: doesn't match serialization
@@ -595,15 +675,10 @@ int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote
 {
     LOCK(cs);
 
-    int nCount = 0;
-    for (const auto& votepair : mapCurrentMNVotes) {
-        const vote_rec_t& recVote = votepair.second;
-        vote_instance_m_cit it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if (it2 != recVote.mapInstances.end() && it2->second.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
-        }
+    if (eVoteSignalIn < 0 || eVoteSignalIn > MAX_SUPPORTED_VOTE_SIGNAL || eVoteOutcomeIn < VOTE_OUTCOME_NONE || eVoteOutcomeIn > VOTE_OUTCOME_ABSTAIN) {
+        return 0;
     }
-    return nCount;
+    return voteTallies[eVoteSignalIn][eVoteOutcomeIn];
 }
 
 /**
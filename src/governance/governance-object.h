@@ -18,6 +18,8 @@
 
 #include <univalue.h>
 
+#include <array>
+
 class CGovernanceManager;
 class CGovernanceTriggerManager;
 class CGovernanceObject;
@@ -83,6 +85,9 @@ struct vote_instance_t {
 
 typedef std::map<int, vote_instance_t> vote_instance_m_t;
 
+/// Number of masternodes per outcome, for every signal
+typedef std::array<std::array<int, VOTE_OUTCOME_ABSTAIN + 1>, MAX_SUPPORTED_VOTE_SIGNAL + 1> vote_tally_t;
+
 typedef vote_instance_m_t::iterator vote_instance_m_it;
 
 typedef vote_instance_m_t::const_iterator vote_instance_m_cit;
@@ -175,6 +180,9 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    /// Tallies of mapCurrentMNVotes, kept up to date with it so that vote counts don't iterate all masternodes
+    vote_tally_t voteTallies;
+
     CGovernanceObjectVoteFile fileVotes;
 
 public:
@@ -251,6 +259,13 @@ public:
         return fileVotes;
     }
 
+    /// Called by CGovernanceManager for the objects it manages, which are the only ones erasing votes from disk
+    void SetVoteFileDiskOwner()
+    {
+        LOCK(cs);
+        fileVotes.SetDiskOwner();
+    }
+
     // Signature related functions
 
     void SetMasternodeOutpoint(const COutPoint& outpoint);
@@ -329,6 +344,9 @@ public:
             READWRITE(nDeletionTime);
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
+            if (ser_action.ForRead()) {
+                RebuildVoteTallies();
+            }
             READWRITE(fileVotes);
             LogPrint(BCLog::GOBJECT, "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
         }
@@ -343,7 +361,8 @@ public:
     bool ProcessVote(CNode* pfrom,
         const CGovernanceVote& vote,
         CGovernanceException& exception,
-        CConnman& connman);
+        CConnman& connman,
+        bool fSignatureVerified = false);
 
     /// Called when MN's which have voted on this object have been removed
     void ClearMasternodeVotes();
@@ -353,6 +372,24 @@ public:
     // also for MNs that were removed from the list completely.
     // Returns deleted vote hashes.
     std::set<uint256> RemoveInvalidVotes(const COutPoint& mnOutpoint);
+
+    /// Called when this object is erased, removes all of its votes from disk
+    void EraseVotes();
+
+    /// Re-add a vote which was accepted and written to disk, but is missing in the vote index loaded from disk.
+    /// Returns false if the vote was replaced by a newer one.
+    bool RestoreVote(const CGovernanceVote& vote);
+
+    /// Drop votes from the vote index which are not on disk anymore. Returns the number of dropped votes.
+    size_t RemoveMissingVotes();
+
+private:
+    /// Mark cached vote dependent data as outdated
+    void SetVotesChanged();
+
+    /// Add nDelta masternodes to the tally of an outcome, out of range signals and outcomes are not tallied
+    void UpdateVoteTally(int nSignal, vote_outcome_enum_t eOutcome, int nDelta);
+    void RebuildVoteTallies();
 };
 
 
@@ -4,19 +4,98 @@
 
 #include <governance/governance-votedb.h>
 
+#include <util/system.h>
+
+#include <assert.h>
+
+static const std::string DB_GOVERNANCE_VOTE = "gv_v";
+
+std::unique_ptr<CGovernanceVoteDB> governanceVoteDb;
+
+static CGovernanceVoteDB& VoteDB()
+{
+    // set up in AppInitMain before governance.dat is loaded and before any peer or RPC call can submit an object
+    assert(governanceVoteDb);
+    return *governanceVoteDb;
+}
+
+CGovernanceVoteDB::CGovernanceVoteDB(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(fMemory ? "" : (GetDataDir() / "govvotes"), nCacheSize, fMemory, fWipe)
+{
+}
+
+void CGovernanceVoteDB::WriteVote(const CGovernanceVote& vote)
+{
+    db.Write(std::make_pair(DB_GOVERNANCE_VOTE, vote.GetHash()), vote);
+}
+
+bool CGovernanceVoteDB::ReadVote(const uint256& nHash, CGovernanceVote& vote) const
+{
+    return db.Read(std::make_pair(DB_GOVERNANCE_VOTE, nHash), vote);
+}
+
+bool CGovernanceVoteDB::HaveVote(const uint256& nHash) const
+{
+    return db.Exists(std::make_pair(DB_GOVERNANCE_VOTE, nHash));
+}
+
+void CGovernanceVoteDB::EraseVote(const uint256& nHash)
+{
+    db.Erase(std::make_pair(DB_GOVERNANCE_VOTE, nHash));
+}
+
+void CGovernanceVoteDB::EraseVotes(const std::vector<uint256>& vecHashes)
+{
+    if (vecHashes.empty()) {
+        return;
+    }
+    CDBBatch batch(db);
+    for (const auto& nHash : vecHashes) {
+        batch.Erase(std::make_pair(DB_GOVERNANCE_VOTE, nHash));
+    }
+    db.WriteBatch(batch);
+}
+
+size_t CGovernanceVoteDB::EraseVotesIf(const std::function<bool(const uint256& nHash, const CGovernanceVote& vote)>& fKeep)
+{
+    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+
+    auto firstKey = std::make_pair(DB_GOVERNANCE_VOTE, uint256());
+    it->Seek(firstKey);
+
+    CDBBatch batch(db);
+    size_t nErased = 0;
+    while (it->Valid()) {
+        decltype(firstKey) curKey;
+        if (!it->GetKey(curKey) || curKey.first != DB_GOVERNANCE_VOTE) {
+            break;
+        }
+        CGovernanceVote vote;
+        if (!it->GetValue(vote) || !fKeep(curKey.second, vote)) {
+            batch.Erase(curKey);
+            ++nErased;
+        }
+        if (batch.SizeEstimate() > (1 << 20)) {
+            db.WriteBatch(batch);
+            batch.Clear();
+        }
+        it->Next();
+    }
+    db.WriteBatch(batch);
+
+    return nErased;
+}
+
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile() :
-    nMemoryVotes(0),
-    listVotes(),
-    mapVoteIndex()
+    mapVoteIndex(),
+    fDiskOwner(false)
 {
 }
 
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other) :
-    nMemoryVotes(other.nMemoryVotes),
-    listVotes(other.listVotes),
-    mapVoteIndex()
+    mapVoteIndex(other.mapVoteIndex),
+    fDiskOwner(false)
 {
-    RebuildIndex();
 }
 
 void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
@@ -25,12 +104,27 @@ void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
     // make sure to never add/update already known votes
     if (HasVote(nHash))
         return;
-    listVotes.push_front(vote);
-    mapVoteIndex.emplace(nHash, listVotes.begin());
-    ++nMemoryVotes;
+    VoteDB().WriteVote(vote);
+    mapVoteIndex.emplace(nHash, vote_summary_t(vote));
     RemoveOldVotes(vote);
 }
 
+bool CGovernanceObjectVoteFile::RestoreVote(const CGovernanceVote& vote)
+{
+    for (const auto& p : mapVoteIndex) {
+        if (p.second.masternodeOutpoint == vote.GetMasternodeOutpoint()
+            && p.second.nSignal == vote.GetSignal()
+            && p.second.nTime > vote.GetTimestamp()) {
+            // replaced by a newer vote
+            return false;
+        }
+    }
+    if (mapVoteIndex.emplace(vote.GetHash(), vote_summary_t(vote)).second) {
+        RemoveOldVotes(vote);
+    }
+    return true;
+}
+
 bool CGovernanceObjectVoteFile::HasVote(const uint256& nHash) const
 {
     return mapVoteIndex.find(nHash) != mapVoteIndex.end();
@@ -38,91 +132,125 @@ bool CGovernanceObjectVoteFile::HasVote(const uint256& nHash) const
 
 bool CGovernanceObjectVoteFile::SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const
 {
-    vote_m_cit it = mapVoteIndex.find(nHash);
-    if (it == mapVoteIndex.end()) {
+    if (!HasVote(nHash)) {
+        return false;
+    }
+    CGovernanceVote vote;
+    if (!VoteDB().ReadVote(nHash, vote)) {
         return false;
     }
-    ss << *(it->second);
+    ss << vote;
     return true;
 }
 
 std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
 {
     std::vector<CGovernanceVote> vecResult;
-    for (vote_l_cit it = listVotes.begin(); it != listVotes.end(); ++it) {
-        vecResult.push_back(*it);
+    vecResult.reserve(mapVoteIndex.size());
+    for (const auto& p : mapVoteIndex) {
+        CGovernanceVote vote;
+        if (VoteDB().ReadVote(p.first, vote)) {
+            vecResult.push_back(vote);
+        }
+    }
+    return vecResult;
+}
+
+std::vector<uint256> CGovernanceObjectVoteFile::GetVoteHashes() const
+{
+    std::vector<uint256> vecResult;
+    vecResult.reserve(mapVoteIndex.size());
+    for (const auto& p : mapVoteIndex) {
+        vecResult.push_back(p.first);
     }
     return vecResult;
 }
 
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == outpointMasternode) {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
+    std::vector<uint256> vecErased;
+    vote_m_it it = mapVoteIndex.begin();
+    while (it != mapVoteIndex.end()) {
+        if (it->second.masternodeOutpoint == outpointMasternode) {
+            vecErased.push_back(it->first);
+            mapVoteIndex.erase(it++);
         } else {
             ++it;
         }
     }
+    EraseFromDisk(vecErased);
 }
 
 std::set<uint256> CGovernanceObjectVoteFile::RemoveInvalidVotes(const COutPoint& outpointMasternode, bool fProposal)
 {
     std::set<uint256> removedVotes;
 
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == outpointMasternode) {
-            bool useVotingKey = fProposal && (it->GetSignal() == VOTE_SIGNAL_FUNDING);
-            if (!it->IsValid(useVotingKey)) {
-                removedVotes.emplace(it->GetHash());
-                --nMemoryVotes;
-                mapVoteIndex.erase(it->GetHash());
-                listVotes.erase(it++);
+    vote_m_it it = mapVoteIndex.begin();
+    while (it != mapVoteIndex.end()) {
+        if (it->second.masternodeOutpoint == outpointMasternode) {
+            CGovernanceVote vote;
+            // votes which are missing on disk can't be relayed anymore, treat them as invalid
+            bool fValid = VoteDB().ReadVote(it->first, vote);
+            if (fValid) {
+                bool useVotingKey = fProposal && (vote.GetSignal() == VOTE_SIGNAL_FUNDING);
+                fValid = vote.IsValid(useVotingKey);
+            }
+            if (!fValid) {
+                removedVotes.emplace(it->first);
+                mapVoteIndex.erase(it++);
                 continue;
             }
         }
         ++it;
     }
 
+    EraseFromDisk(std::vector<uint256>(removedVotes.begin(), removedVotes.end()));
     return removedVotes;
 }
 
-void CGovernanceObjectVoteFile::RemoveOldVotes(const CGovernanceVote& vote)
+void CGovernanceObjectVoteFile::EraseAll()
 {
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        if (it->GetMasternodeOutpoint() == vote.GetMasternodeOutpoint() // same masternode
-            && it->GetParentHash() == vote.GetParentHash() // same governance object (e.g. same proposal)
-            && it->GetSignal() == vote.GetSignal() // same signal (e.g. "funding", "delete", etc.)
-            && it->GetTimestamp() < vote.GetTimestamp()) // older than new vote
-        {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
+    EraseFromDisk(GetVoteHashes());
+    mapVoteIndex.clear();
+}
+
+size_t CGovernanceObjectVoteFile::RemoveMissingVotes()
+{
+    size_t nRemoved = 0;
+    vote_m_it it = mapVoteIndex.begin();
+    while (it != mapVoteIndex.end()) {
+        if (!VoteDB().HaveVote(it->first)) {
+            mapVoteIndex.erase(it++);
+            ++nRemoved;
         } else {
             ++it;
         }
     }
+    return nRemoved;
 }
 
-void CGovernanceObjectVoteFile::RebuildIndex()
+void CGovernanceObjectVoteFile::RemoveOldVotes(const CGovernanceVote& vote)
 {
-    mapVoteIndex.clear();
-    nMemoryVotes = 0;
-    vote_l_it it = listVotes.begin();
-    while (it != listVotes.end()) {
-        CGovernanceVote& vote = *it;
-        uint256 nHash = vote.GetHash();
-        if (mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
-            mapVoteIndex[nHash] = it;
-            ++nMemoryVotes;
-            ++it;
+    std::vector<uint256> vecErased;
+    vote_m_it it = mapVoteIndex.begin();
+    while (it != mapVoteIndex.end()) {
+        if (it->second.masternodeOutpoint == vote.GetMasternodeOutpoint() // same masternode
+            && it->second.nSignal == vote.GetSignal() // same signal (e.g. "funding", "delete", etc.)
+            && it->second.nTime < vote.GetTimestamp()) // older than new vote
+        {
+            // all votes in this file belong to the same governance object (e.g. same proposal)
+            vecErased.push_back(it->first);
+            mapVoteIndex.erase(it++);
         } else {
-            listVotes.erase(it++);
+            ++it;
         }
     }
+    EraseFromDisk(vecErased);
+}
+
+void CGovernanceObjectVoteFile::EraseFromDisk(const std::vector<uint256>& vecHashes)
+{
+    if (fDiskOwner) {
+        VoteDB().EraseVotes(vecHashes);
+    }
 }
@@ -5,48 +5,105 @@
 #ifndef GOVERNANCE_VOTEDB_H
 #define GOVERNANCE_VOTEDB_H
 
-#include <list>
+#include <functional>
 #include <map>
+#include <memory>
+#include <set>
 
+#include <dbwrapper.h>
 #include <governance/governance-vote.h>
 #include <serialize.h>
 #include <streams.h>
 #include <uint256.h>
 
 /**
- * Represents the collection of votes associated with a given CGovernanceObject
- * Recently received votes are held in memory until a maximum size is reached after
- * which older votes a flushed to a disk file.
+ * On-disk storage for governance votes, keyed by vote hash.
  *
- * Note: This is a stub implementation that doesn't limit the number of votes held
- * in memory and doesn't flush to disk.
+ * Full votes (including signatures) only live here. Governance objects keep a
+ * small per-vote summary in memory (see CGovernanceObjectVoteFile) and load
+ * the actual votes lazily when they need to be relayed or shown via RPC.
+ */
+class CGovernanceVoteDB
+{
+private:
+    CDBWrapper db;
+
+public:
+    CGovernanceVoteDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    void WriteVote(const CGovernanceVote& vote);
+    bool ReadVote(const uint256& nHash, CGovernanceVote& vote) const;
+    bool HaveVote(const uint256& nHash) const;
+    void EraseVote(const uint256& nHash);
+    void EraseVotes(const std::vector<uint256>& vecHashes);
+
+    /// Call fKeep for every vote on disk and erase the votes it returns false for. Returns the number of erased votes.
+    size_t EraseVotesIf(const std::function<bool(const uint256& nHash, const CGovernanceVote& vote)>& fKeep);
+};
+
+extern std::unique_ptr<CGovernanceVoteDB> governanceVoteDb;
+
+/**
+ * Represents the collection of votes associated with a given CGovernanceObject
+ * Only a compact summary of each vote is held in memory, the votes themselves
+ * are stored in governanceVoteDb and read back on demand.
  */
 class CGovernanceObjectVoteFile
 {
 public: // Types
-    typedef std::list<CGovernanceVote> vote_l_t;
+    struct vote_summary_t {
+        COutPoint masternodeOutpoint;
+        int nSignal;
+        int64_t nTime;
+
+        vote_summary_t() :
+            masternodeOutpoint(),
+            nSignal(VOTE_SIGNAL_NONE),
+            nTime(0)
+        {
+        }
 
-    typedef vote_l_t::iterator vote_l_it;
+        explicit vote_summary_t(const CGovernanceVote& vote) :
+            masternodeOutpoint(vote.GetMasternodeOutpoint()),
+            nSignal(vote.GetSignal()),
+            nTime(vote.GetTimestamp())
+        {
+        }
 
-    typedef vote_l_t::const_iterator vote_l_cit;
+        ADD_SERIALIZE_METHODS;
 
-    typedef std::map<uint256, vote_l_it> vote_m_t;
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action)
+        {
+            READWRITE(masternodeOutpoint);
+            READWRITE(nSignal);
+            READWRITE(nTime);
+        }
+    };
+
+    typedef std::map<uint256, vote_summary_t> vote_m_t;
 
     typedef vote_m_t::iterator vote_m_it;
 
     typedef vote_m_t::const_iterator vote_m_cit;
 
 private:
-    int nMemoryVotes;
-
-    vote_l_t listVotes;
-
     vote_m_t mapVoteIndex;
+    /// Whether this file erases the votes it drops from disk. All copies of a file reference the same votes on disk, so
+    /// only one of them, the one of the object in CGovernanceManager::mapObjects, may erase them. Every other file is
+    /// a view of the index which leaves the votes it drops on disk.
+    bool fDiskOwner;
 
 public:
     CGovernanceObjectVoteFile();
 
+    /// Copies are views, see fDiskOwner
     CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other);
+    CGovernanceObjectVoteFile& operator=(const CGovernanceObjectVoteFile&) = delete;
+
+    /// Make this file the one which erases its votes from disk
+    void SetDiskOwner() { fDiskOwner = true; }
+    bool IsDiskOwner() const { return fDiskOwner; }
 
     /**
      * Add a vote to the file
@@ -54,42 +111,55 @@ public:
     void AddVote(const CGovernanceVote& vote);
 
     /**
-     * Return true if the vote with this hash is currently cached in memory
+     * Add a vote which is already on disk to the index, used to recover votes after an unclean shutdown.
+     * Returns false if the file holds a newer vote of the masternode for the same signal.
+     */
+    bool RestoreVote(const CGovernanceVote& vote);
+
+    /**
+     * Return true if the vote with this hash is known
      */
     bool HasVote(const uint256& nHash) const;
 
     /**
-     * Retrieve a vote cached in memory
+     * Retrieve a vote from disk
      */
     bool SerializeVoteToStream(const uint256& nHash, CDataStream& ss) const;
 
-    int GetVoteCount()
+    int GetVoteCount() const
     {
-        return nMemoryVotes;
+        return (int)mapVoteIndex.size();
     }
 
+    /**
+     * Load all votes from disk. Votes which can't be found on disk are skipped.
+     */
     std::vector<CGovernanceVote> GetVotes() const;
 
+    std::vector<uint256> GetVoteHashes() const;
+
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
     std::set<uint256> RemoveInvalidVotes(const COutPoint& outpointMasternode, bool fProposal);
 
+    /// Remove all votes of this file, and from disk if this file owns them, called when the governance object is erased
+    void EraseAll();
+
+    /// Drop the index entries of votes which are not on disk. Returns the number of dropped entries.
+    size_t RemoveMissingVotes();
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
-        READWRITE(nMemoryVotes);
-        READWRITE(listVotes);
-        if (ser_action.ForRead()) {
-            RebuildIndex();
-        }
+        READWRITE(mapVoteIndex);
     }
 
 private:
     // Drop older votes for the same gobject from the same masternode
     void RemoveOldVotes(const CGovernanceVote& vote);
 
-    void RebuildIndex();
+    void EraseFromDisk(const std::vector<uint256>& vecHashes);
 };
 
 #endif
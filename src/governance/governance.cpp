@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <governance/governance.h>
+#include <bls/bls_batchverifier.h>
 #include <consensus/validation.h>
 #include <governance/governance-classes.h>
 #include <governance/governance-object.h>
@@ -19,17 +20,30 @@
 #include <shutdown.h>
 #include <util/init.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 #include <validation.h>
 #include <validationinterface.h>
 
+#include <algorithm>
+
 CGovernanceManager governance;
 
 int nSubmittedFinalBudget;
 
-const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-15";
+const std::string CGovernanceManager::SERIALIZATION_VERSION_STRING = "CGovernanceManager-Version-16";
 const int CGovernanceManager::MAX_TIME_FUTURE_DEVIATION = 60 * 60;
 const int CGovernanceManager::RELIABLE_PROPAGATION_TIME = 60;
 
+// Record types of governance.log
+static const char LOG_OBJECT = 'o';
+static const char LOG_OBJECT_ERASED = 'e';
+static const char LOG_VOTE = 'v';
+static const char LOG_ERASED_OBJECTS = 'x';
+static const char LOG_INVALID_VOTES = 'i';
+static const char LOG_ORPHAN_VOTES = 'r';
+static const char LOG_LAST_OBJECTS = 'l';
+static const char LOG_VOTING_KEYS = 'k';
+
 CGovernanceManager::CGovernanceManager() :
     nTimeLastDiff(0),
     nCachedBlockHeight(0),
@@ -41,6 +55,7 @@ CGovernanceManager::CGovernanceManager() :
     mapLastMasternodeObject(),
     setRequestedObjects(),
     fRateChecksEnabled(true),
+    nDirtyState(0),
     cs()
 {
 }
@@ -236,6 +251,23 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
             return;
         }
 
+        // Votes for known objects are queued and their signatures verified in batches by the worker thread.
+        // Everything else (orphan, known or invalid votes) is cheap to handle and done right away.
+        bool fQueueVote;
+        {
+            LOCK(cs);
+            fQueueVote = workThread.joinable() && mapObjects.count(vote.GetParentHash()) &&
+                         !cmapVoteToObject.HasKey(nHash) && !cmapInvalidVotes.HasKey(nHash);
+        }
+        if (fQueueVote) {
+            LOCK(cs_pendingVotes);
+            // when the worker falls behind, votes are verified one by one here instead of piling up
+            if (vecPendingVotes.size() < MAX_PENDING_VOTES) {
+                vecPendingVotes.emplace_back(pfrom->AddRef(), vote);
+                return;
+            }
+        }
+
         CGovernanceException exception;
         if (ProcessVote(pfrom, vote, exception, connman)) {
             LogPrint(BCLog::GOBJECT, "MNGOVERNANCEOBJECTVOTE -- %s new\n", strHash);
@@ -263,18 +295,38 @@ void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CGovernance
     ScopedLockBool guard(cs, fRateChecksEnabled, false);
 
     int64_t nNow = GetAdjustedTime();
+
+    // verify signatures of all orphan votes for this object in bulk
+    std::vector<std::pair<CGovernanceVote, bool>> vecToVerify;
+    for (const auto& pairVote : vecVotePairs) {
+        if (pairVote.second >= nNow) {
+            const CGovernanceVote& vote = pairVote.first;
+            bool onlyVotingKeyAllowed = govobj.GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
+            vecToVerify.emplace_back(vote, onlyVotingKeyAllowed);
+        }
+    }
+    std::vector<VoteSigResult> vecResults;
+    VerifyVoteSignatures(deterministicMNManager->GetListAtChainTip(), vecToVerify, vecResults);
+
+    size_t nVerified = 0;
     for (auto& pairVote : vecVotePairs) {
         bool fRemove = false;
         CGovernanceVote& vote = pairVote.first;
         CGovernanceException exception;
         if (pairVote.second < nNow) {
             fRemove = true;
-        } else if (govobj.ProcessVote(nullptr, vote, exception, connman)) {
+        } else if (vecResults[nVerified++] == VOTE_SIG_INVALID) {
+            // not added to cmapInvalidVotes, a copy of the vote with a valid signature may still arrive
+            LogPrint(BCLog::GOBJECT, "CGovernanceManager::%s -- invalid signature for orphan vote %s\n", __func__, vote.GetHash().ToString());
+            fRemove = true;
+        } else if (govobj.ProcessVote(nullptr, vote, exception, connman, vecResults[nVerified - 1] == VOTE_SIG_VALID)) {
+            vecDirtyVotes.push_back(vote);
             vote.Relay(connman);
             fRemove = true;
         }
         if (fRemove) {
             cmmapOrphanVotes.Erase(nHash, pairVote);
+            nDirtyState |= DIRTY_ORPHAN_VOTES;
         }
     }
 }
@@ -308,6 +360,8 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
         LogPrintf("CGovernanceManager::AddGovernanceObject -- already have governance object %s\n", nHash.ToString());
         return;
     }
+    objpair.first->second.SetVoteFileDiskOwner();
+    setDirtyObjects.insert(nHash);
 
     // SHOULD WE ADD THIS OBJECT TO ANY OTHER MANANGERS?
 
@@ -339,6 +393,25 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
     GetMainSignals().NotifyGovernanceObject(govobj);
 }
 
+void CGovernanceManager::Clear()
+{
+    LOCK(cs);
+
+    LogPrint(BCLog::GOBJECT, "Governance object manager was cleared\n");
+    for (const auto& objPair : mapObjects) {
+        setDirtyObjects.insert(objPair.first);
+    }
+    vecDirtyVotes.clear();
+    nDirtyState = DIRTY_ALL;
+    mapObjects.clear();
+    mapErasedGovernanceObjects.clear();
+    cmapVoteToObject.Clear();
+    cmapInvalidVotes.Clear();
+    cmmapOrphanVotes.Clear();
+    mapLastMasternodeObject.clear();
+    triggerman.SetIndexDirty();
+}
+
 void CGovernanceManager::UpdateCachesAndClean()
 {
     // Return on initial sync, spammed the debug.log and provided no use
@@ -358,6 +431,7 @@ void CGovernanceManager::UpdateCachesAndClean()
             continue;
         }
         it->second.ClearMasternodeVotes();
+        setDirtyObjects.insert(nHash);
     }
 
     ScopedLockBool guard(cs, fRateChecksEnabled, false);
@@ -399,6 +473,7 @@ void CGovernanceManager::UpdateCachesAndClean()
             (nTimeSinceDeletion >= GOVERNANCE_DELETION_DELAY)) {
             LogPrintf("CGovernanceManager::UpdateCachesAndClean -- erase obj %s\n", (*it).first.ToString());
             mmetaman.RemoveGovernanceObject(pObj->GetHash());
+            pObj->EraseVotes();
 
             // Remove vote references
             const object_ref_cm_t::list_t& listItems = cmapVoteToObject.GetItemList();
@@ -424,6 +499,11 @@ void CGovernanceManager::UpdateCachesAndClean()
             }
 
             mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
+            setDirtyObjects.insert(nHash);
+            nDirtyState |= DIRTY_ERASED_OBJECTS;
+            if (pObj->GetObjectType() == GOVERNANCE_OBJECT_TRIGGER) {
+                triggerman.SetIndexDirty();
+            }
             mapObjects.erase(it++);
         } else {
             // NOTE: triggers are handled via triggerman
@@ -432,6 +512,7 @@ void CGovernanceManager::UpdateCachesAndClean()
                 if (!validator.Validate()) {
                     LogPrintf("CGovernanceManager::UpdateCachesAndClean -- set for deletion expired obj %s\n", strHash);
                     pObj->PrepareDeletion(nNow);
+                    setDirtyObjects.insert(nHash);
                 }
             }
             ++it;
@@ -443,6 +524,7 @@ void CGovernanceManager::UpdateCachesAndClean()
     while (s_it != mapErasedGovernanceObjects.end()) {
         if (s_it->second < nNow) {
             mapErasedGovernanceObjects.erase(s_it++);
+            nDirtyState |= DIRTY_ERASED_OBJECTS;
         } else {
             ++s_it;
         }
@@ -633,7 +715,7 @@ void CGovernanceManager::SyncSingleObjVotes(CNode* pnode, const uint256& nProp,
         return;
     }
 
-    auto fileVotes = govobj.GetVoteFile();
+    const auto& fileVotes = govobj.GetVoteFile();
 
     for (const auto& vote : fileVotes.GetVotes()) {
         uint256 nVoteHash = vote.GetHash();
@@ -712,6 +794,7 @@ void CGovernanceManager::MasternodeRateUpdate(const CGovernanceObject& govobj)
 
     int64_t nTimestamp = govobj.GetCreationTime();
     it->second.triggerBuffer.AddTimestamp(nTimestamp);
+    nDirtyState |= DIRTY_LAST_OBJECTS;
 
     if (nTimestamp > GetTime() + MAX_TIME_FUTURE_DEVIATION - RELIABLE_PROPAGATION_TIME) {
         // schedule additional relay for the object
@@ -786,12 +869,13 @@ bool CGovernanceManager::MasternodeRateCheck(const CGovernanceObject& govobj, bo
 
     if (fUpdateFailStatus) {
         it->second.fStatusOK = false;
+        nDirtyState |= DIRTY_LAST_OBJECTS;
     }
 
     return false;
 }
 
-bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman)
+bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman, bool fSignatureVerified)
 {
     ENTER_CRITICAL_SECTION(cs);
     uint256 nHashVote = vote.GetHash();
@@ -821,6 +905,7 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
              << ", MN outpoint = " << vote.GetMasternodeOutpoint().ToStringShort();
         exception = CGovernanceException(ostr.str(), GOVERNANCE_EXCEPTION_WARNING);
         if (cmmapOrphanVotes.Insert(nHashGovobj, vote_time_pair_t(vote, GetAdjustedTime() + GOVERNANCE_ORPHAN_EXPIRATION_TIME))) {
+            nDirtyState |= DIRTY_ORPHAN_VOTES;
             LEAVE_CRITICAL_SECTION(cs);
             RequestGovernanceObject(pfrom, nHashGovobj, connman);
             LogPrintf("%s\n", ostr.str());
@@ -840,11 +925,209 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
         return false;
     }
 
-    bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman) && cmapVoteToObject.Insert(nHashVote, &govobj);
+    bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman, fSignatureVerified);
+    if (fOk) {
+        vecDirtyVotes.push_back(vote);
+        fOk = cmapVoteToObject.Insert(nHashVote, &govobj);
+    }
     LEAVE_CRITICAL_SECTION(cs);
     return fOk;
 }
 
+void CGovernanceManager::VerifyVoteSignatures(const CDeterministicMNList& mnList, const std::vector<std::pair<CGovernanceVote, bool>>& vecVotes, std::vector<VoteSigResult>& vecResults)
+{
+    vecResults.assign(vecVotes.size(), VOTE_SIG_UNCHECKED);
+    if (vecVotes.empty()) {
+        return;
+    }
+
+    // messages are identified by their index, the batch verifier only keeps one message per id
+    CBLSBatchVerifier<size_t, size_t> batchVerifier(false, true);
+    std::vector<std::pair<size_t, CKeyID>> vecECDSA;
+    std::vector<size_t> vecBLS;
+
+    for (size_t i = 0; i < vecVotes.size(); i++) {
+        const CGovernanceVote& vote = vecVotes[i].first;
+        auto dmn = mnList.GetMNByCollateral(vote.GetMasternodeOutpoint());
+        if (!dmn) {
+            continue;
+        }
+        if (vecVotes[i].second) {
+            vecECDSA.emplace_back(i, dmn->pdmnState->keyIDVoting);
+            continue;
+        }
+        CBLSSignature sig;
+        sig.SetBuf(vote.GetSignature());
+        const CBLSPublicKey& pubKey = dmn->pdmnState->pubKeyOperator.Get();
+        if (!sig.IsValid() || !pubKey.IsValid()) {
+            vecResults[i] = VOTE_SIG_INVALID;
+            continue;
+        }
+        batchVerifier.PushMessage(i, i, vote.GetSignatureHash(), sig, pubKey);
+        vecBLS.emplace_back(i);
+    }
+
+    // spread ECDSA verification over the worker pool, in chunks to keep the queue overhead low
+    static const size_t ECDSA_CHUNK_SIZE = 64;
+    auto verifyChunk = [&](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd; i++) {
+            const CGovernanceVote& vote = vecVotes[vecECDSA[i].first].first;
+            vecResults[vecECDSA[i].first] = vote.CheckSignature(vecECDSA[i].second) ? VOTE_SIG_VALID : VOTE_SIG_INVALID;
+        }
+    };
+    std::vector<std::future<void>> futures;
+    for (size_t i = 0; i < vecECDSA.size(); i += ECDSA_CHUNK_SIZE) {
+        size_t nEnd = std::min(i + ECDSA_CHUNK_SIZE, vecECDSA.size());
+        if (verifyWorkerPool.size() == 0 || nEnd == vecECDSA.size()) {
+            // no pool available or last chunk, do it while the pool works on the other chunks
+            verifyChunk(i, nEnd);
+        } else {
+            futures.emplace_back(verifyWorkerPool.push([&verifyChunk, i, nEnd](int) { verifyChunk(i, nEnd); }));
+        }
+    }
+
+    batchVerifier.Verify();
+
+    for (auto& f : futures) {
+        f.get();
+    }
+
+    for (size_t i : vecBLS) {
+        vecResults[i] = batchVerifier.badMessages.count(i) ? VOTE_SIG_INVALID : VOTE_SIG_VALID;
+    }
+}
+
+bool CGovernanceManager::ProcessPendingVotes(CConnman& connman)
+{
+    std::vector<std::pair<CNode*, CGovernanceVote>> vecPend;
+    {
+        LOCK(cs_pendingVotes);
+        vecPend.swap(vecPendingVotes);
+    }
+
+    if (vecPend.empty()) {
+        return false;
+    }
+
+    // votes whose object is gone in the meantime stay unchecked and are handled by ProcessVote
+    std::vector<std::pair<CGovernanceVote, bool>> vecToVerify;
+    std::vector<size_t> vecPendIndex;
+    vecToVerify.reserve(vecPend.size());
+    {
+        LOCK(cs);
+        for (size_t i = 0; i < vecPend.size(); i++) {
+            const CGovernanceVote& vote = vecPend[i].second;
+            auto it = mapObjects.find(vote.GetParentHash());
+            if (it == mapObjects.end()) {
+                continue;
+            }
+            bool onlyVotingKeyAllowed = it->second.GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
+            vecToVerify.emplace_back(vote, onlyVotingKeyAllowed);
+            vecPendIndex.emplace_back(i);
+        }
+    }
+
+    std::vector<VoteSigResult> vecVerified;
+    VerifyVoteSignatures(deterministicMNManager->GetListAtChainTip(), vecToVerify, vecVerified);
+    std::vector<VoteSigResult> vecResults(vecPend.size(), VOTE_SIG_UNCHECKED);
+    for (size_t i = 0; i < vecPendIndex.size(); i++) {
+        vecResults[vecPendIndex[i]] = vecVerified[i];
+    }
+
+    LogPrint(BCLog::GOBJECT, "CGovernanceManager::%s -- verified %d votes, %d invalid\n", __func__, vecPend.size(),
+        std::count(vecResults.begin(), vecResults.end(), VOTE_SIG_INVALID));
+
+    for (size_t i = 0; i < vecPend.size(); i++) {
+        CNode* pfrom = vecPend[i].first;
+        const CGovernanceVote& vote = vecPend[i].second;
+        uint256 nHash = vote.GetHash();
+
+        CGovernanceException exception;
+        if (vecResults[i] == VOTE_SIG_INVALID) {
+            // only the sender is punished, the vote isn't added to cmapInvalidVotes as copies of it with
+            // a valid signature share its hash
+            std::ostringstream ostr;
+            ostr << "CGovernanceManager::ProcessPendingVotes -- Invalid vote signature"
+                 << ", MN outpoint = " << vote.GetMasternodeOutpoint().ToStringShort()
+                 << ", governance object hash = " << vote.GetParentHash().ToString()
+                 << ", vote hash = " << nHash.ToString();
+            LogPrintf("%s\n", ostr.str());
+            exception = CGovernanceException(ostr.str(), GOVERNANCE_EXCEPTION_PERMANENT_ERROR, 20);
+        } else if (ProcessVote(pfrom, vote, exception, connman, vecResults[i] == VOTE_SIG_VALID)) {
+            LogPrint(BCLog::GOBJECT, "MNGOVERNANCEOBJECTVOTE -- %s new\n", nHash.ToString());
+            masternodeSync.BumpAssetLastTime("MNGOVERNANCEOBJECTVOTE");
+            vote.Relay(connman);
+            // SEND NOTIFICATION TO SCRIPT/ZMQ
+            GetMainSignals().NotifyGovernanceVote(vote);
+            pfrom->Release();
+            continue;
+        }
+
+        LogPrint(BCLog::GOBJECT, "MNGOVERNANCEOBJECTVOTE -- Rejected vote, error = %s\n", exception.what());
+        if ((exception.GetNodePenalty() != 0) && masternodeSync.IsSynced()) {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), exception.GetNodePenalty());
+        }
+        pfrom->Release();
+    }
+
+    return true;
+}
+
+void CGovernanceManager::StartWorkerThread()
+{
+    // can't start new thread if we have one running already
+    if (workThread.joinable()) {
+        assert(false);
+    }
+
+    verifyWorkerPool.resize(std::max(1, std::min(GetNumCores() - 1, 4)));
+    RenameThreadPool(verifyWorkerPool, "bitgreen-gov-verify");
+
+    workThread = std::thread(&TraceThread<std::function<void()> >,
+        "govvotes",
+        std::function<void()>(std::bind(&CGovernanceManager::WorkThreadMain, this)));
+}
+
+void CGovernanceManager::StopWorkerThread()
+{
+    // make sure to call InterruptWorkerThread() first
+    if (!workInterrupt) {
+        assert(false);
+    }
+
+    if (workThread.joinable()) {
+        workThread.join();
+    }
+
+    verifyWorkerPool.clear_queue();
+    verifyWorkerPool.stop(true);
+
+    LOCK(cs_pendingVotes);
+    for (auto& p : vecPendingVotes) {
+        p.first->Release();
+    }
+    vecPendingVotes.clear();
+}
+
+void CGovernanceManager::InterruptWorkerThread()
+{
+    workInterrupt();
+}
+
+void CGovernanceManager::WorkThreadMain()
+{
+    while (!workInterrupt) {
+        bool didWork = ProcessPendingVotes(*g_connman);
+
+        if (!didWork) {
+            if (!workInterrupt.sleep_for(std::chrono::milliseconds(100))) {
+                return;
+            }
+        }
+    }
+}
+
 void CGovernanceManager::CheckPostponedObjects(CConnman& connman)
 {
     if (!masternodeSync.IsSynced()) return;
@@ -935,10 +1218,10 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
 
         if (pObj) {
             filter = CBloomFilter(Params().GetConsensus().nGovernanceFilterElements, GOVERNANCE_FILTER_FP_RATE, GetRandInt(999999), BLOOM_UPDATE_ALL);
-            std::vector<CGovernanceVote> vecVotes = pObj->GetVoteFile().GetVotes();
-            nVoteCount = vecVotes.size();
-            for (const auto& vote : vecVotes) {
-                filter.insert(vote.GetHash());
+            std::vector<uint256> vecVoteHashes = pObj->GetVoteFile().GetVoteHashes();
+            nVoteCount = vecVoteHashes.size();
+            for (const auto& nVoteHash : vecVoteHashes) {
+                filter.insert(nVoteHash);
             }
         }
     }
@@ -1091,10 +1374,49 @@ void CGovernanceManager::RebuildIndexes()
     cmapVoteToObject.Clear();
     for (auto& objPair : mapObjects) {
         CGovernanceObject& govobj = objPair.second;
-        std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-        for (size_t i = 0; i < vecVotes.size(); ++i) {
-            cmapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
+        for (const auto& nVoteHash : govobj.GetVoteFile().GetVoteHashes()) {
+            cmapVoteToObject.Insert(nVoteHash, &govobj);
+        }
+    }
+}
+
+void CGovernanceManager::ReconcileVoteDB()
+{
+    LOCK(cs);
+
+    // votes are written to disk as they arrive while the vote index is only dumped periodically and on shutdown,
+    // so after an unclean shutdown the index can miss votes which are on disk and list votes which were erased
+    size_t nMissing = 0;
+    std::set<uint256> setReferenced;
+    for (auto& objPair : mapObjects) {
+        size_t nRemoved = objPair.second.RemoveMissingVotes();
+        if (nRemoved) {
+            setDirtyObjects.insert(objPair.first);
+            nMissing += nRemoved;
         }
+        for (const auto& nVoteHash : objPair.second.GetVoteFile().GetVoteHashes()) {
+            setReferenced.emplace(nVoteHash);
+        }
+    }
+
+    // only accepted votes are written to disk, so the votes of known objects can be restored without validation
+    size_t nRestored = 0;
+    assert(governanceVoteDb);
+    size_t nErased = governanceVoteDb->EraseVotesIf([&](const uint256& nVoteHash, const CGovernanceVote& vote) {
+        if (setReferenced.count(nVoteHash)) {
+            return true;
+        }
+        auto it = mapObjects.find(vote.GetParentHash());
+        if (it == mapObjects.end() || !it->second.RestoreVote(vote)) {
+            return false;
+        }
+        cmapVoteToObject.Insert(nVoteHash, &it->second);
+        setDirtyObjects.insert(it->first);
+        ++nRestored;
+        return true;
+    });
+    if (nMissing || nRestored || nErased) {
+        LogPrintf("CGovernanceManager::%s -- dropped %d missing, restored %d and erased %d unreferenced votes\n", __func__, nMissing, nRestored, nErased);
     }
 }
 
@@ -1111,8 +1433,112 @@ void CGovernanceManager::AddCachedTriggers()
 
         if (!triggerman.AddNewTrigger(govobj.GetHash())) {
             govobj.PrepareDeletion(GetAdjustedTime());
+            setDirtyObjects.insert(objpair.first);
+        }
+    }
+}
+
+void CGovernanceManager::GetLogRecords(std::vector<std::vector<unsigned char>>& vRecords)
+{
+    LOCK(cs);
+
+    auto addRecord = [&](char nType) {
+        vRecords.emplace_back();
+        CVectorWriter ss(SER_DISK, CLIENT_VERSION, vRecords.back(), 0);
+        ss << SERIALIZATION_VERSION_STRING << nType;
+        return ss;
+    };
+
+    for (const uint256& nHash : setDirtyObjects) {
+        auto it = mapObjects.find(nHash);
+        if (it == mapObjects.end()) {
+            addRecord(LOG_OBJECT_ERASED) << nHash;
+        } else {
+            addRecord(LOG_OBJECT) << nHash << it->second;
+        }
+    }
+    for (const auto& vote : vecDirtyVotes) {
+        // the votes of objects logged in full are part of their record
+        if (!setDirtyObjects.count(vote.GetParentHash())) {
+            addRecord(LOG_VOTE) << vote;
         }
     }
+    if (nDirtyState & DIRTY_ERASED_OBJECTS) {
+        addRecord(LOG_ERASED_OBJECTS) << mapErasedGovernanceObjects;
+    }
+    if (nDirtyState & DIRTY_INVALID_VOTES) {
+        addRecord(LOG_INVALID_VOTES) << cmapInvalidVotes;
+    }
+    if (nDirtyState & DIRTY_ORPHAN_VOTES) {
+        addRecord(LOG_ORPHAN_VOTES) << cmmapOrphanVotes;
+    }
+    if (nDirtyState & DIRTY_LAST_OBJECTS) {
+        addRecord(LOG_LAST_OBJECTS) << mapLastMasternodeObject;
+    }
+    if (nDirtyState & DIRTY_VOTING_KEYS) {
+        addRecord(LOG_VOTING_KEYS) << lastMNListForVotingKeys;
+    }
+
+    setDirtyObjects.clear();
+    vecDirtyVotes.clear();
+    nDirtyState = 0;
+}
+
+void CGovernanceManager::ApplyLogRecord(const std::vector<unsigned char>& vRecord)
+{
+    LOCK(cs);
+
+    CDataStream ss(vRecord, SER_DISK, CLIENT_VERSION);
+    std::string strVersion;
+    ss >> strVersion;
+    if (strVersion != SERIALIZATION_VERSION_STRING) {
+        // written by another version, just like the checkpoint it belongs to
+        return;
+    }
+
+    char nType;
+    uint256 nHash;
+    ss >> nType;
+    switch (nType) {
+    case LOG_OBJECT: {
+        CGovernanceObject govobj;
+        ss >> nHash >> govobj;
+        mapObjects.erase(nHash);
+        mapObjects.emplace(nHash, govobj).first->second.SetVoteFileDiskOwner();
+        break;
+    }
+    case LOG_OBJECT_ERASED:
+        ss >> nHash;
+        mapObjects.erase(nHash);
+        break;
+    case LOG_VOTE: {
+        // only accepted votes are logged and they are already on disk, see ReconcileVoteDB
+        CGovernanceVote vote;
+        ss >> vote;
+        auto it = mapObjects.find(vote.GetParentHash());
+        if (it != mapObjects.end()) {
+            it->second.RestoreVote(vote);
+        }
+        break;
+    }
+    case LOG_ERASED_OBJECTS:
+        ss >> mapErasedGovernanceObjects;
+        break;
+    case LOG_INVALID_VOTES:
+        ss >> cmapInvalidVotes;
+        break;
+    case LOG_ORPHAN_VOTES:
+        ss >> cmmapOrphanVotes;
+        break;
+    case LOG_LAST_OBJECTS:
+        ss >> mapLastMasternodeObject;
+        break;
+    case LOG_VOTING_KEYS:
+        ss >> lastMNListForVotingKeys;
+        break;
+    default:
+        throw std::ios_base::failure(strprintf("unknown record type %d", nType));
+    }
 }
 
 void CGovernanceManager::InitOnLoad()
@@ -1120,8 +1546,13 @@ void CGovernanceManager::InitOnLoad()
     LOCK(cs);
     int64_t nStart = GetTimeMillis();
     LogPrintf("Preparing masternode indexes and governance triggers...\n");
+    // the objects were copied into mapObjects when it was read from disk
+    for (auto& objPair : mapObjects) {
+        objPair.second.SetVoteFileDiskOwner();
+    }
     RebuildIndexes();
     AddCachedTriggers();
+    ReconcileVoteDB();
     LogPrintf("Masternode indexes and governance triggers prepared  %dms\n", GetTimeMillis() - nStart);
     LogPrintf("     %s\n", ToString());
 }
@@ -1249,6 +1680,7 @@ void CGovernanceManager::CleanOrphanObjects()
         const vote_time_pair_t& pairVote = prevIt->value;
         if (pairVote.second < nNow) {
             cmmapOrphanVotes.Erase(prevIt->key, prevIt->value);
+            nDirtyState |= DIRTY_ORPHAN_VOTES;
         }
     }
 }
@@ -1284,6 +1716,8 @@ void CGovernanceManager::RemoveInvalidVotes()
             if (removed.empty()) {
                 continue;
             }
+            setDirtyObjects.insert(p.first);
+            nDirtyState |= DIRTY_INVALID_VOTES | DIRTY_ORPHAN_VOTES;
             for (auto& voteHash : removed) {
                 cmapVoteToObject.Erase(voteHash);
                 cmapInvalidVotes.Erase(voteHash);
@@ -1293,6 +1727,10 @@ void CGovernanceManager::RemoveInvalidVotes()
         }
     }
 
-    // store current MN list for the next run so that we can determine which keys changed
+    // store current MN list for the next run so that we can determine which keys changed. It is only logged
+    // when keys changed: replaying an older list just repeats the diff of masternodes whose keys did not change
     lastMNListForVotingKeys = curMNList;
+    if (!changedKeyMNs.empty()) {
+        nDirtyState |= DIRTY_VOTING_KEYS;
+    }
 }
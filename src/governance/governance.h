@@ -14,13 +14,17 @@
 #include <governance/governance-vote.h>
 #include <net.h>
 #include <sync.h>
+#include <threadinterrupt.h>
 #include <timedata.h>
 #include <util/system.h>
 
 #include <special/deterministicmns.h>
 
+#include <ctpl.h>
 #include <univalue.h>
 
+#include <thread>
+
 class CGovernanceManager;
 class CGovernanceTriggerManager;
 class CGovernanceObject;
@@ -40,6 +44,9 @@ typedef std::pair<CGovernanceObject, ExpirationInfo> object_info_pair_t;
 
 static const int RATE_BUFFER_SIZE = 5;
 
+/** Votes waiting for batched signature verification, further votes are processed right away */
+static const size_t MAX_PENDING_VOTES = 10000;
+
 class CRateCheckBuffer
 {
 private:
@@ -253,6 +260,31 @@ private:
     // used to check for changed voting keys
     CDeterministicMNList lastMNListForVotingKeys;
 
+    // Changes since the last checkpoint or log flush, appended to governance.log by GetLogRecords (see CFlatDB::Flush).
+    // Objects which were added, erased or changed other than by accepting a vote are logged in full, the votes
+    // accepted for the remaining objects one by one, and each part of the remaining state only when it was touched.
+    hash_s_t setDirtyObjects;
+    std::vector<CGovernanceVote> vecDirtyVotes;
+    int nDirtyState;
+
+    enum DirtyState {
+        DIRTY_ERASED_OBJECTS = 1 << 0,
+        DIRTY_INVALID_VOTES = 1 << 1,
+        DIRTY_ORPHAN_VOTES = 1 << 2,
+        DIRTY_LAST_OBJECTS = 1 << 3,
+        DIRTY_VOTING_KEYS = 1 << 4,
+        DIRTY_ALL = (1 << 5) - 1
+    };
+
+    // Incoming votes for known objects, their signatures are verified in batches by the worker thread.
+    // The peers are referenced (see CNode::AddRef) until their votes are processed.
+    CCriticalSection cs_pendingVotes;
+    std::vector<std::pair<CNode*, CGovernanceVote>> vecPendingVotes;
+
+    std::thread workThread;
+    CThreadInterrupt workInterrupt;
+    ctpl::thread_pool verifyWorkerPool;
+
     class ScopedLockBool
     {
         bool& ref;
@@ -307,18 +339,7 @@ public:
 
     void CheckAndRemove() { UpdateCachesAndClean(); }
 
-    void Clear()
-    {
-        LOCK(cs);
-
-        LogPrint(BCLog::GOBJECT, "Governance object manager was cleared\n");
-        mapObjects.clear();
-        mapErasedGovernanceObjects.clear();
-        cmapVoteToObject.Clear();
-        cmapInvalidVotes.Clear();
-        cmmapOrphanVotes.Clear();
-        mapLastMasternodeObject.clear();
-    }
+    void Clear();
 
     std::string ToString() const;
     UniValue ToJson() const;
@@ -397,6 +418,37 @@ public:
 
     void InitOnLoad();
 
+    enum VoteSigResult {
+        VOTE_SIG_UNCHECKED,
+        VOTE_SIG_VALID,
+        VOTE_SIG_INVALID
+    };
+
+    /**
+     * Verify signatures of many votes at once. Each vote is paired with a flag telling whether it has to be signed
+     * by the voting key (ECDSA) instead of the operator key (BLS). BLS signatures are checked in one batch, ECDSA
+     * signatures are spread over verifyWorkerPool. The result for each vote is stored at the same index of
+     * vecResults, as copies of a vote with different signatures share the same hash. Votes from masternodes
+     * missing in mnList are left unchecked and must be checked by ProcessVote as usual.
+     */
+    void VerifyVoteSignatures(const CDeterministicMNList& mnList, const std::vector<std::pair<CGovernanceVote, bool>>& vecVotes, std::vector<VoteSigResult>& vecResults);
+
+    /// Mark an object changed by someone else (e.g. the trigger manager) to be logged again by GetLogRecords
+    void SetObjectDirty(const uint256& nHash)
+    {
+        LOCK(cs);
+        setDirtyObjects.insert(nHash);
+    }
+
+    /// Append a record for every object, vote and part of the remaining state which changed since the last call, see CFlatDB::Flush
+    void GetLogRecords(std::vector<std::vector<unsigned char>>& vRecords);
+    /// Apply a record written by GetLogRecords
+    void ApplyLogRecord(const std::vector<unsigned char>& vRecord);
+
+    void StartWorkerThread();
+    void StopWorkerThread();
+    void InterruptWorkerThread();
+
     int RequestGovernanceObjectVotes(CNode* pnode, CConnman& connman);
     int RequestGovernanceObjectVotes(const std::vector<CNode*>& vNodesCopy, CConnman& connman);
 
@@ -406,9 +458,13 @@ private:
     void AddInvalidVote(const CGovernanceVote& vote)
     {
         cmapInvalidVotes.Insert(vote.GetHash(), vote);
+        nDirtyState |= DIRTY_INVALID_VOTES;
     }
 
-    bool ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman);
+    bool ProcessVote(CNode* pfrom, const CGovernanceVote& vote, CGovernanceException& exception, CConnman& connman, bool fSignatureVerified = false);
+
+    bool ProcessPendingVotes(CConnman& connman);
+    void WorkThreadMain();
 
     /// Called to indicate a requested object has been received
     bool AcceptObjectMessage(const uint256& nHash);
@@ -424,6 +480,9 @@ private:
 
     void AddCachedTriggers();
 
+    /// Bring the vote index loaded from governance.dat in line with the votes on disk after an unclean shutdown
+    void ReconcileVoteDB();
+
     void RequestOrphanObjects(CConnman& connman);
 
     void CleanOrphanObjects();
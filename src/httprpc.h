@@ -32,4 +32,13 @@ void InterruptREST();
  */
 void StopREST();
 
+/** Start serving the network message telemetry in the Prometheus text format at /metrics.
+ * Precondition; HTTP and RPC has been started.
+ */
+void StartMetrics();
+/** Stop serving the network message telemetry.
+ * Precondition; HTTP and RPC has been stopped.
+ */
+void StopMetrics();
+
 #endif
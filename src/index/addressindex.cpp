@@ -0,0 +1,426 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+
+#include <chainparams.h>
+#include <hash.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <functional>
+#include <limits>
+#include <map>
+
+constexpr char DB_ADDRESSINDEX = 'a';
+constexpr char DB_ADDRESSUNSPENTINDEX = 'u';
+constexpr char DB_ADDRESSBALANCE = 'b';
+constexpr char DB_ADDRESSBALANCE_UNDO = 'U';
+constexpr char DB_APPLIED_TIP = 'T';
+
+using BalanceUndo = std::vector<std::pair<CAddressIndexIteratorKey, CAddressBalanceValue>>;
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+/**
+ * Access to the address index database (indexes/addressindex/)
+ *
+ * Activity is keyed by [DB_ADDRESSINDEX, CAddressIndexKey] and sorted by address and height, unspent outputs are
+ * keyed by [DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey] and the balance records by
+ * [DB_ADDRESSBALANCE, CAddressIndexIteratorKey]. For every applied block, the balance records it replaced are stored
+ * under [DB_ADDRESSBALANCE_UNDO, block hash] for the last MIN_BLOCKS_TO_KEEP blocks, and the hash of the last applied
+ * block under DB_APPLIED_TIP.
+ */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadAddressIndex(const uint160& addressHash, int type, int start, int end, const CAddressIndexKey* seek_key,
+                          const std::function<bool(const CAddressIndexKey&, CAmount)>& fn);
+    bool ReadAddressUnspentIndex(const uint160& addressHash, int type, const CAddressUnspentKey* seek_key,
+                                 const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& fn);
+};
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool AddressIndex::DB::ReadAddressIndex(const uint160& addressHash, int type, int start, int end,
+                                        const CAddressIndexKey* seek_key,
+                                        const std::function<bool(const CAddressIndexKey&, CAmount)>& fn)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (seek_key) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, *seek_key));
+    } else if (start > 0 && end > 0) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    while (pcursor->Valid()) {
+        std::pair<char, CAddressIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.type == (unsigned int)type && key.second.hashBytes == addressHash) {
+            if (end > 0 && key.second.blockHeight > end) {
+                break;
+            }
+            CAmount nValue;
+            if (pcursor->GetValue(nValue)) {
+                if (!fn(key.second, nValue)) {
+                    break;
+                }
+                pcursor->Next();
+            } else {
+                return error("failed to get address index value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool AddressIndex::DB::ReadAddressUnspentIndex(const uint160& addressHash, int type, const CAddressUnspentKey* seek_key,
+                                               const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& fn)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (seek_key) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, *seek_key));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
+
+    while (pcursor->Valid()) {
+        std::pair<char, CAddressUnspentKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.type == (unsigned int)type && key.second.hashBytes == addressHash) {
+            CAddressUnspentValue nValue;
+            if (pcursor->GetValue(nValue)) {
+                if (!fn(key.second, nValue)) {
+                    break;
+                }
+                pcursor->Next();
+            } else {
+                return error("failed to get address unspent value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool GetAddressIndexKey(const CScript& scriptPubKey, int& addressType, uint160& hashBytes)
+{
+    if (scriptPubKey.IsPayToScriptHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(scriptPubKey.begin() + 2, scriptPubKey.begin() + 22));
+        addressType = 2;
+    } else if (scriptPubKey.IsPayToPublicKeyHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(scriptPubKey.begin() + 3, scriptPubKey.begin() + 23));
+        addressType = 1;
+    } else if (scriptPubKey.IsPayToPublicKey()) {
+        hashBytes = Hash160(scriptPubKey.begin() + 1, scriptPubKey.end() - 1);
+        addressType = 1;
+    } else {
+        hashBytes.SetNull();
+        addressType = 0;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Collect the activity entries of a block and the updates of the unspent index for connecting it. When
+ * fDisconnect is set, the unspent updates revert the block instead and have to be applied in reverse order.
+ */
+static bool GetBlockEntries(const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex, bool fDisconnect,
+                            std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex,
+                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& addressUnspentIndex)
+{
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: block and undo data of %s inconsistent", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    int addressType;
+    uint160 hashBytes;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        const uint256& txhash = tx.GetHash();
+
+        if (i > 0) {
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            if (txundo.vprevout.size() != tx.vin.size()) {
+                return error("%s: transaction and undo data of %s inconsistent", __func__, txhash.ToString());
+            }
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const Coin& coin = txundo.vprevout[j];
+                if (!GetAddressIndexKey(coin.out.scriptPubKey, addressType, hashBytes)) {
+                    continue;
+                }
+                const COutPoint& prevout = tx.vin[j].prevout;
+
+                // spending activity
+                addressIndex.emplace_back(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), coin.out.nValue * -1);
+
+                // remove (or when disconnecting restore) the spent output
+                addressUnspentIndex.emplace_back(CAddressUnspentKey(addressType, hashBytes, prevout.hash, prevout.n),
+                                                 fDisconnect ? CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight) : CAddressUnspentValue());
+            }
+        }
+
+        for (size_t k = 0; k < tx.vout.size(); k++) {
+            const CTxOut& out = tx.vout[k];
+            if (!GetAddressIndexKey(out.scriptPubKey, addressType, hashBytes)) {
+                continue;
+            }
+
+            // receiving activity
+            addressIndex.emplace_back(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, k, false), out.nValue);
+
+            // record (or when disconnecting remove) the unspent output
+            addressUnspentIndex.emplace_back(CAddressUnspentKey(addressType, hashBytes, txhash, k),
+                                             fDisconnect ? CAddressUnspentValue() : CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight));
+        }
+    }
+    return true;
+}
+
+static void WriteUnspentEntry(CDBBatch& batch, const std::pair<CAddressUnspentKey, CAddressUnspentValue>& entry)
+{
+    if (entry.second.IsNull()) {
+        batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first));
+    } else {
+        batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first), entry.second);
+    }
+}
+
+/**
+ * Add the activity of a block to the balance records of the addresses it touched, and collect the records it
+ * replaced for reverting the block.
+ */
+static bool UpdateBalances(CDBWrapper& db, CDBBatch& batch, const CBlockIndex* pindex,
+                           const std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex)
+{
+    struct Delta {
+        CAddressBalanceValue value;
+        unsigned int nLastTx{std::numeric_limits<unsigned int>::max()};
+    };
+    std::map<std::pair<unsigned int, uint160>, Delta> mapDeltas;
+    for (const auto& entry : addressIndex) {
+        Delta& delta = mapDeltas[std::make_pair(entry.first.type, entry.first.hashBytes)];
+        delta.value.balance += entry.second;
+        if (!entry.first.spending) {
+            delta.value.received += entry.second;
+        }
+        // The entries of a block are ordered by transaction, so a transaction is only counted once per address
+        if (entry.first.txindex != delta.nLastTx) {
+            delta.value.txCount++;
+            delta.nLastTx = entry.first.txindex;
+        }
+    }
+
+    BalanceUndo undo;
+    undo.reserve(mapDeltas.size());
+    for (const auto& p : mapDeltas) {
+        const CAddressIndexIteratorKey key(p.first.first, p.first.second);
+        CAddressBalanceValue value;
+        if (!db.Read(std::make_pair(DB_ADDRESSBALANCE, key), value)) {
+            value.SetNull();
+        }
+        undo.emplace_back(key, value);
+
+        value.balance += p.second.value.balance;
+        value.received += p.second.value.received;
+        value.txCount += p.second.value.txCount;
+        value.lastHeight = pindex->nHeight;
+        batch.Write(std::make_pair(DB_ADDRESSBALANCE, key), value);
+    }
+    batch.Write(std::make_pair(DB_ADDRESSBALANCE_UNDO, pindex->GetBlockHash()), undo);
+
+    // Reorgs are limited to MIN_BLOCKS_TO_KEEP blocks, like the undo data in the block files
+    if (pindex->nHeight >= (int)MIN_BLOCKS_TO_KEEP) {
+        const CBlockIndex* pindexPrune = pindex->GetAncestor(pindex->nHeight - MIN_BLOCKS_TO_KEEP);
+        batch.Erase(std::make_pair(DB_ADDRESSBALANCE_UNDO, pindexPrune->GetBlockHash()));
+    }
+    return true;
+}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+bool AddressIndex::Init()
+{
+    uint256 applied_hash;
+    if (m_db->Read(DB_APPLIED_TIP, applied_hash)) {
+        LOCK(cs_main);
+        m_applied_tip = LookupBlockIndex(applied_hash);
+        if (!m_applied_tip) {
+            return error("%s: last applied block %s not found", __func__, applied_hash.ToString());
+        }
+        // Blocks which were applied but then disconnected before the index could rewind them
+        const CBlockIndex* fork = ::ChainActive().FindFork(m_applied_tip);
+        if (fork && fork != m_applied_tip) {
+            LogPrintf("%s: reverting blocks down to %s\n", GetName(), fork->GetBlockHash().ToString());
+            if (!RevertTo(fork)) {
+                return false;
+            }
+        }
+    }
+    return BaseIndex::Init();
+}
+
+bool AddressIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    if (m_applied_tip) {
+        // The best block locator is only written periodically, so blocks may be written again after a restart
+        if (m_applied_tip->GetAncestor(pindex->nHeight) == pindex) {
+            return true;
+        }
+        if (pindex->pprev != m_applied_tip) {
+            return error("%s: block %s does not connect to the last applied block %s", __func__,
+                         pindex->GetBlockHash().ToString(), m_applied_tip->GetBlockHash().ToString());
+        }
+    }
+
+    CDBBatch batch(*m_db);
+
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight > 0) {
+        CBlockUndo blockundo;
+        if (!UndoReadFromDisk(blockundo, pindex)) {
+            return false;
+        }
+
+        std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> addressUnspentIndex;
+        if (!GetBlockEntries(block, blockundo, pindex, false, addressIndex, addressUnspentIndex)) {
+            return false;
+        }
+
+        for (const auto& entry : addressIndex) {
+            batch.Write(std::make_pair(DB_ADDRESSINDEX, entry.first), entry.second);
+        }
+        for (const auto& entry : addressUnspentIndex) {
+            WriteUnspentEntry(batch, entry);
+        }
+        if (!UpdateBalances(*m_db, batch, pindex, addressIndex)) {
+            return false;
+        }
+    }
+
+    batch.Write(DB_APPLIED_TIP, pindex->GetBlockHash());
+    if (!m_db->WriteBatch(batch)) {
+        return false;
+    }
+    m_applied_tip = pindex;
+    return true;
+}
+
+bool AddressIndex::RevertTo(const CBlockIndex* new_tip)
+{
+    assert(m_applied_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // Disconnect the blocks from the tip down, so that outputs spent in a later block are restored before the
+    // block which created them removes them again, and the oldest balance records are written last.
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = m_applied_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        CBlockUndo blockundo;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()) || !UndoReadFromDisk(blockundo, pindex)) {
+            return error("%s: Failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+
+        std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> addressUnspentIndex;
+        if (!GetBlockEntries(block, blockundo, pindex, true, addressIndex, addressUnspentIndex)) {
+            return false;
+        }
+
+        for (const auto& entry : addressIndex) {
+            batch.Erase(std::make_pair(DB_ADDRESSINDEX, entry.first));
+        }
+        for (auto it = addressUnspentIndex.rbegin(); it != addressUnspentIndex.rend(); ++it) {
+            WriteUnspentEntry(batch, *it);
+        }
+
+        BalanceUndo undo;
+        if (!m_db->Read(std::make_pair(DB_ADDRESSBALANCE_UNDO, pindex->GetBlockHash()), undo)) {
+            return error("%s: Failed to read balance undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+        for (const auto& entry : undo) {
+            if (entry.second.IsNull()) {
+                batch.Erase(std::make_pair(DB_ADDRESSBALANCE, entry.first));
+            } else {
+                batch.Write(std::make_pair(DB_ADDRESSBALANCE, entry.first), entry.second);
+            }
+        }
+        batch.Erase(std::make_pair(DB_ADDRESSBALANCE_UNDO, pindex->GetBlockHash()));
+    }
+    batch.Write(DB_APPLIED_TIP, new_tip->GetBlockHash());
+    if (!m_db->WriteBatch(batch)) {
+        return false;
+    }
+    m_applied_tip = new_tip;
+    return true;
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    if (m_applied_tip && !RevertTo(new_tip)) {
+        return false;
+    }
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::FindAddressIndex(const uint160& addressHash, int type,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex,
+                                    int start, int end) const
+{
+    return m_db->ReadAddressIndex(addressHash, type, start, end, nullptr, [&](const CAddressIndexKey& key, CAmount nValue) {
+        addressIndex.emplace_back(key, nValue);
+        return true;
+    });
+}
+
+bool AddressIndex::FindAddressUnspent(const uint160& addressHash, int type,
+                                      std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs) const
+{
+    return m_db->ReadAddressUnspentIndex(addressHash, type, nullptr, [&](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+        unspentOutputs.emplace_back(key, value);
+        return true;
+    });
+}
+
+bool AddressIndex::ForEachAddressIndex(const uint160& addressHash, int type, int start, int end, const CAddressIndexKey* seek_key,
+                                       const std::function<bool(const CAddressIndexKey&, CAmount)>& fn) const
+{
+    return m_db->ReadAddressIndex(addressHash, type, start, end, seek_key, fn);
+}
+
+bool AddressIndex::ForEachAddressUnspent(const uint160& addressHash, int type, const CAddressUnspentKey* seek_key,
+                                         const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& fn) const
+{
+    return m_db->ReadAddressUnspentIndex(addressHash, type, seek_key, fn);
+}
+
+bool AddressIndex::FindAddressBalance(const uint160& addressHash, int type, CAddressBalanceValue& value) const
+{
+    if (!m_db->Read(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), value)) {
+        value.SetNull();
+    }
+    return true;
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITGREEN_INDEX_ADDRESSINDEX_H
+#define BITGREEN_INDEX_ADDRESSINDEX_H
+
+#include <amount.h>
+#include <chain.h>
+#include <index/base.h>
+#include <spentindex.h>
+
+#include <functional>
+
+/**
+ * Get the address type (1 for P2PKH and P2PK, 2 for P2SH) and hash under which outputs paying to scriptPubKey are
+ * indexed. Returns false for scripts which are not indexed.
+ */
+bool GetAddressIndexKey(const CScript& scriptPubKey, int& addressType, uint160& hashBytes);
+
+/**
+ * AddressIndex records the receiving and spending activity of addresses, the outputs which are currently unspent
+ * for each address and an aggregated balance record per address. Spent outputs are resolved from the undo data of
+ * the block, so the index can be built in the background, independently of block connection.
+ *
+ * Applying a block to the balance records is not idempotent, so the index keeps track of the last block it applied
+ * (which may be ahead of the best block locator) and stores the previous balance records of every block to revert
+ * it exactly.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// The last block whose entries were written to the database.
+    const CBlockIndex* m_applied_tip{nullptr};
+
+    /// Revert all blocks from m_applied_tip down to new_tip, which must be an ancestor of it.
+    bool RevertTo(const CBlockIndex* new_tip);
+
+protected:
+    /// Override base class init to revert blocks which were disconnected while the index was not running.
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Look up the activity of an address, optionally restricted to the blocks from start to end height.
+    bool FindAddressIndex(const uint160& addressHash, int type,
+                          std::vector<std::pair<CAddressIndexKey, CAmount>>& addressIndex,
+                          int start = 0, int end = 0) const;
+
+    /// Look up the unspent outputs of an address.
+    bool FindAddressUnspent(const uint160& addressHash, int type,
+                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>>& unspentOutputs) const;
+
+    /// Call fn for each activity entry of an address in key order (by height and position in the block), optionally
+    /// restricted to the blocks from start to end height and resuming at the entry with the key seek_key. The
+    /// iteration stops at the first entry for which fn returns false, so the entries don't need to be held in memory.
+    bool ForEachAddressIndex(const uint160& addressHash, int type, int start, int end, const CAddressIndexKey* seek_key,
+                             const std::function<bool(const CAddressIndexKey&, CAmount)>& fn) const;
+
+    /// Call fn for each unspent output of an address in key order, resuming at the output with the key seek_key.
+    bool ForEachAddressUnspent(const uint160& addressHash, int type, const CAddressUnspentKey* seek_key,
+                               const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& fn) const;
+
+    /// Look up the aggregated balance record of an address. Returns a null record for addresses without activity.
+    bool FindAddressBalance(const uint160& addressHash, int type, CAddressBalanceValue& value) const;
+};
+
+/// The global address index, used in GetAddressIndex and GetAddressUnspent. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // BITGREEN_INDEX_ADDRESSINDEX_H
@@ -0,0 +1,47 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITGREEN_INDEX_SPENTINDEX_H
+#define BITGREEN_INDEX_SPENTINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+#include <spentindex.h>
+
+/**
+ * SpentIndex records for each spent output the transaction and input which spent it, together with the amount and
+ * address of the output, which are taken from the undo data of the block.
+ */
+class SpentIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "spentindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~SpentIndex() override;
+
+    /// Look up the spending input of an output. Returns false if the output is not spent in the indexed chain.
+    bool FindSpentIndex(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+};
+
+/// The global spent index, used in GetSpentIndex. May be null.
+extern std::unique_ptr<SpentIndex> g_spentindex;
+
+#endif // BITGREEN_INDEX_SPENTINDEX_H
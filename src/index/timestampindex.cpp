@@ -0,0 +1,80 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/timestampindex.h>
+
+#include <spentindex.h>
+#include <util/system.h>
+
+constexpr char DB_TIMESTAMPINDEX = 's';
+
+std::unique_ptr<TimestampIndex> g_timestampindex;
+
+/**
+ * Access to the timestamp index database (indexes/timestampindex/)
+ *
+ * Entries are keyed by [DB_TIMESTAMPINDEX, CTimestampIndexKey], with the timestamp stored big-endian so that a
+ * range of timestamps can be read sequentially.
+ */
+class TimestampIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    bool ReadTimestampIndex(unsigned int high, unsigned int low, std::vector<uint256>& hashes);
+};
+
+TimestampIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "timestampindex", n_cache_size, f_memory, f_wipe)
+{}
+
+bool TimestampIndex::DB::ReadTimestampIndex(unsigned int high, unsigned int low, std::vector<uint256>& hashes)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+
+    while (pcursor->Valid()) {
+        std::pair<char, CTimestampIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp <= high) {
+            hashes.push_back(key.second.blockHash);
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+TimestampIndex::TimestampIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<TimestampIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+TimestampIndex::~TimestampIndex() {}
+
+bool TimestampIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    return m_db->Write(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())), 0);
+}
+
+bool TimestampIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = current_tip; pindex != new_tip; pindex = pindex->pprev) {
+        batch.Erase(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())));
+    }
+    if (!m_db->WriteBatch(batch)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& TimestampIndex::GetDB() const { return *m_db; }
+
+bool TimestampIndex::FindBlockHashes(unsigned int high, unsigned int low, std::vector<uint256>& hashes) const
+{
+    return m_db->ReadTimestampIndex(high, low, hashes);
+}
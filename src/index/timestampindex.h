@@ -0,0 +1,45 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITGREEN_INDEX_TIMESTAMPINDEX_H
+#define BITGREEN_INDEX_TIMESTAMPINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+
+/**
+ * TimestampIndex is used to look up the hashes of the blocks in the active chain by a range of block timestamps.
+ */
+class TimestampIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "timestampindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit TimestampIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~TimestampIndex() override;
+
+    /// Look up the hashes of the blocks with a timestamp from low to high (inclusive), ordered by timestamp.
+    bool FindBlockHashes(unsigned int high, unsigned int low, std::vector<uint256>& hashes) const;
+};
+
+/// The global timestamp index, used in GetTimestampIndex. May be null.
+extern std::unique_ptr<TimestampIndex> g_timestampindex;
+
+#endif // BITGREEN_INDEX_TIMESTAMPINDEX_H
@@ -24,7 +24,10 @@
 #include <governance/governance.h>
 #include <httprpc.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
 #include <key.h>
@@ -51,6 +54,7 @@
 #include <script/sigcache.h>
 #include <script/standard.h>
 #include <shutdown.h>
+#include <special/sigcache.h>
 #include <special/specialdb.h>
 #include <spork.h>
 #include <timedata.h>
@@ -97,6 +101,7 @@
 static bool fFeeEstimatesInitialized = false;
 static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
+static const bool DEFAULT_METRICS_ENABLE = false;
 static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
 
 // Dump addresses to banlist.dat every 15 minutes (900s)
@@ -182,11 +187,15 @@ void Interrupt()
     InterruptTorControl();
     InterruptMapPort();
     llmq::InterruptLLMQSystem();
+    governance.InterruptWorkerThread();
     if (g_connman)
         g_connman->Interrupt();
     if (g_txindex) {
         g_txindex->Interrupt();
     }
+    if (g_addressindex) g_addressindex->Interrupt();
+    if (g_timestampindex) g_timestampindex->Interrupt();
+    if (g_spentindex) g_spentindex->Interrupt();
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Interrupt(); });
 }
 
@@ -207,6 +216,7 @@ void Shutdown(InitInterfaces& interfaces)
 
     StopHTTPRPC();
     StopREST();
+    StopMetrics();
     StopRPC();
     StopHTTPServer();
     for (const auto& client : interfaces.chain_clients) {
@@ -214,6 +224,7 @@ void Shutdown(InitInterfaces& interfaces)
     }
     StopMapPort();
     llmq::StopLLMQSystem();
+    governance.StopWorkerThread();
 
     // fRPCInWarmup should be `false` if we completed the loading sequence
     // before a shutdown request was received
@@ -223,8 +234,13 @@ void Shutdown(InitInterfaces& interfaces)
     // Because these depend on each-other, we make sure that neither can be
     // using the other before destroying them.
     if (peerLogic) UnregisterValidationInterface(peerLogic.get());
+    // nodes get deleted when stopping g_connman, make sure the message processing pool doesn't use them anymore
+    if (peerLogic) peerLogic->StopMessageProcessingPool();
     if (g_connman) g_connman->Stop();
     if (g_txindex) g_txindex->Stop();
+    if (g_addressindex) g_addressindex->Stop();
+    if (g_timestampindex) g_timestampindex->Stop();
+    if (g_spentindex) g_spentindex->Stop();
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
 
     StopTorControl();
@@ -240,6 +256,9 @@ void Shutdown(InitInterfaces& interfaces)
     g_connman.reset();
     g_banman.reset();
     g_txindex.reset();
+    g_addressindex.reset();
+    g_timestampindex.reset();
+    g_spentindex.reset();
     DestroyAllBlockFilterIndexes();
 
     if (!fLiteMode && !fRPCInWarmup) {
@@ -253,6 +272,7 @@ void Shutdown(InitInterfaces& interfaces)
         CFlatDB<CSporkManager> flatdb6("sporks.dat", "magicSporkCache");
         flatdb6.Dump(sporkManager);
     }
+    governanceVoteDb.reset();
 
     if (::mempool.IsLoaded() && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool(::mempool);
@@ -291,6 +311,7 @@ void Shutdown(InitInterfaces& interfaces)
             ::ChainstateActive().ForceFlushStateToDisk();
         }
         pcoinsTip.reset();
+        pcoinsflusher.reset();
         pcoinscatcher.reset();
         pcoinsdbview.reset();
         pblocktree.reset();
@@ -434,6 +455,8 @@ void SetupServerArgs()
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITGREEN_PID_FILENAME), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-prefetchthreads=<n>", strprintf("Set the number of threads reading the spent coins of a block from disk before it is connected (0 to %d, 0 = disable, default: %d)",
+        MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS), false, OptionsCategory::OPTIONS);
     gArgs.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), false, OptionsCategory::OPTIONS);
@@ -473,6 +496,7 @@ void SetupServerArgs()
     gArgs.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)", DEFAULT_MAX_TIME_ADJUSTMENT), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target (in MiB per 24h), 0 = no limit (default: %d)", DEFAULT_MAX_UPLOAD_TARGET), false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-msgprocthreads=<n>", strprintf("Number of threads processing LLMQ and InstantSend messages next to the message handler thread, 0 to process all messages on the message handler thread (max: %d, default: %d)", MAX_MSGPROC_THREADS, DEFAULT_MSGPROC_THREADS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), false, OptionsCategory::CONNECTION);
@@ -481,6 +505,7 @@ void SetupServerArgs()
     gArgs.AddArg("-proxy=<ip:port>", "Connect through SOCKS5 proxy, set -noproxy to disable (default: disabled)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxyrandomize", strprintf("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)", DEFAULT_PROXYRANDOMIZE), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-seednode=<ip>", "Connect to a node to retrieve peer addresses, and disconnect. This option can be specified multiple times to connect to multiple nodes.", false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-socketevents=<mode>", strprintf("Socket events mode, which must be one of: %s (default: %s)", GetSupportedSocketEventsModes(), DEFAULT_SOCKETEVENTS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-timeout=<n>", strprintf("Specify connection timeout in milliseconds (minimum: 1, default: %d)", DEFAULT_CONNECT_TIMEOUT), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peertimeout=<n>", strprintf("Specify p2p connection timeout in seconds. This option determines the amount of time a peer may be inactive before the connection to it is dropped. (minimum: 1, default: %d)", DEFAULT_PEER_CONNECT_TIMEOUT), true, OptionsCategory::CONNECTION);
     gArgs.AddArg("-torcontrol=<ip>:<port>", strprintf("Tor control port to use if onion listening enabled (default: %s)", DEFAULT_TOR_CONTROL), false, OptionsCategory::CONNECTION);
@@ -579,6 +604,7 @@ void SetupServerArgs()
     gArgs.AddArg("-blockmintxfee=<amt>", strprintf("Set lowest fee rate (in %s/kB) for transactions to be included in block creation. (default: %s)", CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)), false, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-blockversion=<n>", "Override block version to test forking scenarios", true, OptionsCategory::BLOCK_CREATION);
 
+    gArgs.AddArg("-metrics", strprintf("Serve per message type network telemetry in the Prometheus text format at /metrics, without authentication (default: %u)", DEFAULT_METRICS_ENABLE), false, OptionsCategory::RPC);
     gArgs.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times", false, OptionsCategory::RPC);
     gArgs.AddArg("-rpcauth=<userpw>", "Username and HMAC-SHA-256 hashed password for JSON-RPC connections. The field <userpw> comes in the format: <USERNAME>:<SALT>$<HASH>. A canonical python script is included in share/rpcauth. The client then connects normally using the rpcuser=<USERNAME>/rpcpassword=<PASSWORD> pair of arguments. This option can be specified multiple times", false, OptionsCategory::RPC);
@@ -849,6 +875,7 @@ static bool AppInitServers()
     if (!StartHTTPRPC())
         return false;
     if (gArgs.GetBoolArg("-rest", DEFAULT_REST_ENABLE)) StartREST();
+    if (gArgs.GetBoolArg("-metrics", DEFAULT_METRICS_ENABLE)) StartMetrics();
     StartHTTPServer();
     return true;
 }
@@ -915,18 +942,6 @@ void InitParameterInteraction()
         if (gArgs.SoftSetBoolArg("-whitelistrelay", true))
             LogPrintf("%s: parameter interaction: -whitelistforcerelay=1 -> setting -whitelistrelay=1\n", __func__);
     }
-
-    // Make sure additional indexes are recalculated correctly in VerifyDB
-    // (we must reconnect blocks whenever we disconnect them for these indexes to work)
-    bool fAdditionalIndexes =
-        gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ||
-        gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ||
-        gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
-
-    if (fAdditionalIndexes && gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL) < 4) {
-        gArgs.ForceSetArg("-checklevel", "4");
-        LogPrintf("%s: parameter interaction: additional indexes -> setting -checklevel=4\n", __func__);
-    }
 }
 
 static std::string ResolveErrMsg(const char * const optname, const std::string& strBind)
@@ -967,6 +982,7 @@ int nUserMaxConnections;
 int nFD;
 ServiceFlags nLocalServices = ServiceFlags(NODE_NETWORK | NODE_NETWORK_LIMITED);
 int64_t peer_connect_timeout;
+SocketEventsMode socketEventsMode;
 std::vector<BlockFilterType> g_enabled_filter_types;
 
 } // namespace
@@ -1065,6 +1081,10 @@ bool AppInitParameterInteraction()
         }
     }
 
+    fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+    fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
+    fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+
     // if using block pruning, then disallow txindex
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
@@ -1072,6 +1092,9 @@ bool AppInitParameterInteraction()
         if (!g_enabled_filter_types.empty()) {
             return InitError(_("Prune mode is incompatible with -blockfilterindex.").translated);
         }
+        if (fAddressIndex || fTimestampIndex || fSpentIndex) {
+            return InitError(_("Prune mode is incompatible with -addressindex, -timestampindex and -spentindex.").translated);
+        }
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1080,6 +1103,12 @@ bool AppInitParameterInteraction()
         return InitError("Cannot set -bind or -whitebind together with -listen=0");
     }
 
+    std::string strSocketEventsMode = gArgs.GetArg("-socketevents", DEFAULT_SOCKETEVENTS);
+    socketEventsMode = SocketEventsModeFromString(strSocketEventsMode);
+    if (socketEventsMode == SocketEventsMode::Unknown) {
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s").translated, strSocketEventsMode, GetSupportedSocketEventsModes()));
+    }
+
     // Make sure enough file descriptors are available
     int nBind = std::max(nUserBind, size_t(1));
     nUserMaxConnections = gArgs.GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
@@ -1089,7 +1118,8 @@ bool AppInitParameterInteraction()
     // <int> in std::min<int>(...) to work around FreeBSD compilation issue described in #2695
     nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
 #ifdef USE_POLL
-    int fd_max = nFD;
+    // select() can't handle sockets beyond FD_SETSIZE, even when poll/epoll are available
+    int fd_max = socketEventsMode == SocketEventsMode::Select ? FD_SETSIZE : nFD;
 #else
     int fd_max = FD_SETSIZE;
 #endif
@@ -1175,6 +1205,9 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // Reading coins waits on disk rather than the CPU, so this is not tied to the number of cores
+    nCoinPrefetchThreads = std::max(0, std::min((int)gArgs.GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS), MAX_PREFETCH_THREADS));
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1360,6 +1393,7 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitSpecialTxSigCache();
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
@@ -1367,6 +1401,11 @@ bool AppInitMain(InitInterfaces& interfaces)
             threadGroup.create_thread([i]() { return ThreadScriptCheck(i); });
     }
 
+    LogPrintf("Using %u threads for coin prefetching\n", nCoinPrefetchThreads);
+    for (int i = 0; i < nCoinPrefetchThreads; i++) {
+        threadGroup.create_thread([i]() { return ThreadCoinPrefetch(i); });
+    }
+
     std::vector<std::string> vSporkAddresses;
     if (!gArgs.GetArgs("-sporkaddr").empty())
         vSporkAddresses = gArgs.GetArgs("-sporkaddr");
@@ -1492,7 +1531,8 @@ bool AppInitMain(InitInterfaces& interfaces)
     assert(!g_connman);
     g_connman = std::unique_ptr<CConnman>(new CConnman(GetRand(std::numeric_limits<uint64_t>::max()), GetRand(std::numeric_limits<uint64_t>::max())));
 
-    peerLogic.reset(new PeerLogicValidation(g_connman.get(), g_banman.get(), scheduler, gArgs.GetBoolArg("-enablebip61", DEFAULT_ENABLE_BIP61)));
+    int nMsgProcThreads = std::max(0, std::min((int)gArgs.GetArg("-msgprocthreads", DEFAULT_MSGPROC_THREADS), MAX_MSGPROC_THREADS));
+    peerLogic.reset(new PeerLogicValidation(g_connman.get(), g_banman.get(), scheduler, gArgs.GetBoolArg("-enablebip61", DEFAULT_ENABLE_BIP61), nMsgProcThreads));
     RegisterValidationInterface(peerLogic.get());
 
     // sanitize comments per BIP-0014, format user agent and check total size
@@ -1619,6 +1659,13 @@ bool AppInitMain(InitInterfaces& interfaces)
         filter_index_cache = max_cache / n_indexes;
         nTotalCache -= filter_index_cache * n_indexes;
     }
+    int64_t insight_index_cache = 0;
+    if (fAddressIndex || fTimestampIndex || fSpentIndex) {
+        size_t n_indexes = (size_t)fAddressIndex + (size_t)fTimestampIndex + (size_t)fSpentIndex;
+        int64_t max_cache = std::min(nTotalCache / 8, nMaxTxIndexCache << 20);
+        insight_index_cache = max_cache / n_indexes;
+        nTotalCache -= insight_index_cache * n_indexes;
+    }
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1634,6 +1681,9 @@ bool AppInitMain(InitInterfaces& interfaces)
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
                   filter_index_cache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
     }
+    if (insight_index_cache > 0) {
+        LogPrintf("* Using %.1f MiB for each address, timestamp and spent index database\n", insight_index_cache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1650,6 +1700,7 @@ bool AppInitMain(InitInterfaces& interfaces)
             try {
                 UnloadBlockIndex();
                 pcoinsTip.reset();
+                pcoinsflusher.reset();
                 pcoinsdbview.reset();
                 pcoinscatcher.reset();
                 // new CBlockTreeDB tries to delete the existing file, which
@@ -1697,24 +1748,6 @@ bool AppInitMain(InitInterfaces& interfaces)
                     break;
                 }
 
-                // Check for changed -addressindex state
-                if (fAddressIndex != gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -addressindex").translated;
-                    break;
-                }
-
-                // Check for changed -timestampindex state
-                if (fTimestampIndex != gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -timestampindex").translated;
-                    break;
-                }
-
-                // Check for changed -spentindex state
-                if (fSpentIndex != gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -spentindex").translated;
-                    break;
-                }
-
                 // At this point blocktree args are consistent with what's on disk.
                 // If we're not mid-reindex (based on disk + args), add a genesis block on disk
                 // (otherwise we use the one already on disk).
@@ -1749,7 +1782,8 @@ bool AppInitMain(InitInterfaces& interfaces)
                 }
 
                 // The on-disk coinsdb is now in a good state, create the cache
-                pcoinsTip.reset(new CCoinsViewCache(pcoinscatcher.get()));
+                pcoinsflusher.reset(new CCoinsViewBackgroundFlush(pcoinscatcher.get(), pcoinsdbview.get()));
+                pcoinsTip.reset(new CCoinsViewCache(pcoinsflusher.get()));
 
                 is_coinsview_empty = fReset || fReindexChainState || pcoinsTip->GetBestBlock().IsNull();
                 if (!is_coinsview_empty) {
@@ -1842,6 +1876,20 @@ bool AppInitMain(InitInterfaces& interfaces)
         GetBlockFilterIndex(filter_type)->Start();
     }
 
+    // The address, timestamp and spent indexes are built in the background and don't block startup
+    if (fAddressIndex) {
+        g_addressindex = MakeUnique<AddressIndex>(insight_index_cache, false, fReindex);
+        g_addressindex->Start();
+    }
+    if (fTimestampIndex) {
+        g_timestampindex = MakeUnique<TimestampIndex>(insight_index_cache, false, fReindex);
+        g_timestampindex->Start();
+    }
+    if (fSpentIndex) {
+        g_spentindex = MakeUnique<SpentIndex>(insight_index_cache, false, fReindex);
+        g_spentindex->Start();
+    }
+
     // ********************************************************* Step 8-B: check lite mode and load sporks
 
     // lite mode disables all Dash-specific functionality
@@ -1958,6 +2006,9 @@ bool AppInitMain(InitInterfaces& interfaces)
         }
     }
 
+    // votes are only meaningful together with governance.dat, wipe them whenever the cache is not loaded
+    governanceVoteDb.reset(new CGovernanceVoteDB(1 << 20, false, !fLoadCacheFiles));
+
     strDBName = "governance.dat";
     uiInterface.InitMessage(_("Loading governance cache...").translated);
     CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
@@ -1990,8 +2041,19 @@ bool AppInitMain(InitInterfaces& interfaces)
     // ********************************************************* Step 10-C: schedule BitGreen-specific tasks
 
     scheduler.scheduleEvery(boost::bind(&CNetFulfilledRequestManager::DoMaintenance, boost::ref(netfulfilledman)), 60 * 1000);
+    scheduler.scheduleEvery(boost::bind(&CMasternodeMetaMan::DoMaintenance, boost::ref(mmetaman)), 60 * 1000);
     scheduler.scheduleEvery(boost::bind(&CMasternodeSync::DoMaintenance, boost::ref(masternodeSync), boost::ref(*g_connman)), 1 * 1000);
     scheduler.scheduleEvery(boost::bind(&CGovernanceManager::DoMaintenance, boost::ref(governance), boost::ref(*g_connman)), 60 * 5 * 1000);
+    if (!fLiteMode) {
+        governance.StartWorkerThread();
+        // mncache.dat and governance.dat are only rewritten on shutdown, in between changes are appended to their logs
+        scheduler.scheduleEvery([]{
+            CFlatDB<CMasternodeMetaMan> flatdb1("mncache.dat", "magicMasternodeCache");
+            flatdb1.Flush(mmetaman);
+            CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
+            flatdb3.Flush(governance);
+        }, 60 * 1000);
+    }
     scheduler.scheduleEvery(boost::bind(&CMasternodeUtils::DoMaintenance, boost::ref(*g_connman)), 1 * 1000);
 
     llmq::StartLLMQSystem();
@@ -2088,6 +2150,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
+    connOptions.socketEventsMode = socketEventsMode;
 
     for (const std::string& strBind : gArgs.GetArgs("-bind")) {
         CService addrBind;
@@ -24,6 +24,7 @@
 #include <threadsafety.h>
 #include <timedata.h>
 #include <txmempool.h>
+#include <txrelay.h>
 #include <ui_interface.h>
 #include <uint256.h>
 #include <univalue.h>
@@ -292,8 +293,7 @@ public:
     }
     void relayTransaction(const uint256& txid) override
     {
-        CInv inv(MSG_TX, txid);
-        g_connman->ForEachNode([&inv](CNode* node) { node->PushInventory(inv); });
+        txRelayQueue.Add(txid);
     }
     void getTransactionAncestry(const uint256& txid, size_t& ancestors, size_t& descendants) override
     {
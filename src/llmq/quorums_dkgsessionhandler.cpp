@@ -499,7 +499,7 @@ void CDKGSessionHandler::HandleDKGRound()
                 }
                 LogPrint(BCLog::LLMQDKG, debugMsg.c_str());
             }
-            g_connman->AddMasternodeQuorumNodes(params.type, curQuorumHash, connections);
+            g_connman->AddMasternodeQuorumNodes(params.type, curQuorumHash, connections, true);
         }
     }
 
@@ -939,10 +939,17 @@ void CInstantSendManager::ProcessInstantSendLock(NodeId from, const uint256& has
 
     RemoveMempoolConflictsForLock(hash, islock);
     ResolveBlockConflicts(hash, islock);
-    UpdateWalletTransaction(islock.txid, tx);
+    UpdateWalletTransaction(islock.txid);
+
+    if (tx) {
+        // also needed without a wallet, e.g. to keep the locked TX around for compact block reconstruction
+        GetMainSignals().NotifyTransactionLock(*tx);
+        // bump mempool counter to make sure newly mined txes are picked up by getblocktemplate
+        mempool.AddTransactionsUpdated(1);
+    }
 }
 
-void CInstantSendManager::UpdateWalletTransaction(const uint256& txid, const CTransactionRef& tx)
+void CInstantSendManager::UpdateWalletTransaction(const uint256& txid)
 {
 #ifdef ENABLE_WALLET
     if (!GetWallets().front()) {
@@ -958,12 +965,6 @@ void CInstantSendManager::UpdateWalletTransaction(const uint256& txid, const CTr
         }
     }
 #endif
-
-    if (tx) {
-        GetMainSignals().NotifyTransactionLock(*tx);
-        // bump mempool counter to make sure newly mined txes are picked up by getblocktemplate
-        mempool.AddTransactionsUpdated(1);
-    }
 }
 
 void CInstantSendManager::SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock)
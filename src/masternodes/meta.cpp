@@ -4,10 +4,20 @@
 
 #include <masternodes/meta.h>
 
+#include <clientversion.h>
+#include <masternodes/sync.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <tinyformat.h>
+
 CMasternodeMetaMan mmetaman;
 
 const std::string CMasternodeMetaMan::SERIALIZATION_VERSION_STRING = "CMasternodeMetaMan-Version-1";
 
+// Record types of mncache.log
+static const char LOG_META_INFO = 'm';
+static const char LOG_META_INFO_ERASED = 'e';
+
 void CMasternodeMetaInfo::AddGovernanceVote(const uint256& nGovernanceObjectHash)
 {
     LOCK(cs);
@@ -17,11 +27,11 @@ void CMasternodeMetaInfo::AddGovernanceVote(const uint256& nGovernanceObjectHash
     pair.first->second++;
 }
 
-void CMasternodeMetaInfo::RemoveGovernanceObject(const uint256& nGovernanceObjectHash)
+bool CMasternodeMetaInfo::RemoveGovernanceObject(const uint256& nGovernanceObjectHash)
 {
     LOCK(cs);
     // Whether or not the govobj hash exists in the map first is irrelevant.
-    mapGovernanceObjectsVotedOn.erase(nGovernanceObjectHash);
+    return mapGovernanceObjectsVotedOn.erase(nGovernanceObjectHash) != 0;
 }
 
 /**
@@ -40,31 +50,44 @@ void CMasternodeMetaInfo::FlagGovernanceItemsAsDirty()
 
 CMasternodeMetaInfoPtr CMasternodeMetaMan::GetMetaInfo(const uint256& proTxHash, bool fCreate)
 {
-    LOCK(cs);
-    auto it = metaInfos.find(proTxHash);
-    if (it != metaInfos.end()) {
+    auto& shard = GetShard(proTxHash);
+    LOCK(shard.cs);
+    auto it = shard.metaInfos.find(proTxHash);
+    if (it != shard.metaInfos.end()) {
         return it->second;
     }
     if (!fCreate) {
         return nullptr;
     }
-    it = metaInfos.emplace(proTxHash, std::make_shared<CMasternodeMetaInfo>(proTxHash)).first;
+    it = shard.metaInfos.emplace(proTxHash, std::make_shared<CMasternodeMetaInfo>(proTxHash)).first;
+    shard.setDirty.insert(proTxHash);
     return it->second;
 }
 
+void CMasternodeMetaMan::SetDirty(const uint256& proTxHash)
+{
+    auto& shard = GetShard(proTxHash);
+    LOCK(shard.cs);
+    shard.setDirty.insert(proTxHash);
+}
+
 bool CMasternodeMetaMan::AddGovernanceVote(const uint256& proTxHash, const uint256& nGovernanceObjectHash)
 {
-    LOCK(cs);
     auto mm = GetMetaInfo(proTxHash);
     mm->AddGovernanceVote(nGovernanceObjectHash);
+    SetDirty(proTxHash);
     return true;
 }
 
 void CMasternodeMetaMan::RemoveGovernanceObject(const uint256& nGovernanceObjectHash)
 {
-    LOCK(cs);
-    for(auto& p : metaInfos) {
-        p.second->RemoveGovernanceObject(nGovernanceObjectHash);
+    for (auto& shard : shards) {
+        LOCK(shard.cs);
+        for (auto& p : shard.metaInfos) {
+            if (p.second->RemoveGovernanceObject(nGovernanceObjectHash)) {
+                shard.setDirty.insert(p.first);
+            }
+        }
     }
 }
 
@@ -84,21 +107,129 @@ std::vector<uint256> CMasternodeMetaMan::GetAndClearDirtyGovernanceObjectHashes(
 
 void CMasternodeMetaMan::Clear()
 {
+    for (auto& shard : shards) {
+        LOCK(shard.cs);
+        for (const auto& p : shard.metaInfos) {
+            shard.setDirty.insert(p.first);
+        }
+        shard.metaInfos.clear();
+    }
     LOCK(cs);
-    metaInfos.clear();
     vecDirtyGovernanceObjectHashes.clear();
 }
 
 void CMasternodeMetaMan::CheckAndRemove()
 {
+    // The list at the tip is only meaningful once we're synced, otherwise we'd evict masternodes
+    // which were registered after the (possibly very old) tip
+    if (!masternodeSync.IsBlockchainSynced()) {
+        return;
+    }
+
+    RemoveMissingMasternodes(deterministicMNManager->GetListAtChainTip());
+}
+
+void CMasternodeMetaMan::RemoveMissingMasternodes(const CDeterministicMNList& mnList)
+{
+    std::vector<CMasternodeMetaInfoPtr> vecRemoved;
+    for (auto& shard : shards) {
+        LOCK(shard.cs);
+        auto it = shard.metaInfos.begin();
+        while (it != shard.metaInfos.end()) {
+            if (!mnList.HasMN(it->first)) {
+                shard.setDirty.insert(it->first);
+                vecRemoved.emplace_back(std::move(it->second));
+                it = shard.metaInfos.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // objects voted on by removed masternodes need their cached vote counts to be recalculated
+    for (const auto& mm : vecRemoved) {
+        mm->FlagGovernanceItemsAsDirty();
+    }
+
+    if (!vecRemoved.empty()) {
+        LogPrint(BCLog::MASTERNODE, "CMasternodeMetaMan::%s -- removed %d meta infos\n", __func__, vecRemoved.size());
+    }
+}
+
+size_t CMasternodeMetaMan::GetMetaInfoCount() const
+{
+    size_t nCount = 0;
+    for (const auto& shard : shards) {
+        LOCK(shard.cs);
+        nCount += shard.metaInfos.size();
+    }
+    return nCount;
+}
 
+void CMasternodeMetaMan::GetLogRecords(std::vector<std::vector<unsigned char>>& vRecords)
+{
+    for (auto& shard : shards) {
+        LOCK(shard.cs);
+        for (const uint256& proTxHash : shard.setDirty) {
+            vRecords.emplace_back();
+            CVectorWriter ss(SER_DISK, CLIENT_VERSION, vRecords.back(), 0);
+            ss << SERIALIZATION_VERSION_STRING;
+            auto it = shard.metaInfos.find(proTxHash);
+            if (it == shard.metaInfos.end()) {
+                ss << LOG_META_INFO_ERASED << proTxHash;
+            } else {
+                ss << LOG_META_INFO << *it->second;
+            }
+        }
+        shard.setDirty.clear();
+    }
+}
+
+void CMasternodeMetaMan::ApplyLogRecord(const std::vector<unsigned char>& vRecord)
+{
+    CDataStream ss(vRecord, SER_DISK, CLIENT_VERSION);
+    std::string strVersion;
+    ss >> strVersion;
+    if (strVersion != SERIALIZATION_VERSION_STRING) {
+        // written by another version, just like the checkpoint it belongs to
+        return;
+    }
+
+    char nType;
+    ss >> nType;
+    switch (nType) {
+    case LOG_META_INFO: {
+        auto mm = std::make_shared<CMasternodeMetaInfo>(deserialize, ss);
+        auto& shard = GetShard(mm->GetProTxHash());
+        LOCK(shard.cs);
+        shard.metaInfos[mm->GetProTxHash()] = std::move(mm);
+        break;
+    }
+    case LOG_META_INFO_ERASED: {
+        uint256 proTxHash;
+        ss >> proTxHash;
+        auto& shard = GetShard(proTxHash);
+        LOCK(shard.cs);
+        shard.metaInfos.erase(proTxHash);
+        break;
+    }
+    default:
+        throw std::ios_base::failure(strprintf("unknown record type %d", nType));
+    }
 }
 
 std::string CMasternodeMetaMan::ToString() const
 {
     std::ostringstream info;
 
-    info << "Masternodes: meta infos object count: " << (int)metaInfos.size() <<
+    info << "Masternodes: meta infos object count: " << (int)GetMetaInfoCount() <<
          ", nDsqCount: " << (int)nDsqCount;
     return info.str();
 }
+
+void CMasternodeMetaMan::DoMaintenance()
+{
+    if (ShutdownRequested()) return;
+
+    CheckAndRemove();
+}
@@ -5,10 +5,15 @@
 #ifndef BITGREEN_MASTERNODE_META_H
 #define BITGREEN_MASTERNODE_META_H
 
+#include <saltedhasher.h>
 #include <serialize.h>
 #include <special/deterministicmns.h>
 
+#include <array>
 #include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 class CConnman;
 
@@ -72,7 +77,8 @@ public:
     // RECALCULATE CACHED STATUS FLAGS FOR ALL AFFECTED OBJECTS
     void FlagGovernanceItemsAsDirty();
 
-    void RemoveGovernanceObject(const uint256& nGovernanceObjectHash);
+    // Returns whether this masternode had voted on the object
+    bool RemoveGovernanceObject(const uint256& nGovernanceObjectHash);
 };
 typedef std::shared_ptr<CMasternodeMetaInfo> CMasternodeMetaInfoPtr;
 
@@ -81,22 +87,37 @@ class CMasternodeMetaMan
 private:
     static const std::string SERIALIZATION_VERSION_STRING;
 
+    // Meta infos are spread over independently locked shards, so that lookups for different masternodes
+    // (governance vote processing, LLMQ connection handling, ...) don't serialize on a single lock
+    static const size_t SHARD_COUNT = 16;
+
+    struct MetaInfoShard {
+        mutable CCriticalSection cs;
+        std::unordered_map<uint256, CMasternodeMetaInfoPtr, StaticSaltedHasher> metaInfos;
+        // meta infos added, changed or erased since the last checkpoint or log flush, see GetLogRecords
+        std::unordered_set<uint256, StaticSaltedHasher> setDirty;
+    };
+
+    std::array<MetaInfoShard, SHARD_COUNT> shards;
+
+    // protects vecDirtyGovernanceObjectHashes and nDsqCount
     CCriticalSection cs;
 
-    std::map<uint256, CMasternodeMetaInfoPtr> metaInfos;
     std::vector<uint256> vecDirtyGovernanceObjectHashes;
 
     // keep track of dsq count to prevent masternodes from gaming privatesend queue
     int64_t nDsqCount = 0;
 
+    MetaInfoShard& GetShard(const uint256& proTxHash) { return shards[StaticSaltedHasher()(proTxHash) % SHARD_COUNT]; }
+
+    void SetDirty(const uint256& proTxHash);
+
 public:
     ADD_SERIALIZE_METHODS
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
-        LOCK(cs);
-
         std::string strVersion;
         if(ser_action.ForRead()) {
             Clear();
@@ -113,17 +134,22 @@ public:
         std::vector<CMasternodeMetaInfo> tmpMetaInfo;
         if (ser_action.ForRead()) {
             READWRITE(tmpMetaInfo);
-            metaInfos.clear();
             for (auto& mm : tmpMetaInfo) {
-                metaInfos.emplace(mm.GetProTxHash(), std::make_shared<CMasternodeMetaInfo>(std::move(mm)));
+                auto& shard = GetShard(mm.GetProTxHash());
+                LOCK(shard.cs);
+                shard.metaInfos.emplace(mm.GetProTxHash(), std::make_shared<CMasternodeMetaInfo>(std::move(mm)));
             }
         } else {
-            for (auto& p : metaInfos) {
-                tmpMetaInfo.emplace_back(*p.second);
+            for (auto& shard : shards) {
+                LOCK(shard.cs);
+                for (auto& p : shard.metaInfos) {
+                    tmpMetaInfo.emplace_back(*p.second);
+                }
             }
             READWRITE(tmpMetaInfo);
         }
 
+        LOCK(cs);
         READWRITE(nDsqCount);
     }
 
@@ -137,9 +163,21 @@ public:
     std::vector<uint256> GetAndClearDirtyGovernanceObjectHashes();
 
     void Clear();
+    // Evict meta infos of masternodes which are not part of the deterministic masternode list anymore
     void CheckAndRemove();
+    // Evict meta infos of masternodes missing in mnList and flag the governance objects they voted on as dirty
+    void RemoveMissingMasternodes(const CDeterministicMNList& mnList);
+
+    size_t GetMetaInfoCount() const;
+
+    /// Append a record for every meta info which was added, changed or erased since the last call, see CFlatDB::Flush
+    void GetLogRecords(std::vector<std::vector<unsigned char>>& vRecords);
+    /// Apply a record written by GetLogRecords
+    void ApplyLogRecord(const std::vector<unsigned char>& vRecord);
 
     std::string ToString() const;
+
+    void DoMaintenance();
 };
 
 extern CMasternodeMetaMan mmetaman;
@@ -6,6 +6,7 @@
 #define BITGREEN_MEMUSAGE_H
 
 #include <indirectmap.h>
+#include <support/allocators/pool.h>
 
 #include <stdlib.h>
 
@@ -165,6 +166,16 @@ static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+template<typename X, typename Y, typename Z, typename P, size_t MAX_BLOCK_SIZE_BYTES, size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z, P, PoolAllocator<std::pair<const X, Y>, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> >& m)
+{
+    // The nodes live in the chunks of the pool, which are only released with it. The chunks are tracked in a
+    // std::list, with a previous, next and chunk pointer per list node.
+    const auto* resource = m.get_allocator().resource();
+    size_t usage_chunks = (MallocUsage(resource->ChunkSizeBytes()) + MallocUsage(sizeof(void*) * 3)) * resource->NumAllocatedChunks();
+    return MallocUsage(sizeof(*resource)) + MallocUsage(sizeof(stl_shared_counter)) + usage_chunks + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
 }
 
 #endif // BITGREEN_MEMUSAGE_H
@@ -35,6 +35,10 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -92,6 +96,47 @@ std::map<CNetAddr, LocalServiceInfo> mapLocalHost GUARDED_BY(cs_mapLocalHost);
 static bool vfLimited[NET_MAX] GUARDED_BY(cs_mapLocalHost) = {};
 std::string strSubVersion;
 
+SocketEventsMode SocketEventsModeFromString(const std::string& strMode)
+{
+    if (strMode == "select") {
+        return SocketEventsMode::Select;
+    }
+#ifdef USE_POLL
+    if (strMode == "poll") {
+        return SocketEventsMode::Poll;
+    }
+#endif
+#ifdef USE_EPOLL
+    if (strMode == "epoll") {
+        return SocketEventsMode::EPoll;
+    }
+#endif
+    return SocketEventsMode::Unknown;
+}
+
+std::string SocketEventsModeToString(SocketEventsMode mode)
+{
+    switch (mode) {
+    case SocketEventsMode::Select: return "select";
+    case SocketEventsMode::Poll: return "poll";
+    case SocketEventsMode::EPoll: return "epoll";
+    case SocketEventsMode::Unknown: break;
+    }
+    return "unknown";
+}
+
+std::string GetSupportedSocketEventsModes()
+{
+    std::string strModes = "select";
+#ifdef USE_POLL
+    strModes += ", poll";
+#endif
+#ifdef USE_EPOLL
+    strModes += ", epoll";
+#endif
+    return strModes;
+}
+
 void CConnman::AddOneShot(const std::string& strDest)
 {
     LOCK(cs_vOneShots);
@@ -712,33 +757,97 @@ const uint256& CNetMessage::GetMessageHash() const
     return data_hash;
 }
 
+/** Maximum number of buffers passed to a single scatter-gather send call */
+static const size_t MAX_SEND_BUFFERS = 64;
+
+typedef std::pair<const unsigned char*, size_t> SendBuffer;
+
+/** Send as much as possible of the given buffers with a single system call */
+static int64_t SendBuffers(SOCKET hSocket, const SendBuffer* pBuffers, size_t nBuffers)
+{
+#ifndef WIN32
+    struct iovec vIov[MAX_SEND_BUFFERS];
+    for (size_t i = 0; i < nBuffers; i++) {
+        vIov[i].iov_base = const_cast<unsigned char*>(pBuffers[i].first);
+        vIov[i].iov_len = pBuffers[i].second;
+    }
+    struct msghdr msg = {};
+    msg.msg_iov = vIov;
+    msg.msg_iovlen = nBuffers;
+    return sendmsg(hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+    WSABUF vWsaBuf[MAX_SEND_BUFFERS];
+    for (size_t i = 0; i < nBuffers; i++) {
+        vWsaBuf[i].buf = reinterpret_cast<char*>(const_cast<unsigned char*>(pBuffers[i].first));
+        vWsaBuf[i].len = pBuffers[i].second;
+    }
+    DWORD nSent = 0;
+    if (WSASend(hSocket, vWsaBuf, nBuffers, &nSent, 0, nullptr, nullptr) == SOCKET_ERROR) {
+        return -1;
+    }
+    return nSent;
+#endif
+}
+
 size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pnode->cs_vSend)
 {
     auto it = pnode->vSendMsg.begin();
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
-        int nBytes = 0;
+        assert(it->size() > pnode->nSendOffset);
+
+        // Gather the unsent parts of as many queued messages as possible, so that many small messages only need
+        // a single system call
+        SendBuffer vBuffers[MAX_SEND_BUFFERS];
+        size_t nBuffers = 0;
+        size_t nBuffersSize = 0;
+        size_t nOffset = pnode->nSendOffset;
+        for (auto itGather = it; itGather != pnode->vSendMsg.end() && nBuffers + 2 <= MAX_SEND_BUFFERS; ++itGather) {
+            if (nOffset < itGather->header.size()) {
+                vBuffers[nBuffers++] = SendBuffer(itGather->header.data() + nOffset, itGather->header.size() - nOffset);
+                nOffset = 0;
+            } else {
+                nOffset -= itGather->header.size();
+            }
+            const auto& payload = itGather->GetPayload();
+            if (nOffset < payload.size()) {
+                vBuffers[nBuffers++] = SendBuffer(payload.data() + nOffset, payload.size() - nOffset);
+            }
+            nBuffersSize += itGather->size() - (itGather == it ? pnode->nSendOffset : 0);
+            nOffset = 0;
+        }
+
+        int64_t nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            nBytes = SendBuffers(pnode->hSocket, vBuffers, nBuffers);
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+
+            // Drop all messages which were sent completely
+            size_t nRemaining = nBytes;
+            while (nRemaining > 0) {
+                size_t nLeft = it->size() - pnode->nSendOffset;
+                if (nRemaining < nLeft) {
+                    pnode->nSendOffset += nRemaining;
+                    break;
+                }
+                nRemaining -= nLeft;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= it->size();
+                it->pStats->sendQueueTime.Add(GetTimeMicros() - it->nTimeQueued);
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+
+            if ((size_t)nBytes < nBuffersSize) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -1030,6 +1139,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
 
     LogPrint(BCLog::NET, "connection from %s accepted\n", addr.ToString());
 
+    RegisterEvents(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
@@ -1193,7 +1303,7 @@ bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &s
 }
 
 #ifdef USE_POLL
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+void CConnman::SocketEventsPoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
     if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
@@ -1234,8 +1344,9 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
         if (pollfd_entry.revents & (POLLERR|POLLHUP)) error_set.insert(pollfd_entry.fd);
     }
 }
-#else
-void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+#endif
+
+void CConnman::SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
 {
     std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
     if (!GenerateSelectSet(recv_select_set, send_select_set, error_select_set)) {
@@ -1308,7 +1419,130 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
         }
     }
 }
+
+
+#ifdef USE_EPOLL
+void CConnman::SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+    // Sockets are registered once (see RegisterEvents) as edge-triggered. Readiness of peers is stored in the
+    // node itself and only cleared by SocketHandler once a recv/send would block, so there is no per-iteration
+    // setup work here. Only listen sockets are reported through recv_set.
+    const int nTimeout = fEpollPendingWork ? 0 : SELECT_TIMEOUT_MILLISECONDS;
+
+    epoll_event events[256];
+    int nEvents = epoll_wait(epollfd, events, 256, nTimeout);
+    if (nEvents < 0) {
+        if (errno != EINTR) {
+            LogPrintf("epoll_wait error %s\n", NetworkErrorString(errno));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    if (interruptNet) return;
+
+    for (int i = 0; i < nEvents; i++) {
+        auto& e = events[i];
+        const ListenSocket* pListenSocket = nullptr;
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            if (e.data.ptr == &hListenSocket) {
+                pListenSocket = &hListenSocket;
+                break;
+            }
+        }
+        if (pListenSocket) {
+            if (e.events & EPOLLIN) recv_set.insert(pListenSocket->socket);
+            continue;
+        }
+
+        // Nodes are only deleted by this thread and only after their socket got closed, which also removes it
+        // from the epoll set, so the pointer is still valid here
+        CNode* pnode = static_cast<CNode*>(e.data.ptr);
+        // Errors and hangups are detected by the following recv()
+        if (e.events & (EPOLLIN | EPOLLERR | EPOLLHUP)) pnode->fHasRecvData = true;
+        if (e.events & EPOLLOUT) pnode->fCanSendData = true;
+    }
+}
+#endif
+
+void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set)
+{
+    switch (socketEventsMode) {
+#ifdef USE_EPOLL
+    case SocketEventsMode::EPoll:
+        SocketEventsEpoll(recv_set, send_set, error_set);
+        break;
+#endif
+#ifdef USE_POLL
+    case SocketEventsMode::Poll:
+        SocketEventsPoll(recv_set, send_set, error_set);
+        break;
+#endif
+    case SocketEventsMode::Select:
+        SocketEventsSelect(recv_set, send_set, error_set);
+        break;
+    default:
+        assert(false);
+    }
+}
+
+bool CConnman::InitSocketEvents()
+{
+#ifdef USE_EPOLL
+    if (socketEventsMode == SocketEventsMode::EPoll) {
+        assert(epollfd == -1);
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("epoll_create1 failed: %s\n", NetworkErrorString(errno));
+            return false;
+        }
+        // Listen sockets stay level-triggered, AcceptConnection only accepts one connection per round
+        for (ListenSocket& hListenSocket : vhListenSocket) {
+            epoll_event e;
+            e.events = EPOLLIN;
+            e.data.ptr = &hListenSocket;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket.socket, &e) != 0) {
+                LogPrintf("epoll_ctl failed for listen socket: %s\n", NetworkErrorString(errno));
+                return false;
+            }
+        }
+    }
+#endif
+    return true;
+}
+
+void CConnman::ShutdownSocketEvents()
+{
+#ifdef USE_EPOLL
+    if (epollfd != -1) {
+        close(epollfd);
+        epollfd = -1;
+    }
+#endif
+}
+
+void CConnman::RegisterEvents(CNode *pnode)
+{
+#ifdef USE_EPOLL
+    if (socketEventsMode != SocketEventsMode::EPoll) {
+        return;
+    }
+
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET) {
+        return;
+    }
+
+    // Registered once for the lifetime of the socket. Closing the socket removes it from the epoll set
+    epoll_event e;
+    e.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    e.data.ptr = pnode;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &e) != 0) {
+        LogPrintf("epoll_ctl failed for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(errno));
+        pnode->fDisconnect = true;
+    }
 #endif
+}
 
 void CConnman::SocketHandler()
 {
@@ -1328,6 +1562,10 @@ void CConnman::SocketHandler()
         }
     }
 
+#ifdef USE_EPOLL
+    fEpollPendingWork = false;
+#endif
+
     //
     // Service each socket
     //
@@ -1349,13 +1587,24 @@ void CConnman::SocketHandler()
         bool recvSet = false;
         bool sendSet = false;
         bool errorSet = false;
+        bool fHasSendData = false;
+        if (socketEventsMode == SocketEventsMode::EPoll) {
+            LOCK(pnode->cs_vSend);
+            fHasSendData = !pnode->vSendMsg.empty();
+        }
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            recvSet = recv_set.count(pnode->hSocket) > 0;
-            sendSet = send_set.count(pnode->hSocket) > 0;
-            errorSet = error_set.count(pnode->hSocket) > 0;
+            if (socketEventsMode == SocketEventsMode::EPoll) {
+                // Same preference as in GenerateSelectSet: drain the send buffer first, only then receive more
+                sendSet = fHasSendData && pnode->fCanSendData;
+                recvSet = !fHasSendData && !pnode->fPauseRecv && pnode->fHasRecvData;
+            } else {
+                recvSet = recv_set.count(pnode->hSocket) > 0;
+                sendSet = send_set.count(pnode->hSocket) > 0;
+                errorSet = error_set.count(pnode->hSocket) > 0;
+            }
         }
         if (recvSet || errorSet)
         {
@@ -1368,6 +1617,16 @@ void CConnman::SocketHandler()
                     continue;
                 nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
             }
+#ifdef USE_EPOLL
+            if (socketEventsMode == SocketEventsMode::EPoll) {
+                // Edge-triggered, so keep reading in the next rounds until the socket would block
+                if (nBytes == (int)sizeof(pchBuf)) {
+                    fEpollPendingWork = true;
+                } else {
+                    pnode->fHasRecvData = false;
+                }
+            }
+#endif
             if (nBytes > 0)
             {
                 bool notify = false;
@@ -1422,6 +1681,17 @@ void CConnman::SocketHandler()
             if (nBytes) {
                 RecordBytesSent(nBytes);
             }
+#ifdef USE_EPOLL
+            if (socketEventsMode == SocketEventsMode::EPoll) {
+                if (!pnode->vSendMsg.empty()) {
+                    // socket buffer is full, wait for the next EPOLLOUT edge
+                    pnode->fCanSendData = false;
+                } else if (pnode->fHasRecvData && !pnode->fPauseRecv) {
+                    // receiving was skipped in favor of sending
+                    fEpollPendingWork = true;
+                }
+            }
+#endif
         }
 
         InactivityCheck(pnode);
@@ -1956,10 +2226,13 @@ void CConnman::ThreadOpenMasternodeConnections()
     if (gArgs.IsArgSet("-connect") && gArgs.GetArgs("-connect").size() > 0)
         return;
 
+    bool fMoreWork = false;
     while (!interruptNet)
     {
-        if (!interruptNet.sleep_for(std::chrono::milliseconds(1000)))
+        // don't wait the full second if the last round couldn't attempt all pending connections
+        if (!interruptNet.sleep_for(std::chrono::milliseconds(fMoreWork ? 100 : 1000)))
             return;
+        fMoreWork = false;
 
         std::set<CService> connectedNodes;
         std::set<uint256> connectedProRegTxHashes;
@@ -1972,63 +2245,135 @@ void CConnman::ThreadOpenMasternodeConnections()
 
         auto mnList = deterministicMNManager->GetListAtChainTip();
 
-        CSemaphoreGrant grant(*semMasternodeOutbound);
+        // wait for at least one free slot, then take as many more as are available right now
+        std::array<CSemaphoreGrant, MAX_PARALLEL_MASTERNODE_CONNECTS> grants;
+        size_t nGrants = 0;
+        CSemaphoreGrant(*semMasternodeOutbound).MoveTo(grants[nGrants++]);
         if (interruptNet)
             return;
+        while (nGrants < grants.size()) {
+            CSemaphoreGrant grant(*semMasternodeOutbound, true);
+            if (!grant) {
+                break;
+            }
+            grant.MoveTo(grants[nGrants++]);
+        }
 
-        int64_t nANow = GetAdjustedTime();
+        std::vector<CService> pending = SelectMasternodeConnections(mnList, connectedNodes, connectedProRegTxHashes, nGrants, fMoreWork);
+        if (pending.empty()) {
+            // nothing to do, keep waiting
+            continue;
+        }
 
-        // NOTE: Process only one pending masternode at a time
+        // connecting blocks until the connect timeout for unreachable masternodes, so the attempts are handed over
+        // to the connect threads together with their outbound slots
+        {
+            LOCK(cs_vPendingMasternodes);
+            masternodeConnectsInFlight.insert(pending.begin(), pending.end());
+        }
+        {
+            LOCK(mutexMasternodeConnects);
+            for (size_t i = 0; i < pending.size(); i++) {
+                masternodeConnectQueue.emplace_back(std::piecewise_construct, std::forward_as_tuple(pending[i]), std::forward_as_tuple());
+                grants[i].MoveTo(masternodeConnectQueue.back().second);
+            }
+        }
+        condMasternodeConnects.notify_all();
+    }
+}
 
-        CService addr;
-        { // don't hold lock while calling OpenMasternodeConnection as cs_main is locked deep inside
-            LOCK2(cs_vNodes, cs_vPendingMasternodes);
+std::vector<CService> CConnman::SelectMasternodeConnections(const CDeterministicMNList& mnList, const std::set<CService>& connectedNodes, const std::set<uint256>& connectedProRegTxHashes, size_t nMax, bool& fMoreWork)
+{
+    int64_t nANow = GetAdjustedTime();
 
-            std::vector<CService> pending;
-            for (const auto& group : masternodeQuorumNodes) {
-                for (const auto& proRegTxHash : group.second) {
-                    auto dmn = mnList.GetMN(proRegTxHash);
-                    if (!dmn) {
-                        continue;
-                    }
-                    const auto& addr2 = dmn->pdmnState->addr;
-                    if (!connectedNodes.count(addr2) && !IsMasternodeOrDisconnectRequested(addr2) && !connectedProRegTxHashes.count(proRegTxHash)) {
-                        auto addrInfo = addrman.GetAddressInfo(addr2);
-                        // back off trying connecting to an address if we already tried recently
-                        if (addrInfo.IsValid() && nANow - addrInfo.nLastTry < 60) {
-                            continue;
-                        }
-                        pending.emplace_back(addr2);
-                    }
-                }
-            }
+    LOCK2(cs_vNodes, cs_vPendingMasternodes);
 
-            if (!vPendingMasternodes.empty()) {
-                auto addr2 = vPendingMasternodes.front();
-                vPendingMasternodes.erase(vPendingMasternodes.begin());
-                if (!connectedNodes.count(addr2) && !IsMasternodeOrDisconnectRequested(addr2)) {
-                    pending.emplace_back(addr2);
-                }
+    auto isConnectCandidate = [&](const CService& addr2) {
+        return !connectedNodes.count(addr2) && !masternodeConnectsInFlight.count(addr2) && !IsMasternodeOrDisconnectRequested(addr2);
+    };
+
+    // members of quorums with an upcoming DKG go first, then all other quorum members and then probes
+    std::vector<CService> pendingPriority;
+    std::vector<CService> pendingQuorums;
+    std::set<CService> seen;
+    for (auto& group : masternodeQuorumNodes) {
+        bool fAllConnected = true;
+        for (const auto& proRegTxHash : group.second.proRegTxHashes) {
+            if (connectedProRegTxHashes.count(proRegTxHash)) {
+                continue;
             }
-
-            if (pending.empty()) {
-                // nothing to do, keep waiting
+            auto dmn = mnList.GetMN(proRegTxHash);
+            if (!dmn) {
+                continue;
+            }
+            const auto& addr2 = dmn->pdmnState->addr;
+            if (connectedNodes.count(addr2)) {
+                continue;
+            }
+            fAllConnected = false;
+            if (!isConnectCandidate(addr2) || !seen.emplace(addr2).second) {
+                continue;
+            }
+            auto addrInfo = addrman.GetAddressInfo(addr2);
+            // back off trying connecting to an address if we already tried recently
+            if (addrInfo.IsValid() && nANow - addrInfo.nLastTry < 60) {
                 continue;
             }
+            (group.second.fPriority ? pendingPriority : pendingQuorums).emplace_back(addr2);
+        }
+        // the DKG can start, connections to this quorum are not preferred anymore
+        if (fAllConnected) {
+            group.second.fPriority = false;
+        }
+    }
+
+    std::random_shuffle(pendingPriority.begin(), pendingPriority.end());
+    std::random_shuffle(pendingQuorums.begin(), pendingQuorums.end());
+    std::vector<CService> pending = std::move(pendingPriority);
+    pending.insert(pending.end(), pendingQuorums.begin(), pendingQuorums.end());
+
+    while (pending.size() < nMax && !vPendingMasternodes.empty()) {
+        auto addr2 = vPendingMasternodes.front();
+        vPendingMasternodes.erase(vPendingMasternodes.begin());
+        if (isConnectCandidate(addr2) && !seen.count(addr2)) {
+            pending.emplace_back(addr2);
+        }
+    }
+
+    if (pending.size() > nMax) {
+        pending.resize(nMax);
+        fMoreWork = true;
+    }
+    fMoreWork |= !vPendingMasternodes.empty();
+    return pending;
+}
 
-            std::random_shuffle(pending.begin(), pending.end());
-            addr = pending.front();
+void CConnman::ThreadMasternodeConnect()
+{
+    while (true) {
+        std::list<std::pair<CService, CSemaphoreGrant>> connect;
+        {
+            WAIT_LOCK(mutexMasternodeConnects, lock);
+            condMasternodeConnects.wait(lock, [this] { return interruptNet || !masternodeConnectQueue.empty(); });
+            if (interruptNet) {
+                return;
+            }
+            connect.splice(connect.begin(), masternodeConnectQueue, masternodeConnectQueue.begin());
         }
 
+        const CService& addr = connect.front().first;
         OpenMasternodeConnection(CAddress(addr, NODE_NETWORK));
         // should be in the list now if connection was opened
         ForNode(addr, [&](CNode* pnode) {
             if (pnode->fDisconnect) {
                 return false;
             }
-            grant.MoveTo(pnode->grantMasternodeOutbound);
+            connect.front().second.MoveTo(pnode->grantMasternodeOutbound);
             return true;
         });
+
+        LOCK(cs_vPendingMasternodes);
+        masternodeConnectsInFlight.erase(addr);
     }
 }
 
@@ -2068,6 +2413,7 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->fMasternode = true;
 
     m_msgproc->InitializeNode(pnode);
+    RegisterEvents(pnode);
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
@@ -2334,6 +2680,15 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         return false;
     }
 
+    if (!InitSocketEvents()) {
+        if (clientInterface) {
+            clientInterface->ThreadSafeMessageBox(
+                strprintf(_("Failed to initialize socket events mode %s.").translated, SocketEventsModeToString(socketEventsMode)),
+                "", CClientUIInterface::MSG_ERROR);
+        }
+        return false;
+    }
+
     for (const auto& strDest : connOptions.vSeedNodes) {
         AddOneShot(strDest);
     }
@@ -2408,6 +2763,9 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     // Initiate masternode connections
     threadOpenMasternodeConnections = std::thread(&TraceThread<std::function<void()> >, "mncon", std::function<void()>(std::bind(&CConnman::ThreadOpenMasternodeConnections, this)));
+    for (size_t i = 0; i < MAX_PARALLEL_MASTERNODE_CONNECTS; i++) {
+        threadsMasternodeConnect.emplace_back(&TraceThread<std::function<void()> >, "mnconnect", std::function<void()>(std::bind(&CConnman::ThreadMasternodeConnect, this)));
+    }
 
     // Process messages
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
@@ -2444,6 +2802,12 @@ void CConnman::Interrupt()
     interruptNet();
     InterruptSocks5(true);
 
+    {
+        // make sure the masternode connect threads see interruptNet before they wait again
+        LOCK(mutexMasternodeConnects);
+    }
+    condMasternodeConnects.notify_all();
+
     if (semOutbound) {
         for (int i=0; i<(nMaxOutbound + nMaxFeeler); i++) {
             semOutbound->post();
@@ -2470,6 +2834,15 @@ void CConnman::Stop()
         threadMessageHandler.join();
     if (threadOpenMasternodeConnections.joinable())
         threadOpenMasternodeConnections.join();
+    for (auto& thread : threadsMasternodeConnect) {
+        thread.join();
+    }
+    threadsMasternodeConnect.clear();
+    {
+        // release the outbound slots of the attempts which were not made anymore
+        LOCK(mutexMasternodeConnects);
+        masternodeConnectQueue.clear();
+    }
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2503,6 +2876,7 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+    ShutdownSocketEvents();
     semOutbound.reset();
     semAddnode.reset();
     semMasternodeOutbound.reset();
@@ -2809,17 +3183,25 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
+    CNetSendMsg sendMsg;
+    sendMsg.data = std::move(msg.data);
+    sendMsg.sharedData = std::move(msg.sharedData);
+
+    const auto& payload = sendMsg.GetPayload();
+    size_t nMessageSize = payload.size();
     size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
 
-    std::vector<unsigned char> serializedHeader;
-    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
+    // Shared payloads come with a precomputed checksum, so sending them to many peers only hashes them once
+    uint256 hash = sendMsg.sharedData ? sendMsg.sharedData->hash : Hash(payload.begin(), payload.end());
     CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
-    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+    unsigned char* pchHeader = sendMsg.header.data();
+    memcpy(pchHeader, hdr.pchMessageStart, CMessageHeader::MESSAGE_START_SIZE);
+    memcpy(pchHeader + CMessageHeader::MESSAGE_START_SIZE, hdr.pchCommand, CMessageHeader::COMMAND_SIZE);
+    WriteLE32(pchHeader + CMessageHeader::MESSAGE_SIZE_OFFSET, hdr.nMessageSize);
+    memcpy(pchHeader + CMessageHeader::CHECKSUM_OFFSET, hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE);
 
     size_t nBytesSent = 0;
     {
@@ -2830,11 +3212,16 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
         pnode->nSendSize += nTotalSize;
 
+        CNetMsgCommandStats& stats = NetMsgStats().Get(msg.command);
+        stats.nSendMsgs++;
+        stats.nSendBytes += nTotalSize;
+        stats.sendQueueDepth.Add(pnode->vSendMsg.size());
+        sendMsg.nTimeQueued = GetTimeMicros();
+        sendMsg.pStats = &stats;
+
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.push_back(std::move(sendMsg));
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
@@ -2927,13 +3314,18 @@ uint64_t CConnman::CalculateKeyedNetGroup(const CAddress& ad) const
     return GetDeterministicRandomizer(RANDOMIZER_ID_NETGROUP).Write(vchNetGroup.data(), vchNetGroup.size()).Finalize();
 }
 
-bool CConnman::AddMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash, const std::set<uint256>& proTxHashes)
+bool CConnman::AddMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash, const std::set<uint256>& proTxHashes, bool fPriority)
 {
     LOCK(cs_vPendingMasternodes);
     auto it = masternodeQuorumNodes.find(std::make_pair(llmqType, quorumHash));
-    if (it != masternodeQuorumNodes.end())
+    if (it != masternodeQuorumNodes.end()) {
+        it->second.fPriority |= fPriority;
         return false;
-    masternodeQuorumNodes.emplace(std::make_pair(llmqType, quorumHash), proTxHashes);
+    }
+    masternodeQuorumNodes.emplace(std::make_pair(llmqType, quorumHash), MasternodeQuorumTarget{proTxHashes, fPriority});
+    for (const auto& proTxHash : proTxHashes) {
+        masternodeQuorumRefs[proTxHash]++;
+    }
     return true;
 }
 
@@ -2962,7 +3354,7 @@ std::set<NodeId> CConnman::GetMasternodeQuorumNodes(Consensus::LLMQType llmqType
     if (it == masternodeQuorumNodes.end()) {
         return {};
     }
-    const auto& proRegTxHashes = it->second;
+    const auto& proRegTxHashes = it->second.proRegTxHashes;
 
     std::set<NodeId> nodes;
     for (const auto pnode : vNodes) {
@@ -2980,7 +3372,17 @@ std::set<NodeId> CConnman::GetMasternodeQuorumNodes(Consensus::LLMQType llmqType
 void CConnman::RemoveMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash)
 {
     LOCK(cs_vPendingMasternodes);
-    masternodeQuorumNodes.erase(std::make_pair(llmqType, quorumHash));
+    auto it = masternodeQuorumNodes.find(std::make_pair(llmqType, quorumHash));
+    if (it == masternodeQuorumNodes.end()) {
+        return;
+    }
+    for (const auto& proTxHash : it->second.proRegTxHashes) {
+        auto itRef = masternodeQuorumRefs.find(proTxHash);
+        if (itRef != masternodeQuorumRefs.end() && --itRef->second == 0) {
+            masternodeQuorumRefs.erase(itRef);
+        }
+    }
+    masternodeQuorumNodes.erase(it);
 }
 
 bool CConnman::IsMasternodeQuorumNode(const CNode* pnode)
@@ -2998,19 +3400,13 @@ bool CConnman::IsMasternodeQuorumNode(const CNode* pnode)
         assumedProTxHash = dmn->proTxHash;
     }
 
-    LOCK(cs_vPendingMasternodes);
-    for (const auto& p : masternodeQuorumNodes) {
-        if (!pnode->verifiedProRegTxHash.IsNull()) {
-            if (p.second.count(pnode->verifiedProRegTxHash)) {
-                return true;
-            }
-        } else if (!assumedProTxHash.IsNull()) {
-            if (p.second.count(assumedProTxHash)) {
-                return true;
-            }
-        }
+    const uint256& proTxHash = pnode->verifiedProRegTxHash.IsNull() ? assumedProTxHash : pnode->verifiedProRegTxHash;
+    if (proTxHash.IsNull()) {
+        return false;
     }
-    return false;
+
+    LOCK(cs_vPendingMasternodes);
+    return masternodeQuorumRefs.count(proTxHash) != 0;
 }
 
 void CConnman::RelayInv(CInv &inv, const int minProtoVersion)
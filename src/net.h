@@ -16,27 +16,33 @@
 #include <hash.h>
 #include <limitedmap.h>
 #include <netaddress.h>
+#include <netmsgstats.h>
 #include <policy/feerate.h>
 #include <protocol.h>
 #include <random.h>
+#include <saltedhasher.h>
 #include <streams.h>
 #include <sync.h>
 #include <uint256.h>
 #include <threadinterrupt.h>
 #include <validation.h>
 
+#include <array>
 #include <atomic>
 #include <deque>
+#include <list>
 #include <stdint.h>
 #include <thread>
 #include <memory>
 #include <condition_variable>
+#include <unordered_map>
 
 #ifndef WIN32
 #include <arpa/inet.h>
 #endif
 
 
+class CDeterministicMNList;
 class CScheduler;
 class CNode;
 class BanMan;
@@ -64,6 +70,8 @@ static const int MAX_ADDNODE_CONNECTIONS = 8;
 /** Maximum number if outgoing masternodes */
 static const int MAX_OUTBOUND_MASTERNODE_CONNECTIONS = 30;
 static const int MAX_OUTBOUND_MASTERNODE_CONNECTIONS_ON_MN = 250;
+/** Maximum number of masternode connections which are attempted concurrently */
+static const size_t MAX_PARALLEL_MASTERNODE_CONNECTS = 8;
 /** Eviction protection time for incoming connections  */
 static const int INBOUND_EVICTION_PROTECTION_TIME = 1;
 /** -listen default */
@@ -89,6 +97,27 @@ static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
+/** Backends which can be used by the socket handler thread to wait for socket events (-socketevents) */
+enum class SocketEventsMode {
+    Unknown,
+    Select,
+    Poll,
+    EPoll,
+};
+
+#if defined(USE_EPOLL)
+static const std::string DEFAULT_SOCKETEVENTS = "epoll";
+#elif defined(USE_POLL)
+static const std::string DEFAULT_SOCKETEVENTS = "poll";
+#else
+static const std::string DEFAULT_SOCKETEVENTS = "select";
+#endif
+
+SocketEventsMode SocketEventsModeFromString(const std::string& strMode);
+std::string SocketEventsModeToString(SocketEventsMode mode);
+/** Comma separated list of the socket events modes supported by this build */
+std::string GetSupportedSocketEventsModes();
+
 typedef int64_t NodeId;
 
 struct AddedNodeInfo
@@ -102,6 +131,22 @@ struct AddedNodeInfo
 class CNodeStats;
 class CClientUIInterface;
 
+/**
+ * A serialized message payload which can be queued for sending to many peers without being copied, e.g. a
+ * serialized block. The checksum is computed once when the payload is created.
+ */
+struct CSharedNetPayload
+{
+    explicit CSharedNetPayload(std::vector<unsigned char>&& dataIn) :
+        data(std::move(dataIn)),
+        hash(Hash(data.begin(), data.end()))
+    {
+    }
+
+    const std::vector<unsigned char> data;
+    const uint256 hash;
+};
+
 struct CSerializedNetMsg
 {
     CSerializedNetMsg() = default;
@@ -112,9 +157,34 @@ struct CSerializedNetMsg
     CSerializedNetMsg& operator=(const CSerializedNetMsg&) = delete;
 
     std::vector<unsigned char> data;
+    // If set, this is sent instead of data
+    std::shared_ptr<const CSharedNetPayload> sharedData;
     std::string command;
 };
 
+/**
+ * A message in the send queue of a peer. The header is stored inline so that queueing a message doesn't need an
+ * extra allocation for it, and the payload is either owned by the message or shared with other peers.
+ */
+struct CNetSendMsg
+{
+    CNetSendMsg() = default;
+    CNetSendMsg(CNetSendMsg&&) = default;
+    CNetSendMsg& operator=(CNetSendMsg&&) = default;
+    CNetSendMsg(const CNetSendMsg& msg) = delete;
+    CNetSendMsg& operator=(const CNetSendMsg&) = delete;
+
+    std::array<unsigned char, CMessageHeader::HEADER_SIZE> header;
+    std::vector<unsigned char> data;
+    std::shared_ptr<const CSharedNetPayload> sharedData;
+    // for telemetry
+    int64_t nTimeQueued{0};
+    CNetMsgCommandStats* pStats{nullptr};
+
+    const std::vector<unsigned char>& GetPayload() const { return sharedData ? sharedData->data : data; }
+    size_t size() const { return header.size() + GetPayload().size(); }
+};
+
 
 class NetEventsInterface;
 class CConnman
@@ -150,6 +220,7 @@ public:
         bool m_use_addrman_outgoing = true;
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
+        SocketEventsMode socketEventsMode = SocketEventsModeFromString(DEFAULT_SOCKETEVENTS);
     };
 
     void Init(const Options& connOptions) {
@@ -166,6 +237,7 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        socketEventsMode = connOptions.socketEventsMode;
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -205,6 +277,13 @@ public:
     bool ForNode(const CService& addr, std::function<bool(CNode* pnode)> func);
     bool IsMasternodeOrDisconnectRequested(const CService& addr);
 
+    /**
+     * Pick up to nMax masternodes to connect to: members of quorums with an upcoming DKG first, then the members of
+     * all other quorums and then the pending probes. Connected masternodes and attempts in progress are skipped.
+     * Priority quorums whose members are all connected lose their priority.
+     */
+    std::vector<CService> SelectMasternodeConnections(const CDeterministicMNList& mnList, const std::set<CService>& connectedNodes, const std::set<uint256>& connectedProRegTxHashes, size_t nMax, bool& fMoreWork);
+
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
 
     template<typename Callable>
@@ -333,7 +412,8 @@ public:
     */
     int64_t PoissonNextSendInbound(int64_t now, int average_interval_seconds);
 
-    bool AddMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash, const std::set<uint256>& proTxHashes);
+    // fPriority should be set for quorums with an upcoming DKG, their members are connected to before all others
+    bool AddMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash, const std::set<uint256>& proTxHashes, bool fPriority = false);
     bool HasMasternodeQuorumNodes(Consensus::LLMQType llmqType, const uint256& quorumHash);
     std::set<uint256> GetMasternodeQuorums(Consensus::LLMQType llmqType);
     // also returns QWATCH nodes
@@ -373,10 +453,22 @@ private:
     void InactivityCheck(CNode *pnode);
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+    void SocketEventsSelect(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#ifdef USE_POLL
+    void SocketEventsPoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#endif
+#ifdef USE_EPOLL
+    void SocketEventsEpoll(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+#endif
+    bool InitSocketEvents();
+    void ShutdownSocketEvents();
+    // Register a freshly created connection with the epoll backend. No-op for the other backends
+    void RegisterEvents(CNode* pnode);
     void SocketHandler();
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
     void ThreadOpenMasternodeConnections();
+    void ThreadMasternodeConnect();
 
     uint64_t CalculateKeyedNetGroup(const CAddress& ad) const;
 
@@ -425,6 +517,13 @@ private:
     unsigned int nSendBufferMaxSize{0};
     unsigned int nReceiveFloodSize{0};
 
+    SocketEventsMode socketEventsMode;
+#ifdef USE_EPOLL
+    int epollfd{-1};
+    // set by the socket handler when a node still has unhandled readiness, so the next epoll_wait doesn't block
+    bool fEpollPendingWork{false};
+#endif
+
     std::vector<ListenSocket> vhListenSocket;
     std::atomic<bool> fNetworkActive{true};
     bool fAddressesInitialized{false};
@@ -439,7 +538,15 @@ private:
     std::atomic<NodeId> nLastNodeId{0};
     unsigned int nPrevNodeCount{0};
     std::vector<CService> vPendingMasternodes;
-    std::map<std::pair<Consensus::LLMQType, uint256>, std::set<uint256>> masternodeQuorumNodes GUARDED_BY(cs_vPendingMasternodes);
+    struct MasternodeQuorumTarget {
+        std::set<uint256> proRegTxHashes;
+        bool fPriority;
+    };
+    std::map<std::pair<Consensus::LLMQType, uint256>, MasternodeQuorumTarget> masternodeQuorumNodes GUARDED_BY(cs_vPendingMasternodes);
+    // Number of quorums in masternodeQuorumNodes each masternode is a target of
+    std::unordered_map<uint256, int, StaticSaltedHasher> masternodeQuorumRefs GUARDED_BY(cs_vPendingMasternodes);
+    // Addresses with a connection attempt in progress
+    std::set<CService> masternodeConnectsInFlight GUARDED_BY(cs_vPendingMasternodes);
     mutable CCriticalSection cs_vPendingMasternodes;
 
     /** Services this instance offers */
@@ -468,6 +575,11 @@ private:
     Mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc{false};
 
+    // Masternode connection attempts waiting for a connect thread, each holding its outbound slot
+    std::list<std::pair<CService, CSemaphoreGrant>> masternodeConnectQueue GUARDED_BY(mutexMasternodeConnects);
+    std::condition_variable condMasternodeConnects;
+    Mutex mutexMasternodeConnects;
+
     CThreadInterrupt interruptNet;
 
     std::thread threadDNSAddressSeed;
@@ -475,6 +587,8 @@ private:
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadOpenMasternodeConnections;
+    // MAX_PARALLEL_MASTERNODE_CONNECTS threads making the connection attempts queued by threadOpenMasternodeConnections
+    std::vector<std::thread> threadsMasternodeConnect;
     std::thread threadMessageHandler;
 
     /** flag for deciding to connect to an extra outbound peer,
@@ -671,7 +785,7 @@ public:
     size_t nSendSize{0}; // total size of all vSendMsg entries
     size_t nSendOffset{0}; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    std::deque<CNetSendMsg> vSendMsg GUARDED_BY(cs_vSend);
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
@@ -680,6 +794,12 @@ public:
     std::list<CNetMessage> vProcessMsg GUARDED_BY(cs_vProcessMsg);
     size_t nProcessQueueSize{0};
 
+    // Messages handed over to the message processing pool of PeerLogicValidation. They are processed in order and
+    // no further messages of this peer are processed by the message handler thread while fPoolProcessing is set
+    CCriticalSection cs_vPoolProcessMsg;
+    std::list<CNetMessage> vPoolProcessMsg GUARDED_BY(cs_vPoolProcessMsg);
+    bool fPoolProcessing GUARDED_BY(cs_vPoolProcessMsg){false};
+
     CCriticalSection cs_sendProcessing;
 
     std::deque<CInv> vRecvGetData;
@@ -732,6 +852,9 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv{false};
     std::atomic_bool fPauseSend{false};
+    // Readiness as reported by the edge-triggered epoll backend. Only used with -socketevents=epoll
+    std::atomic_bool fHasRecvData{false};
+    std::atomic_bool fCanSendData{false};
 
 protected:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -751,9 +874,9 @@ public:
 
     // inventory based relay
     CRollingBloomFilter filterInventoryKnown GUARDED_BY(cs_inventory);
-    // Set of transaction ids we still have to announce.
-    // They are sorted by the mempool before relay, so the order is not important.
-    std::set<uint256> setInventoryTxToSend;
+    // Position of this peer in the shared transaction relay log (see txRelayQueue) up to which transactions were
+    // already considered for announcement.
+    uint64_t nTxRelayCursor GUARDED_BY(cs_inventory){0};
     // List of block ids we still have announce.
     // There is no final sorting before sending, as they are always sent immediately
     // and in the order requested.
@@ -905,11 +1028,7 @@ public:
     void PushInventory(const CInv& inv)
     {
         LOCK(cs_inventory);
-        if (inv.type == MSG_TX) {
-            if (!filterInventoryKnown.contains(inv.hash)) {
-                setInventoryTxToSend.insert(inv.hash);
-            }
-        } else if (inv.type == MSG_BLOCK) {
+        if (inv.type == MSG_BLOCK) {
             vInventoryBlockToSend.push_back(inv.hash);
         } else {
             if (!filterInventoryKnown.contains(inv.hash)) {
@@ -11,24 +11,30 @@
 #include <arith_uint256.h>
 #include <blockencodings.h>
 #include <chainparams.h>
+#include <consensus/consensus.h>
 #include <consensus/validation.h>
 #include <hash.h>
 #include <validation.h>
 #include <merkleblock.h>
 #include <netmessagemaker.h>
+#include <netmsgstats.h>
 #include <netbase.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <random.h>
+#include <relaypayloadcache.h>
 #include <reverse_iterator.h>
+#include <saltedhasher.h>
 #include <scheduler.h>
 #include <tinyformat.h>
 #include <txmempool.h>
+#include <txrelay.h>
 #include <util/init.h>
 #include <util/system.h>
 #include <util/strencodings.h>
+#include <util/threadnames.h>
 #include <util/validation.h>
 
 #include <spork.h>
@@ -197,12 +203,6 @@ namespace {
     /** When our tip was last updated. */
     std::atomic<int64_t> g_last_tip_update(0);
 
-    /** Relay map */
-    typedef std::map<uint256, CTransactionRef> MapRelay;
-    MapRelay mapRelay GUARDED_BY(cs_main);
-    /** Expiration-time ordered list of (expire time, relay map entry) pairs. */
-    std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration GUARDED_BY(cs_main);
-
     struct IteratorComparator
     {
         template<typename I>
@@ -217,6 +217,17 @@ namespace {
 
     static size_t vExtraTxnForCompactIt GUARDED_BY(g_cs_orphans) = 0;
     static std::vector<std::pair<uint256, CTransactionRef>> vExtraTxnForCompact GUARDED_BY(g_cs_orphans);
+
+    /**
+     * InstantSend-locked transactions which are not mined yet. Locked transactions will be mined, so they are kept for
+     * compact block reconstruction even if they leave (or never made it into) the mempool. Like vExtraTxnForCompact,
+     * this is a ring buffer of the most recently locked transactions in <witness hash, reference> form, so that it can
+     * be passed to PartiallyDownloadedBlock::InitData as is. mapLockedTxForCompact maps txids to their slot, mined
+     * transactions are removed from both.
+     */
+    static size_t vLockedTxForCompactIt GUARDED_BY(g_cs_orphans) = 0;
+    static std::vector<std::pair<uint256, CTransactionRef>> vLockedTxForCompact GUARDED_BY(g_cs_orphans);
+    static std::unordered_map<uint256, size_t, StaticSaltedHasher> mapLockedTxForCompact GUARDED_BY(g_cs_orphans);
 } // namespace
 
 namespace {
@@ -957,6 +968,11 @@ void PeerLogicValidation::InitializeNode(CNode *pnode) {
         LOCK(cs_main);
         mapNodeState.emplace_hint(mapNodeState.end(), std::piecewise_construct, std::forward_as_tuple(nodeid), std::forward_as_tuple(addr, std::move(addrName), pnode->fInbound, pnode->m_manual_connection));
     }
+    {
+        // Only announce transactions which are relayed after the peer connected
+        LOCK(pnode->cs_inventory);
+        pnode->nTxRelayCursor = txRelayQueue.GetEndSequence();
+    }
     if(!pnode->fInbound)
         PushNodeVersion(pnode, connman, GetTime());
 }
@@ -1027,6 +1043,33 @@ static void AddToCompactExtraTransactions(const CTransactionRef& tx) EXCLUSIVE_L
     vExtraTxnForCompactIt = (vExtraTxnForCompactIt + 1) % max_extra_txn;
 }
 
+static void AddLockedTxForCompact(const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    if (mapLockedTxForCompact.count(tx->GetHash())) {
+        return;
+    }
+    if (vLockedTxForCompact.empty()) {
+        vLockedTxForCompact.resize(MAX_LOCKED_TXN_FOR_COMPACT);
+    }
+    auto& slot = vLockedTxForCompact[vLockedTxForCompactIt];
+    if (slot.second) {
+        mapLockedTxForCompact.erase(slot.second->GetHash());
+    }
+    slot = std::make_pair(tx->GetWitnessHash(), tx);
+    mapLockedTxForCompact.emplace(tx->GetHash(), vLockedTxForCompactIt);
+    vLockedTxForCompactIt = (vLockedTxForCompactIt + 1) % MAX_LOCKED_TXN_FOR_COMPACT;
+}
+
+static void RemoveLockedTxForCompact(const uint256& txid) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
+{
+    auto it = mapLockedTxForCompact.find(txid);
+    if (it == mapLockedTxForCompact.end()) {
+        return;
+    }
+    vLockedTxForCompact[it->second] = std::make_pair(uint256(), nullptr);
+    mapLockedTxForCompact.erase(it);
+}
+
 bool AddOrphanTx(const CTransactionRef& tx, NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans)
 {
     const uint256& hash = tx->GetHash();
@@ -1288,8 +1331,12 @@ static bool BlockRequestAllowed(const CBlockIndex* pindex, const Consensus::Para
         (GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, consensusParams) < STALE_RELAY_AGE_LIMIT);
 }
 
-PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn, BanMan* banman, CScheduler &scheduler, bool enable_bip61)
-    : connman(connmanIn), m_banman(banman), m_stale_tip_check_time(0), m_enable_bip61(enable_bip61) {
+PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn, BanMan* banman, CScheduler &scheduler, bool enable_bip61, int nMsgProcThreads)
+    : connman(connmanIn), m_banman(banman), m_msgproc_threads(nMsgProcThreads),
+      msgProcPool([this](CNode* pfrom, CNetMessage& msg) { ProcessPoolMessage(pfrom, msg); },
+                  // the message handler thread might be waiting for the pool to continue with a peer
+                  [this]() { connman->WakeMessageHandler(); }),
+      m_stale_tip_check_time(0), m_enable_bip61(enable_bip61) {
     // Initialize global variables that cannot be constructed at startup.
     recentRejects.reset(new CRollingBloomFilter(120000, 0.000001));
 
@@ -1300,6 +1347,15 @@ PeerLogicValidation::PeerLogicValidation(CConnman* connmanIn, BanMan* banman, CS
     // timer.
     static_assert(EXTRA_PEER_CHECK_INTERVAL < STALE_CHECK_INTERVAL, "peer eviction timer should be less than stale tip check timer");
     scheduler.scheduleEvery(std::bind(&PeerLogicValidation::CheckForStaleTipAndEvictPeers, this, consensusParams), EXTRA_PEER_CHECK_INTERVAL * 1000);
+
+    if (m_msgproc_threads > 0) {
+        msgProcPool.Start(m_msgproc_threads, "bitgreen-msgproc");
+    }
+}
+
+PeerLogicValidation::~PeerLogicValidation()
+{
+    StopMessageProcessingPool();
 }
 
 /**
@@ -1335,6 +1391,13 @@ void PeerLogicValidation::BlockConnected(const std::shared_ptr<const CBlock>& pb
         LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx included or conflicted by block\n", nErased);
     }
 
+    for (const CTransactionRef& ptx : pblock->vtx) {
+        RemoveLockedTxForCompact(ptx->GetHash());
+    }
+
+    // No need to announce transactions which were just mined
+    txRelayQueue.Remove(pblock->vtx);
+
     g_last_tip_update = GetTime();
 }
 
@@ -1345,14 +1408,16 @@ static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_bloc
 static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
 static bool fWitnessesPresentInMostRecentCompactBlock GUARDED_BY(cs_most_recent_block);
 
+// Blocks are large, only keep the few most recent ones in their different serializations
+static CRelayPayloadCache blockRelayCache(32, 4 * MAX_BLOCK_SERIALIZED_SIZE);
+static CRelayPayloadCache llmqRelayCache(10000, 16 * 1024 * 1024);
+
 /**
  * Maintain state about the best-seen block and fast-announce a compact block
  * to compatible peers.
  */
 void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) {
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs> (*pblock, true);
-    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
-
     LOCK(cs_main);
 
     static int nHighestFastAnnounce = 0;
@@ -1371,10 +1436,9 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
         fWitnessesPresentInMostRecentCompactBlock = fWitnessEnabled;
     }
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
+    connman->ForEachNode([this, &pcmpctblock, pindex, fWitnessEnabled, &hashBlock](CNode* pnode) {
         AssertLockHeld(cs_main);
 
-        // TODO: Avoid the repeated-serialization here
         if (pnode->nVersion < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -1386,12 +1450,22 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            connman->PushMessage(pnode, blockRelayCache.Make(PROTOCOL_VERSION, 0, NetMsgType::CMPCTBLOCK, MSG_CMPCT_BLOCK, hashBlock, *pcmpctblock));
             state.pindexBestHeaderSent = pindex;
         }
     });
 }
 
+void PeerLogicValidation::NotifyTransactionLock(const CTransaction& tx) {
+    // share the transaction with the mempool if it's in there
+    CTransactionRef ptx = mempool.get(tx.GetHash());
+    if (!ptx) {
+        ptx = MakeTransactionRef(tx);
+    }
+    LOCK(g_cs_orphans);
+    AddLockedTxForCompact(ptx);
+}
+
 /**
  * Update our best height and announce any block hashes which weren't previously
  * in ::ChainActive() to our peers.
@@ -1466,6 +1540,72 @@ void PeerLogicValidation::BlockChecked(const CBlock& block, const CValidationSta
 // Messages
 //
 
+/** Accounts the time between construction and Stop() as lock wait time of the given message type */
+class CMessageLockWaitTimer
+{
+private:
+    CNetMsgCommandStats& stats;
+    const int64_t nStart;
+
+public:
+    explicit CMessageLockWaitTimer(const std::string& strCommand) :
+        stats(NetMsgStats().Get(strCommand)),
+        nStart(GetTimeMicros())
+    {
+    }
+
+    void Stop()
+    {
+        stats.lockWaitTime.Add(GetTimeMicros() - nStart);
+    }
+};
+
+/** Like LOCK/LOCK2, but also records the time waited for the lock(s) in the per message type telemetry */
+#define MSG_LOCK(strCommand, cs)                                                  \
+    CMessageLockWaitTimer PASTE2(msgLockWaitTimer, __LINE__)(strCommand);         \
+    LOCK(cs);                                                                     \
+    PASTE2(msgLockWaitTimer, __LINE__).Stop()
+#define MSG_LOCK2(strCommand, cs1, cs2)                                           \
+    CMessageLockWaitTimer PASTE2(msgLockWaitTimer, __LINE__)(strCommand);         \
+    LOCK2(cs1, cs2);                                                              \
+    PASTE2(msgLockWaitTimer, __LINE__).Stop()
+
+/**
+ * LLMQ and InstantSend inventory. AlreadyHave and getdata for these only consult the LLMQ managers and are thus
+ * handled without cs_main, so that their relay doesn't stall while blocks are being validated.
+ */
+static bool IsLLMQInv(int nType)
+{
+    switch (nType) {
+    case MSG_QUORUM_CONTRIB:
+    case MSG_QUORUM_COMPLAINT:
+    case MSG_QUORUM_JUSTIFICATION:
+    case MSG_QUORUM_PREMATURE_COMMITMENT:
+    case MSG_QUORUM_RECOVERED_SIG:
+    case MSG_CLSIG:
+    case MSG_ISLOCK:
+        return true;
+    }
+    return false;
+}
+
+static bool AlreadyHaveLLMQ(const CInv& inv)
+{
+    switch (inv.type) {
+    case MSG_QUORUM_CONTRIB:
+    case MSG_QUORUM_COMPLAINT:
+    case MSG_QUORUM_JUSTIFICATION:
+    case MSG_QUORUM_PREMATURE_COMMITMENT:
+        return llmq::quorumDKGSessionManager->AlreadyHave(inv);
+    case MSG_QUORUM_RECOVERED_SIG:
+        return llmq::quorumSigningManager->AlreadyHave(inv);
+    case MSG_CLSIG:
+        return llmq::chainLocksHandler->AlreadyHave(inv);
+    case MSG_ISLOCK:
+        return llmq::quorumInstantSendManager->AlreadyHave(inv);
+    }
+    return true;
+}
 
 bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
@@ -1522,26 +1662,19 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     case MSG_QUORUM_COMPLAINT:
     case MSG_QUORUM_JUSTIFICATION:
     case MSG_QUORUM_PREMATURE_COMMITMENT:
-        return llmq::quorumDKGSessionManager->AlreadyHave(inv);
     case MSG_QUORUM_RECOVERED_SIG:
-        return llmq::quorumSigningManager->AlreadyHave(inv);
     case MSG_CLSIG:
-        return llmq::chainLocksHandler->AlreadyHave(inv);
     case MSG_ISLOCK:
-        return llmq::quorumInstantSendManager->AlreadyHave(inv);
+        return AlreadyHaveLLMQ(inv);
     }
 
     // Don't know what it is, just say we already got one
     return true;
 }
 
-static void RelayTransaction(const CTransaction& tx, CConnman* connman)
+static void RelayTransaction(const CTransaction& tx)
 {
-    CInv inv(MSG_TX, tx.GetHash());
-    connman->ForEachNode([&inv](CNode* pnode)
-    {
-        pnode->PushInventory(inv);
-    });
+    txRelayQueue.Add(tx.GetHash());
 }
 
 static void RelayAddress(const CAddress& addr, bool fReachable, CConnman* connman)
@@ -1670,8 +1803,14 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
             pblock = pblockRead;
         }
         if (pblock) {
-            if (inv.type == MSG_BLOCK)
+            // The most recent block is usually requested by many peers, serialize it only once
+            const bool fRecentBlock = pblock == a_recent_block;
+            if (inv.type == MSG_BLOCK && fRecentBlock)
+                connman->PushMessage(pfrom, blockRelayCache.Make(pfrom->GetSendVersion(), SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, MSG_BLOCK, pblock->GetHash(), *pblock));
+            else if (inv.type == MSG_BLOCK)
                 connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
+            else if (inv.type == MSG_WITNESS_BLOCK && fRecentBlock)
+                connman->PushMessage(pfrom, blockRelayCache.Make(pfrom->GetSendVersion(), 0, NetMsgType::BLOCK, MSG_BLOCK, pblock->GetHash(), *pblock));
             else if (inv.type == MSG_WITNESS_BLOCK)
                 connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
             else if (inv.type == MSG_FILTERED_BLOCK)
@@ -1710,7 +1849,7 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
                 int nSendFlags = fPeerWantsWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
                 if (CanDirectFetch(consensusParams) && pindex->nHeight >= ::ChainActive().Height() - MAX_CMPCTBLOCK_DEPTH) {
                     if ((fPeerWantsWitness || !fWitnessesPresentInARecentCompactBlock) && a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
-                        connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
+                        connman->PushMessage(pfrom, blockRelayCache.Make(pfrom->GetSendVersion(), nSendFlags, NetMsgType::CMPCTBLOCK, MSG_CMPCT_BLOCK, pindex->GetBlockHash(), *a_recent_compact_block));
                     } else {
                         CBlockHeaderAndShortTxIDs cmpctblock(*pblock, fPeerWantsWitness);
                         connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
@@ -1735,6 +1874,70 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
     }
 }
 
+static bool PushLLMQInv(CNode* pfrom, const CInv& inv, CConnman* connman, const CNetMsgMaker& msgMaker)
+{
+    switch (inv.type) {
+    case MSG_QUORUM_CONTRIB: {
+        llmq::CDKGContribution o;
+        if (llmq::quorumDKGSessionManager->GetContribution(inv.hash, o)) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::QCONTRIB, o));
+            return true;
+        }
+        break;
+    }
+    case MSG_QUORUM_COMPLAINT: {
+        llmq::CDKGComplaint o;
+        if (llmq::quorumDKGSessionManager->GetComplaint(inv.hash, o)) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::QCOMPLAINT, o));
+            return true;
+        }
+        break;
+    }
+    case MSG_QUORUM_JUSTIFICATION: {
+        llmq::CDKGJustification o;
+        if (llmq::quorumDKGSessionManager->GetJustification(inv.hash, o)) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::QJUSTIFICATION, o));
+            return true;
+        }
+        break;
+    }
+    case MSG_QUORUM_PREMATURE_COMMITMENT: {
+        llmq::CDKGPrematureCommitment o;
+        if (llmq::quorumDKGSessionManager->GetPrematureCommitment(inv.hash, o)) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::QPCOMMITMENT, o));
+            return true;
+        }
+        break;
+    }
+    case MSG_QUORUM_RECOVERED_SIG: {
+        llmq::CRecoveredSig o;
+        if (llmq::quorumSigningManager->GetRecoveredSigForGetData(inv.hash, o)) {
+            connman->PushMessage(pfrom, llmqRelayCache.Make(pfrom->GetSendVersion(), 0, NetMsgType::QSIGREC, MSG_QUORUM_RECOVERED_SIG, inv.hash, o));
+            return true;
+        }
+        break;
+    }
+    case MSG_CLSIG: {
+        llmq::CChainLockSig o;
+        if (llmq::chainLocksHandler->GetChainLockByHash(inv.hash, o)) {
+            connman->PushMessage(pfrom, llmqRelayCache.Make(pfrom->GetSendVersion(), 0, NetMsgType::CLSIG, MSG_CLSIG, inv.hash, o));
+            return true;
+        }
+        break;
+    }
+    case MSG_ISLOCK: {
+        llmq::CInstantSendLock o;
+        if (llmq::quorumInstantSendManager->GetInstantSendLockByHash(inv.hash, o)) {
+            connman->PushMessage(pfrom, llmqRelayCache.Make(pfrom->GetSendVersion(), 0, NetMsgType::ISLOCK, MSG_ISLOCK, inv.hash, o));
+            return true;
+        }
+        break;
+    }
+    }
+
+    return false;
+}
+
 void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc) LOCKS_EXCLUDED(cs_main)
 {
     AssertLockNotHeld(cs_main);
@@ -1742,8 +1945,19 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
     std::vector<CInv> vNotFound;
     const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
-    {
-        LOCK(cs_main);
+
+    // Serve LLMQ inventory we have without cs_main. Whatever is left (including LLMQ inventory we don't have, which
+    // needs the request bookkeeping below) is handled while holding cs_main
+    while (it != pfrom->vRecvGetData.end() && IsLLMQInv(it->type) && !pfrom->fPauseSend) {
+        if (interruptMsgProc)
+            return;
+        if (!PushLLMQInv(pfrom, *it, connman, msgMaker))
+            break;
+        it++;
+    }
+
+    if (it != pfrom->vRecvGetData.end()) {
+        MSG_LOCK(NetMsgType::GETDATA, cs_main);
 
         while (it != pfrom->vRecvGetData.end() && it->IsKnownType()) {
 
@@ -1767,10 +1981,10 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
             // Send stream from relay memory
             bool push = false;
             if (inv.type == MSG_TX || inv.type == MSG_WITNESS_TX) {
-              auto mi = mapRelay.find(inv.hash);
+              CTransactionRef txRelay = txRelayQueue.Find(inv.hash);
               int nSendFlags = (inv.type == MSG_TX ? SERIALIZE_TRANSACTION_NO_WITNESS : 0);
-              if (mi != mapRelay.end()) {
-                  connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *mi->second));
+              if (txRelay) {
+                  connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *txRelay));
                   push = true;
               } else if (pfrom->timeLastMempoolReq) {
                   auto txinfo = mempool.info(inv.hash);
@@ -1836,60 +2050,8 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
                 }
             }
 
-            if (!push && (inv.type == MSG_QUORUM_CONTRIB)) {
-                llmq::CDKGContribution o;
-                if (llmq::quorumDKGSessionManager->GetContribution(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::QCONTRIB, o));
-                    push = true;
-                }
-            }
-
-            if (!push && (inv.type == MSG_QUORUM_COMPLAINT)) {
-                llmq::CDKGComplaint o;
-                if (llmq::quorumDKGSessionManager->GetComplaint(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::QCOMPLAINT, o));
-                    push = true;
-                }
-            }
-
-            if (!push && (inv.type == MSG_QUORUM_JUSTIFICATION)) {
-                llmq::CDKGJustification o;
-                if (llmq::quorumDKGSessionManager->GetJustification(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::QJUSTIFICATION, o));
-                    push = true;
-                }
-            }
-
-            if (!push && (inv.type == MSG_QUORUM_PREMATURE_COMMITMENT)) {
-                llmq::CDKGPrematureCommitment o;
-                if (llmq::quorumDKGSessionManager->GetPrematureCommitment(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::QPCOMMITMENT, o));
-                    push = true;
-                }
-            }
-
-            if (!push && (inv.type == MSG_QUORUM_RECOVERED_SIG)) {
-                llmq::CRecoveredSig o;
-                if (llmq::quorumSigningManager->GetRecoveredSigForGetData(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::QSIGREC, o));
-                    push = true;
-                }
-            }
-
-            if (!push && (inv.type == MSG_CLSIG)) {
-                llmq::CChainLockSig o;
-                if (llmq::chainLocksHandler->GetChainLockByHash(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CLSIG, o));
-                    push = true;
-                }
-            }
-
-            if (!push && (inv.type == MSG_ISLOCK)) {
-                llmq::CInstantSendLock o;
-                if (llmq::quorumInstantSendManager->GetInstantSendLockByHash(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::ISLOCK, o));
-                    push = true;
-                }
+            if (!push && IsLLMQInv(inv.type)) {
+                push = PushLLMQInv(pfrom, inv, connman, msgMaker);
             }
 
             if (!push) {
@@ -1966,6 +2128,10 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
         return true;
     }
 
+    // Hash the headers before taking cs_main
+    std::vector<uint256> hashes;
+    GetBlockHeaderHashes(headers, hashes);
+
     bool received_new_header = false;
     const CBlockIndex *pindexLast = nullptr;
     {
@@ -1984,14 +2150,14 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
             nodestate->nUnconnectingHeaders++;
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::GETHEADERS, ::ChainActive().GetLocator(pindexBestHeader), uint256()));
             LogPrint(BCLog::NET, "received header %s: missing prev block %s, sending getheaders (%d) to end (peer=%d, nUnconnectingHeaders=%d)\n",
-                    headers[0].GetHash().ToString(),
+                    hashes[0].ToString(),
                     headers[0].hashPrevBlock.ToString(),
                     pindexBestHeader->nHeight,
                     pfrom->GetId(), nodestate->nUnconnectingHeaders);
             // Set hashLastUnknownBlock for this peer, so that if we
             // eventually get the headers - even from a different peer -
             // we can use this peer to download.
-            UpdateBlockAvailability(pfrom->GetId(), headers.back().GetHash());
+            UpdateBlockAvailability(pfrom->GetId(), hashes.back());
 
             if (nodestate->nUnconnectingHeaders % MAX_UNCONNECTING_HEADERS == 0) {
                 Misbehaving(pfrom->GetId(), 20);
@@ -1999,25 +2165,23 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
             return true;
         }
 
-        uint256 hashLastBlock;
-        for (const CBlockHeader& header : headers) {
-            if (!hashLastBlock.IsNull() && header.hashPrevBlock != hashLastBlock) {
+        for (size_t i = 1; i < nCount; i++) {
+            if (headers[i].hashPrevBlock != hashes[i - 1]) {
                 Misbehaving(pfrom->GetId(), 20, "non-continuous headers sequence");
                 return false;
             }
-            hashLastBlock = header.GetHash();
         }
 
         // If we don't have the last header, then they'll have given us
         // something new (if these headers are valid).
-        if (!LookupBlockIndex(hashLastBlock)) {
+        if (!LookupBlockIndex(hashes.back())) {
             received_new_header = true;
         }
     }
 
     CValidationState state;
     CBlockHeader first_invalid_header;
-    if (!ProcessNewBlockHeaders(headers, state, chainparams, &pindexLast, &first_invalid_header)) {
+    if (!ProcessNewBlockHeaders(headers, hashes, state, chainparams, &pindexLast, &first_invalid_header)) {
         if (state.IsInvalid()) {
             MaybePunishNode(pfrom->GetId(), state, via_compact_block, "invalid header received");
             return false;
@@ -2162,7 +2326,7 @@ void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_se
         if (setMisbehaving.count(fromPeer)) continue;
         if (AcceptToMemoryPool(mempool, orphan_state, porphanTx, &fMissingInputs2, &removed_txn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
             LogPrint(BCLog::MEMPOOL, "   accepted orphan tx %s\n", orphanHash.ToString());
-            RelayTransaction(orphanTx, connman);
+            RelayTransaction(orphanTx);
             for (unsigned int i = 0; i < orphanTx.vout.size(); i++) {
                 auto it_by_prev = mapOrphanTransactionsByPrev.find(COutPoint(orphanHash, i));
                 if (it_by_prev != mapOrphanTransactionsByPrev.end()) {
@@ -2224,7 +2388,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                strCommand == NetMsgType::FILTERADD))
     {
         if (pfrom->nVersion >= NO_BLOOM_VERSION) {
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             Misbehaving(pfrom->GetId(), 100);
             return false;
         } else {
@@ -2265,7 +2429,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             if (enable_bip61) {
                 connman->PushMessage(pfrom, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REJECT, strCommand, REJECT_DUPLICATE, std::string("Duplicate version message")));
             }
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             Misbehaving(pfrom->GetId(), 1);
             return false;
         }
@@ -2379,13 +2543,13 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
         if((nServices & NODE_WITNESS))
         {
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             State(pfrom->GetId())->fHaveWitness = true;
         }
 
         // Potentially mark this peer as a preferred download peer.
         {
-        LOCK(cs_main);
+        MSG_LOCK(strCommand, cs_main);
         UpdatePreferredDownload(pfrom, State(pfrom->GetId()));
         }
 
@@ -2445,7 +2609,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
     if (pfrom->nVersion == 0) {
         // Must have a version message before anything else
-        LOCK(cs_main);
+        MSG_LOCK(strCommand, cs_main);
         Misbehaving(pfrom->GetId(), 1);
         return false;
     }
@@ -2459,7 +2623,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
         if (!pfrom->fInbound) {
             // Mark this node as currently connected, so we update its timestamp later.
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             State(pfrom->GetId())->fCurrentlyConnected = true;
             LogPrintf("New outbound peer connected: version: %d, blocks=%d, peer=%d%s\n",
                       pfrom->nVersion.load(), pfrom->nStartingHeight, pfrom->GetId(),
@@ -2504,7 +2668,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
     if (!pfrom->fSuccessfullyConnected) {
         // Must have a verack message before anything else
-        LOCK(cs_main);
+        MSG_LOCK(strCommand, cs_main);
         Misbehaving(pfrom->GetId(), 1);
         return false;
     }
@@ -2518,7 +2682,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         if (vAddr.size() > 1000)
         {
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             Misbehaving(pfrom->GetId(), 20, strprintf("message addr size() = %u", vAddr.size()));
             return false;
         }
@@ -2561,7 +2725,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     }
 
     if (strCommand == NetMsgType::SENDHEADERS) {
-        LOCK(cs_main);
+        MSG_LOCK(strCommand, cs_main);
         State(pfrom->GetId())->fPreferHeaders = true;
         return true;
     }
@@ -2571,7 +2735,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         uint64_t nCMPCTBLOCKVersion = 0;
         vRecv >> fAnnounceUsingCMPCTBLOCK >> nCMPCTBLOCKVersion;
         if (nCMPCTBLOCKVersion == 1 || ((pfrom->GetLocalServices() & NODE_WITNESS) && nCMPCTBLOCKVersion == 2)) {
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             // fProvidesHeaderAndIDs is used to "lock in" version of compact blocks we send (fWantsCmpctWitness)
             if (!State(pfrom->GetId())->fProvidesHeaderAndIDs) {
                 State(pfrom->GetId())->fProvidesHeaderAndIDs = true;
@@ -2601,7 +2765,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         vRecv >> vInv;
         if (vInv.size() > MAX_INV_SZ)
         {
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             Misbehaving(pfrom->GetId(), 20, strprintf("message inv size() = %u", vInv.size()));
             return false;
         }
@@ -2612,7 +2776,23 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         if (pfrom->fWhitelisted && gArgs.GetBoolArg("-whitelistrelay", DEFAULT_WHITELISTRELAY))
             fBlocksOnly = false;
 
-        LOCK(cs_main);
+        if (!fBlocksOnly) {
+            // LLMQ and InstantSend inventory is usually announced by many peers at once and we mostly have it
+            // already. Filter these out without cs_main, so that their relay doesn't wait for block validation
+            vInv.erase(std::remove_if(vInv.begin(), vInv.end(), [&](const CInv& inv) {
+                if (!IsLLMQInv(inv.type) || !AlreadyHaveLLMQ(inv)) {
+                    return false;
+                }
+                LogPrint(BCLog::NET, "got inv: %s  have peer=%d\n", inv.ToString(), pfrom->GetId());
+                pfrom->AddInventoryKnown(inv);
+                return true;
+            }), vInv.end());
+            if (vInv.empty()) {
+                return true;
+            }
+        }
+
+        MSG_LOCK(strCommand, cs_main);
 
         uint32_t nFetchFlags = GetFetchFlags(pfrom);
         int64_t nNow = GetTimeMicros();
@@ -2663,7 +2843,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
         if (vInv.size() > MAX_INV_SZ)
         {
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             Misbehaving(pfrom->GetId(), 20, strprintf("message getdata size() = %u", vInv.size()));
             return false;
         }
@@ -2709,7 +2889,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             }
         }
 
-        LOCK(cs_main);
+        MSG_LOCK(strCommand, cs_main);
 
         // Find the last block the caller has in the main chain
         const CBlockIndex* pindex = FindForkInGlobalIndex(::ChainActive(), locator);
@@ -2755,7 +2935,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
-        LOCK(cs_main);
+        MSG_LOCK(strCommand, cs_main);
 
         const CBlockIndex* pindex = LookupBlockIndex(req.blockhash);
         if (!pindex || !(pindex->nStatus & BLOCK_HAVE_DATA)) {
@@ -2799,7 +2979,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             return true;
         }
 
-        LOCK(cs_main);
+        MSG_LOCK(strCommand, cs_main);
         if (::ChainstateActive().IsInitialBlockDownload() && !pfrom->fWhitelisted) {
             LogPrint(BCLog::NET, "Ignoring getheaders from peer=%d because node is in initial block download\n", pfrom->GetId());
             return true;
@@ -2871,7 +3051,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         CInv inv(MSG_TX, tx.GetHash());
         pfrom->AddInventoryKnown(inv);
 
-        LOCK2(cs_main, g_cs_orphans);
+        MSG_LOCK2(strCommand, cs_main, g_cs_orphans);
 
         bool fMissingInputs = false;
         CValidationState state;
@@ -2886,7 +3066,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         if (!AlreadyHave(inv) &&
             AcceptToMemoryPool(mempool, state, ptx, &fMissingInputs, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
             mempool.check(pcoinsTip.get());
-            RelayTransaction(tx, connman);
+            RelayTransaction(tx);
             for (unsigned int i = 0; i < tx.vout.size(); i++) {
                 auto it_by_prev = mapOrphanTransactionsByPrev.find(COutPoint(inv.hash, i));
                 if (it_by_prev != mapOrphanTransactionsByPrev.end()) {
@@ -2965,7 +3145,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                     LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s)\n", tx.GetHash().ToString(), pfrom->GetId(), FormatStateMessage(state));
                 } else {
                     LogPrintf("Force relaying tx %s from whitelisted peer=%d\n", tx.GetHash().ToString(), pfrom->GetId());
-                    RelayTransaction(tx, connman);
+                    RelayTransaction(tx);
                 }
             }
         }
@@ -3012,7 +3192,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         bool received_new_header = false;
 
         {
-        LOCK(cs_main);
+        MSG_LOCK(strCommand, cs_main);
 
         if (!LookupBlockIndex(cmpctblock.header.hashPrevBlock)) {
             // Doesn't connect (or is genesis), instead of DoSing in AcceptBlockHeader, request deeper headers
@@ -3052,7 +3232,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         bool fBlockReconstructed = false;
 
         {
-        LOCK2(cs_main, g_cs_orphans);
+        MSG_LOCK2(strCommand, cs_main, g_cs_orphans);
         // If AcceptBlockHeader returned true, it set pindex
         assert(pindex);
         UpdateBlockAvailability(pfrom->GetId(), pindex->GetBlockHash());
@@ -3110,7 +3290,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 }
 
                 PartiallyDownloadedBlock& partialBlock = *(*queuedBlockIt)->partialBlock;
-                ReadStatus status = partialBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = partialBlock.InitData(cmpctblock, vExtraTxnForCompact, vLockedTxForCompact);
                 if (status == READ_STATUS_INVALID) {
                     MarkBlockAsReceived(pindex->GetBlockHash()); // Reset in-flight state in case of whitelist
                     Misbehaving(pfrom->GetId(), 100, strprintf("Peer %d sent us invalid compact block\n", pfrom->GetId()));
@@ -3145,7 +3325,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
                 // Optimistically try to reconstruct anyway since we might be
                 // able to without any round trips.
                 PartiallyDownloadedBlock tempBlock(&mempool);
-                ReadStatus status = tempBlock.InitData(cmpctblock, vExtraTxnForCompact);
+                ReadStatus status = tempBlock.InitData(cmpctblock, vExtraTxnForCompact, vLockedTxForCompact);
                 if (status != READ_STATUS_OK) {
                     // TODO: don't ignore failures
                     return true;
@@ -3187,7 +3367,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             // If we got here, we were able to optimistically reconstruct a
             // block that is in flight from some other peer.
             {
-                LOCK(cs_main);
+                MSG_LOCK(strCommand, cs_main);
                 mapBlockSource.emplace(pblock->GetHash(), std::make_pair(pfrom->GetId(), false));
             }
             bool fNewBlock = false;
@@ -3204,11 +3384,11 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             if (fNewBlock) {
                 pfrom->nLastBlockTime = GetTime();
             } else {
-                LOCK(cs_main);
+                MSG_LOCK(strCommand, cs_main);
                 mapBlockSource.erase(pblock->GetHash());
             }
 
-            LOCK(cs_main); // hold cs_main for CBlockIndex::IsValid()
+            MSG_LOCK(strCommand, cs_main); // hold cs_main for CBlockIndex::IsValid()
             if (pindex->IsValid(BLOCK_VALID_TRANSACTIONS)) {
                 // Clear download state for this block, which is in
                 // process from some other peer.  We do this after calling
@@ -3234,7 +3414,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
         bool fBlockRead = false;
         {
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
 
             std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> >::iterator it = mapBlocksInFlight.find(resp.blockhash);
             if (it == mapBlocksInFlight.end() || !it->second.second->partialBlock ||
@@ -3294,7 +3474,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             if (fNewBlock) {
                 pfrom->nLastBlockTime = GetTime();
             } else {
-                LOCK(cs_main);
+                MSG_LOCK(strCommand, cs_main);
                 mapBlockSource.erase(pblock->GetHash());
             }
         }
@@ -3314,7 +3494,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         // Bypass the normal CBlock deserialization, as we don't want to risk deserializing 2000 full blocks.
         unsigned int nCount = ReadCompactSize(vRecv);
         if (nCount > MAX_HEADERS_RESULTS) {
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             Misbehaving(pfrom->GetId(), 20, strprintf("headers message size = %u", nCount));
             return false;
         }
@@ -3343,7 +3523,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
         {
             const uint256 hash2(pblock->GetHash());
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             bool fRequested = mapBlocksInFlight.count(hash2);
 
             BlockMap::iterator miPrev = ::BlockIndex().find(pblock->hashPrevBlock);
@@ -3376,7 +3556,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             std::shared_ptr<CBlock> pblock;
 
             {
-                LOCK(cs_main);
+                MSG_LOCK(strCommand, cs_main);
                 // peercoin: try to select next block in a constant time
                 std::map<CBlockIndex*, WaitElement>::iterator it = mapBlocksWait.find(pindexLastAccepted);
                 if (it != mapBlocksWait.end() && pindexLastAccepted != nullptr) {
@@ -3433,7 +3613,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             if (fNewBlock) {
                 pfrom->nLastBlockTime = GetTime();
             } else {
-                LOCK(cs_main);
+                MSG_LOCK(strCommand, cs_main);
                 mapBlockSource.erase(pblock->GetHash());
             }
         }
@@ -3575,7 +3755,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         if (!filter.IsWithinSizeConstraints())
         {
             // There is no excuse for sending a too-large filter
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             Misbehaving(pfrom->GetId(), 100);
         }
         else
@@ -3606,7 +3786,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             }
         }
         if (bad) {
-            LOCK(cs_main);
+            MSG_LOCK(strCommand, cs_main);
             Misbehaving(pfrom->GetId(), 100);
         }
         return true;
@@ -3638,7 +3818,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         CGetSimplifiedMNListDiff cmd;
         vRecv >> cmd;
 
-        LOCK(cs_main);
+        MSG_LOCK(strCommand, cs_main);
 
         CSimplifiedMNListDiff mnListDiff;
         std::string strError;
@@ -3654,7 +3834,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
     if (strCommand == NetMsgType::MNLISTDIFF) {
         // we have never requested this
-        LOCK(cs_main);
+        MSG_LOCK(strCommand, cs_main);
         Misbehaving(pfrom->GetId(), 100);
         LogPrint(BCLog::NET, "received not-requested mnlistdiff. peer=%d\n", pfrom->GetId());
         return true;
@@ -3662,7 +3842,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
 
     if (strCommand == NetMsgType::NOTFOUND) {
         // Remove the NOTFOUND transactions from the peer
-        LOCK(cs_main);
+        MSG_LOCK(strCommand, cs_main);
         CNodeState *state = State(pfrom->GetId());
         std::vector<CInv> vInv;
         vRecv >> vInv;
@@ -3761,6 +3941,176 @@ bool PeerLogicValidation::SendRejectsAndCheckIfBanned(CNode* pnode, bool enable_
     return false;
 }
 
+/** Messages which are handled (mostly) without cs_main and can thus be processed by the message processing pool */
+static bool IsPoolMessage(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::QSIGSESANN ||
+           strCommand == NetMsgType::QSIGSHARESINV ||
+           strCommand == NetMsgType::QGETSIGSHARES ||
+           strCommand == NetMsgType::QBSIGSHARES ||
+           strCommand == NetMsgType::QCONTRIB ||
+           strCommand == NetMsgType::QCOMPLAINT ||
+           strCommand == NetMsgType::QJUSTIFICATION ||
+           strCommand == NetMsgType::QPCOMMITMENT ||
+           strCommand == NetMsgType::QSIGREC ||
+           strCommand == NetMsgType::ISLOCK;
+}
+
+CPeerMessagePool::CPeerMessagePool(ProcessFunc processFuncIn, std::function<void()> idleFuncIn)
+    : processFunc(std::move(processFuncIn)), idleFunc(std::move(idleFuncIn))
+{
+}
+
+CPeerMessagePool::~CPeerMessagePool()
+{
+    Stop();
+}
+
+void CPeerMessagePool::Start(int nThreads, const char* baseName)
+{
+    pool.resize(nThreads);
+    RenameThreadPool(pool, baseName);
+}
+
+void CPeerMessagePool::Stop()
+{
+    {
+        LOCK(cs);
+        fInterrupt = true;
+    }
+    // Queued jobs are still run, they drop the messages of their peer and release it
+    pool.stop(true);
+}
+
+bool CPeerMessagePool::Enqueue(CNode* pnode, std::list<CNetMessage>&& msgs)
+{
+    LOCK(cs);
+    if (fInterrupt) {
+        return false;
+    }
+
+    LOCK(pnode->cs_vPoolProcessMsg);
+    pnode->vPoolProcessMsg.splice(pnode->vPoolProcessMsg.end(), msgs);
+    if (!pnode->fPoolProcessing) {
+        pnode->fPoolProcessing = true;
+        pnode->AddRef();
+        pool.push([this, pnode](int) { ProcessMessages(pnode); });
+    }
+    return true;
+}
+
+void CPeerMessagePool::ProcessMessages(CNode* pnode)
+{
+    while (true) {
+        std::list<CNetMessage> msgs;
+        {
+            LOCK(pnode->cs_vPoolProcessMsg);
+            if (fInterrupt) {
+                pnode->vPoolProcessMsg.clear();
+            }
+            if (pnode->vPoolProcessMsg.empty()) {
+                pnode->fPoolProcessing = false;
+                break;
+            }
+            msgs.splice(msgs.begin(), pnode->vPoolProcessMsg, pnode->vPoolProcessMsg.begin());
+        }
+        processFunc(pnode, msgs.front());
+    }
+
+    pnode->Release();
+    idleFunc();
+}
+
+void PeerLogicValidation::EnqueuePoolMessage(CNode* pfrom, std::list<CNetMessage>&& msgs)
+{
+    // The message still counts against the receive flood limit until it got processed by the pool
+    const size_t nSize = msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+    {
+        LOCK(pfrom->cs_vProcessMsg);
+        pfrom->nProcessQueueSize += nSize;
+        pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+    }
+
+    if (!msgProcPool.Enqueue(pfrom, std::move(msgs))) {
+        LOCK(pfrom->cs_vProcessMsg);
+        pfrom->nProcessQueueSize -= nSize;
+        pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+    }
+}
+
+void PeerLogicValidation::ProcessPoolMessage(CNode* pfrom, CNetMessage& msg)
+{
+    if (!pfrom->fDisconnect) {
+        ProcessMessageNoThrow(pfrom, msg.hdr.GetCommand(), msg.vRecv, msg.hdr.nMessageSize, msg.nTime, msgProcPool.GetInterrupt());
+        // Like at the end of ProcessMessages, pool workers don't wait for cs_main, SendMessages checks again
+        TRY_LOCK(cs_main, lockMain);
+        if (lockMain) {
+            SendRejectsAndCheckIfBanned(pfrom, m_enable_bip61);
+        }
+    }
+
+    LOCK(pfrom->cs_vProcessMsg);
+    pfrom->nProcessQueueSize -= msg.vRecv.size() + CMessageHeader::HEADER_SIZE;
+    pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
+}
+
+void PeerLogicValidation::StopMessageProcessingPool()
+{
+    msgProcPool.Stop();
+}
+
+bool PeerLogicValidation::ProcessMessageNoThrow(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, unsigned int nMessageSize, int64_t nTimeReceived, const std::atomic<bool>& interrupt)
+{
+    CNetMsgCommandStats& stats = NetMsgStats().Get(strCommand);
+    stats.nRecvMsgs++;
+    stats.nRecvBytes += nMessageSize + CMessageHeader::HEADER_SIZE;
+    const int64_t nTimeStart = GetTimeMicros();
+    stats.recvQueueTime.Add(nTimeStart - nTimeReceived);
+
+    bool fRet = false;
+    try
+    {
+        fRet = ProcessMessage(pfrom, strCommand, vRecv, nTimeReceived, Params(), connman, interrupt, m_enable_bip61);
+    }
+    catch (const std::ios_base::failure& e)
+    {
+        if (m_enable_bip61) {
+            connman->PushMessage(pfrom, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, std::string("error parsing message")));
+        }
+        if (strstr(e.what(), "end of data")) {
+            // Allow exceptions from under-length message on vRecv
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        } else if (strstr(e.what(), "size too large")) {
+            // Allow exceptions from over-long size
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        } else if (strstr(e.what(), "non-canonical ReadCompactSize()")) {
+            // Allow exceptions from non-canonical encoding
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        } else if (strstr(e.what(), "Superfluous witness record")) {
+            // Allow exceptions from illegal witness encoding
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        } else if (strstr(e.what(), "Unknown transaction optional data")) {
+            // Allow exceptions from unknown witness encoding
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
+        } else {
+            PrintExceptionContinue(&e, "ProcessMessages()");
+        }
+    }
+    catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "ProcessMessages()");
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "ProcessMessages()");
+    }
+
+    stats.processTime.Add(GetTimeMicros() - nTimeStart);
+
+    if (!fRet) {
+        LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
+    }
+
+    return fRet;
+}
+
 bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -3803,6 +4153,12 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         LOCK(pfrom->cs_vProcessMsg);
         if (pfrom->vProcessMsg.empty())
             return false;
+        if (m_msgproc_threads > 0 && !IsPoolMessage(pfrom->vProcessMsg.front().hdr.GetCommand())) {
+            // Keep the order of messages of this peer, earlier messages might still be processed by the pool
+            LOCK(pfrom->cs_vPoolProcessMsg);
+            if (pfrom->fPoolProcessing)
+                return false;
+        }
         // Just take one message
         msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
         pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
@@ -3843,52 +4199,23 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         return fMoreWork;
     }
 
-    // Process message
-    bool fRet = false;
-    try
-    {
-        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
-        if (interruptMsgProc)
-            return false;
-        if (!pfrom->vRecvGetData.empty())
-            fMoreWork = true;
-    }
-    catch (const std::ios_base::failure& e)
-    {
-        if (m_enable_bip61) {
-            connman->PushMessage(pfrom, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, std::string("error parsing message")));
-        }
-        if (strstr(e.what(), "end of data")) {
-            // Allow exceptions from under-length message on vRecv
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        } else if (strstr(e.what(), "size too large")) {
-            // Allow exceptions from over-long size
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        } else if (strstr(e.what(), "non-canonical ReadCompactSize()")) {
-            // Allow exceptions from non-canonical encoding
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        } else if (strstr(e.what(), "Superfluous witness record")) {
-            // Allow exceptions from illegal witness encoding
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        } else if (strstr(e.what(), "Unknown transaction optional data")) {
-            // Allow exceptions from unknown witness encoding
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        } else {
-            PrintExceptionContinue(&e, "ProcessMessages()");
-        }
-    }
-    catch (const std::exception& e) {
-        PrintExceptionContinue(&e, "ProcessMessages()");
-    } catch (...) {
-        PrintExceptionContinue(nullptr, "ProcessMessages()");
+    if (m_msgproc_threads > 0 && pfrom->fSuccessfullyConnected && IsPoolMessage(strCommand)) {
+        EnqueuePoolMessage(pfrom, std::move(msgs));
+        return fMoreWork;
     }
 
-    if (!fRet) {
-        LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
-    }
+    // Process message
+    ProcessMessageNoThrow(pfrom, strCommand, vRecv, nMessageSize, msg.nTime, interruptMsgProc);
+    if (interruptMsgProc)
+        return false;
+    if (!pfrom->vRecvGetData.empty())
+        fMoreWork = true;
 
-    LOCK(cs_main);
-    SendRejectsAndCheckIfBanned(pfrom, m_enable_bip61);
+    // Don't wait for cs_main just to check for rejects and bans, SendMessages does the same check anyway
+    TRY_LOCK(cs_main, lockMain);
+    if (lockMain) {
+        SendRejectsAndCheckIfBanned(pfrom, m_enable_bip61);
+    }
 
     return fMoreWork;
 }
@@ -4026,25 +4353,6 @@ void PeerLogicValidation::CheckForStaleTipAndEvictPeers(const Consensus::Params
     }
 }
 
-namespace {
-class CompareInvMempoolOrder
-{
-    CTxMemPool *mp;
-public:
-    explicit CompareInvMempoolOrder(CTxMemPool *_mempool)
-    {
-        mp = _mempool;
-    }
-
-    bool operator()(std::set<uint256>::iterator a, std::set<uint256>::iterator b)
-    {
-        /* As std::make_heap produces a max-heap, we want the entries with the
-         * fewest ancestors/highest fee to sort later. */
-        return mp->CompareDepthAndScore(*b, *a);
-    }
-};
-}
-
 bool PeerLogicValidation::SendMessages(CNode* pto)
 {
     const Consensus::Params& consensusParams = Params().GetConsensus();
@@ -4233,7 +4541,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
                             if (state.fWantsCmpctWitness || !fWitnessesPresentInMostRecentCompactBlock)
-                                connman->PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
+                                connman->PushMessage(pto, blockRelayCache.Make(pto->GetSendVersion(), nSendFlags, NetMsgType::CMPCTBLOCK, MSG_CMPCT_BLOCK, most_recent_block_hash, *most_recent_compact_block));
                             else {
                                 CBlockHeaderAndShortTxIDs cmpctblock(*most_recent_block, state.fWantsCmpctWitness);
                                 connman->PushMessage(pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, cmpctblock));
@@ -4322,10 +4630,13 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                 }
             }
 
-            // Time to send but the peer has requested we not relay transactions.
             if (fSendTrickle) {
+                // Order everything relayed since the last trickle of any peer once for all peers
+                txRelayQueue.SealEpoch(mempool, nNow);
+
+                // Time to send but the peer has requested we not relay transactions.
                 LOCK(pto->cs_filter);
-                if (!pto->fRelayTxes) pto->setInventoryTxToSend.clear();
+                if (!pto->fRelayTxes) pto->nTxRelayCursor = txRelayQueue.GetEndSequence();
             }
 
             // Respond to BIP35 mempool requests
@@ -4343,7 +4654,6 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                 for (const auto& txinfo : vtxinfo) {
                     const uint256& hash = txinfo.tx->GetHash();
                     CInv inv(MSG_TX, hash);
-                    pto->setInventoryTxToSend.erase(hash);
                     if (filterrate) {
                         if (txinfo.feeRate.GetFeePerK() < filterrate)
                             continue;
@@ -4363,68 +4673,35 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
 
             // Determine transactions to relay
             if (fSendTrickle) {
-                // Produce a vector with all candidates for sending
-                std::vector<std::set<uint256>::iterator> vInvTx;
-                vInvTx.reserve(pto->setInventoryTxToSend.size());
-                for (std::set<uint256>::iterator it = pto->setInventoryTxToSend.begin(); it != pto->setInventoryTxToSend.end(); it++) {
-                    vInvTx.push_back(it);
-                }
                 CAmount filterrate = 0;
                 {
                     LOCK(pto->cs_feeFilter);
                     filterrate = pto->minFeeFilter;
                 }
-                // Topologically and fee-rate sort the inventory we send for privacy and priority reasons.
-                // A heap is used so that not all items need sorting if only a few are being sent.
-                CompareInvMempoolOrder compareInvMempoolOrder(&mempool);
-                std::make_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
+                // Walk the shared relay log, which is already sorted topologically and by fee rate.
                 // No reason to drain out at many times the network's capacity,
                 // especially since we have many peers and some will draw much shorter delays.
-                unsigned int nRelayedTransactions = 0;
                 LOCK(pto->cs_filter);
-                while (!vInvTx.empty() && nRelayedTransactions < INVENTORY_BROADCAST_MAX) {
-                    // Fetch the top element from the heap
-                    std::pop_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
-                    std::set<uint256>::iterator it = vInvTx.back();
-                    vInvTx.pop_back();
-                    uint256 hash = *it;
-                    // Remove it from the to-be-sent set
-                    pto->setInventoryTxToSend.erase(it);
+                txRelayQueue.ForEachFrom(pto->nTxRelayCursor, INVENTORY_BROADCAST_MAX, [&](const CTxRelayQueue::Entry& entry) {
                     // Check if not in the filter already
-                    if (pto->filterInventoryKnown.contains(hash)) {
-                        continue;
+                    if (pto->filterInventoryKnown.contains(entry.hash)) {
+                        return false;
                     }
-                    // Not in the mempool anymore? don't bother sending it.
-                    auto txinfo = mempool.info(hash);
-                    if (!txinfo.tx) {
-                        continue;
+                    if (filterrate && entry.nFeePerK < filterrate) {
+                        return false;
                     }
-                    if (filterrate && txinfo.feeRate.GetFeePerK() < filterrate) {
-                        continue;
+                    if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*entry.tx)) {
+                        return false;
                     }
-                    if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
                     // Send
-                    vInv.push_back(CInv(MSG_TX, hash));
-                    nRelayedTransactions++;
-                    {
-                        // Expire old relay messages
-                        while (!vRelayExpiration.empty() && vRelayExpiration.front().first < nNow)
-                        {
-                            mapRelay.erase(vRelayExpiration.front().second);
-                            vRelayExpiration.pop_front();
-                        }
-
-                        auto ret = mapRelay.insert(std::make_pair(hash, std::move(txinfo.tx)));
-                        if (ret.second) {
-                            vRelayExpiration.push_back(std::make_pair(nNow + 15 * 60 * 1000000, ret.first));
-                        }
-                    }
+                    vInv.push_back(CInv(MSG_TX, entry.hash));
                     if (vInv.size() == MAX_INV_SZ) {
                         connman->PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
                         vInv.clear();
                     }
-                    pto->filterInventoryKnown.insert(hash);
-                }
+                    pto->filterInventoryKnown.insert(entry.hash);
+                    return true;
+                });
             }
             for (const auto& inv : pto->vInventoryOtherToSend) {
                 if (pto->filterInventoryKnown.contains(inv.hash)) {
@@ -9,17 +9,62 @@
 #include <net.h>
 #include <validationinterface.h>
 #include <consensus/params.h>
+#include <ctpl.h>
 #include <sync.h>
 
+#include <atomic>
+#include <functional>
+#include <list>
+
 extern CCriticalSection cs_main;
 
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
 /** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
+/** Maximum number of InstantSend-locked transactions to keep for compact block reconstruction until they are mined */
+static const unsigned int MAX_LOCKED_TXN_FOR_COMPACT = 5000;
 /** Default for BIP61 (sending reject messages) */
 static constexpr bool DEFAULT_ENABLE_BIP61{false};
 static const bool DEFAULT_PEERBLOOMFILTERS = false;
+/** Default for -msgprocthreads, number of threads processing LLMQ and InstantSend messages next to the message handler thread */
+static const int DEFAULT_MSGPROC_THREADS = 2;
+static const int MAX_MSGPROC_THREADS = 16;
+
+/**
+ * Processes the queued messages of peers on a thread pool. At most one job per peer is queued or running at
+ * any time, so the messages of a single peer are processed in the order they were enqueued while messages
+ * of different peers are processed concurrently. Each peer is referenced until its job finished.
+ */
+class CPeerMessagePool
+{
+public:
+    typedef std::function<void(CNode* pnode, CNetMessage& msg)> ProcessFunc;
+
+private:
+    const ProcessFunc processFunc;
+    // called whenever a job finished, i.e. the queue of a peer ran empty
+    const std::function<void()> idleFunc;
+
+    ctpl::thread_pool pool;
+    // guards fInterrupt against concurrent Enqueue() calls, so that no job is pushed after Stop()
+    CCriticalSection cs;
+    std::atomic<bool> fInterrupt{false};
+
+    void ProcessMessages(CNode* pnode);
+
+public:
+    CPeerMessagePool(ProcessFunc processFuncIn, std::function<void()> idleFuncIn);
+    ~CPeerMessagePool();
+
+    void Start(int nThreads, const char* baseName);
+    /** Stop processing. Queued messages are dropped and the peers of all queued jobs are released */
+    void Stop();
+    /** Returns false if the pool was already stopped, the messages are not queued then */
+    bool Enqueue(CNode* pnode, std::list<CNetMessage>&& msgs);
+
+    const std::atomic<bool>& GetInterrupt() const { return fInterrupt; }
+};
 
 class PeerLogicValidation final : public CValidationInterface, public NetEventsInterface {
 private:
@@ -27,8 +72,24 @@ private:
     BanMan* const m_banman;
 
     bool SendRejectsAndCheckIfBanned(CNode* pnode, bool enable_bip61) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /**
+     * Messages which don't need cs_main (LLMQ signing sessions, DKG and InstantSend locks) are processed
+     * by this pool instead of the message handler thread. Messages of a single peer are always processed in the
+     * order they were received, but messages of different peers are processed concurrently.
+     */
+    const int m_msgproc_threads;
+    CPeerMessagePool msgProcPool;
+
+    bool ProcessMessageNoThrow(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, unsigned int nMessageSize, int64_t nTimeReceived, const std::atomic<bool>& interrupt);
+    void EnqueuePoolMessage(CNode* pfrom, std::list<CNetMessage>&& msgs);
+    void ProcessPoolMessage(CNode* pfrom, CNetMessage& msg);
 public:
-    PeerLogicValidation(CConnman* connman, BanMan* banman, CScheduler &scheduler, bool enable_bip61);
+    PeerLogicValidation(CConnman* connman, BanMan* banman, CScheduler &scheduler, bool enable_bip61, int nMsgProcThreads = 0);
+    ~PeerLogicValidation();
+
+    /** Stop the message processing pool. Must be called before the nodes get deleted */
+    void StopMessageProcessingPool();
 
     /**
      * Overridden from CValidationInterface.
@@ -46,6 +107,10 @@ public:
      * Overridden from CValidationInterface.
      */
     void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override;
+    /**
+     * Overridden from CValidationInterface.
+     */
+    void NotifyTransactionLock(const CTransaction& tx) override;
 
     /** Initialize a peer by adding it to mapNodeState and pushing a message requesting its version */
     void InitializeNode(CNode* pnode) override;
@@ -0,0 +1,128 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <netmsgstats.h>
+
+#include <crypto/common.h>
+#include <net.h>
+#include <protocol.h>
+#include <tinyformat.h>
+#include <util/memory.h>
+
+#include <algorithm>
+
+CNetMsgHistogram::CNetMsgHistogram()
+{
+    for (auto& nBucket : vBuckets) {
+        nBucket = 0;
+    }
+}
+
+void CNetMsgHistogram::Add(int64_t nValue)
+{
+    uint64_t v = (uint64_t)std::max<int64_t>(nValue, 0);
+    size_t i = v <= 1 ? 0 : std::min<size_t>(CountBits(v - 1), BUCKET_COUNT - 1);
+    vBuckets[i].fetch_add(1, std::memory_order_relaxed);
+    nCount.fetch_add(1, std::memory_order_relaxed);
+    nSum.fetch_add(v, std::memory_order_relaxed);
+
+    uint64_t nPrevMax = nMax.load(std::memory_order_relaxed);
+    while (v > nPrevMax && !nMax.compare_exchange_weak(nPrevMax, v, std::memory_order_relaxed)) {
+    }
+}
+
+CNetMsgHistogram::Snapshot CNetMsgHistogram::GetSnapshot() const
+{
+    Snapshot snapshot;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        snapshot.vBuckets[i] = vBuckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.nCount = nCount.load(std::memory_order_relaxed);
+    snapshot.nSum = nSum.load(std::memory_order_relaxed);
+    snapshot.nMax = nMax.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+uint64_t CNetMsgHistogram::GetBucketBound(size_t i)
+{
+    if (i + 1 >= BUCKET_COUNT) {
+        return 0;
+    }
+    return uint64_t(1) << i;
+}
+
+CNetMsgStats::CNetMsgStats()
+{
+    for (const std::string& strCommand : getAllNetMessageTypes()) {
+        mapStats.emplace(strCommand, MakeUnique<CNetMsgCommandStats>());
+    }
+    auto it = mapStats.emplace(NET_MESSAGE_COMMAND_OTHER, MakeUnique<CNetMsgCommandStats>()).first;
+    pOtherStats = it->second.get();
+}
+
+CNetMsgCommandStats& CNetMsgStats::Get(const std::string& strCommand)
+{
+    auto it = mapStats.find(strCommand);
+    if (it == mapStats.end()) {
+        return *pOtherStats;
+    }
+    return *it->second;
+}
+
+CNetMsgStats& NetMsgStats()
+{
+    static CNetMsgStats netMsgStats;
+    return netMsgStats;
+}
+
+static bool HasActivity(const CNetMsgCommandStats& stats)
+{
+    return stats.nRecvMsgs != 0 || stats.nSendMsgs != 0;
+}
+
+static void FormatCounter(std::string& strOut, const std::string& strName, const std::string& strHelp, std::atomic<uint64_t> CNetMsgCommandStats::*pCounter)
+{
+    strOut += strprintf("# HELP %s %s\n# TYPE %s counter\n", strName, strHelp, strName);
+    for (const auto& p : NetMsgStats().GetAll()) {
+        if (HasActivity(*p.second)) {
+            strOut += strprintf("%s{command=\"%s\"} %u\n", strName, p.first, ((*p.second).*pCounter).load());
+        }
+    }
+}
+
+// fScale converts the recorded values into the unit of the metric, e.g. microseconds into seconds
+static void FormatHistogram(std::string& strOut, const std::string& strName, const std::string& strHelp, CNetMsgHistogram CNetMsgCommandStats::*pHistogram, double fScale)
+{
+    strOut += strprintf("# HELP %s %s\n# TYPE %s histogram\n", strName, strHelp, strName);
+    for (const auto& p : NetMsgStats().GetAll()) {
+        if (!HasActivity(*p.second)) {
+            continue;
+        }
+        const auto snapshot = ((*p.second).*pHistogram).GetSnapshot();
+        uint64_t nCumulative = 0;
+        for (size_t i = 0; i < CNetMsgHistogram::BUCKET_COUNT; i++) {
+            nCumulative += snapshot.vBuckets[i];
+            uint64_t nBound = CNetMsgHistogram::GetBucketBound(i);
+            std::string strBound = nBound ? strprintf("%g", nBound * fScale) : "+Inf";
+            strOut += strprintf("%s_bucket{command=\"%s\",le=\"%s\"} %u\n", strName, p.first, strBound, nCumulative);
+        }
+        strOut += strprintf("%s_sum{command=\"%s\"} %g\n", strName, p.first, snapshot.nSum * fScale);
+        strOut += strprintf("%s_count{command=\"%s\"} %u\n", strName, p.first, snapshot.nCount);
+    }
+}
+
+std::string NetMsgStatsToPrometheus()
+{
+    std::string strOut;
+    FormatCounter(strOut, "bitgreen_net_msg_recv_total", "Number of received messages", &CNetMsgCommandStats::nRecvMsgs);
+    FormatCounter(strOut, "bitgreen_net_msg_recv_bytes_total", "Number of received bytes, including headers", &CNetMsgCommandStats::nRecvBytes);
+    FormatCounter(strOut, "bitgreen_net_msg_sent_total", "Number of sent messages", &CNetMsgCommandStats::nSendMsgs);
+    FormatCounter(strOut, "bitgreen_net_msg_sent_bytes_total", "Number of sent bytes, including headers", &CNetMsgCommandStats::nSendBytes);
+    FormatHistogram(strOut, "bitgreen_net_msg_recv_queue_seconds", "Time between receiving a message and starting to process it", &CNetMsgCommandStats::recvQueueTime, 1e-6);
+    FormatHistogram(strOut, "bitgreen_net_msg_process_seconds", "Time spent processing a message", &CNetMsgCommandStats::processTime, 1e-6);
+    FormatHistogram(strOut, "bitgreen_net_msg_lock_wait_seconds", "Time waited for cs_main while processing a message", &CNetMsgCommandStats::lockWaitTime, 1e-6);
+    FormatHistogram(strOut, "bitgreen_net_msg_send_queue_depth", "Number of messages queued before a message in the send queue of a peer", &CNetMsgCommandStats::sendQueueDepth, 1);
+    FormatHistogram(strOut, "bitgreen_net_msg_send_queue_seconds", "Time between queueing a message and sending its last byte", &CNetMsgCommandStats::sendQueueTime, 1e-6);
+    return strOut;
+}
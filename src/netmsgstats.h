@@ -0,0 +1,90 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITGREEN_NETMSGSTATS_H
+#define BITGREEN_NETMSGSTATS_H
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+
+/**
+ * Histogram with power-of-two bucket bounds. Bucket i counts the values v with 2^(i-1) < v <= 2^i, the last bucket
+ * counts everything which doesn't fit into the others. Updates are lock-free.
+ */
+class CNetMsgHistogram
+{
+public:
+    static const size_t BUCKET_COUNT = 28;
+
+    struct Snapshot {
+        std::array<uint64_t, BUCKET_COUNT> vBuckets;
+        uint64_t nCount;
+        uint64_t nSum;
+        uint64_t nMax;
+    };
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> vBuckets;
+    std::atomic<uint64_t> nCount{0};
+    std::atomic<uint64_t> nSum{0};
+    std::atomic<uint64_t> nMax{0};
+
+public:
+    CNetMsgHistogram();
+
+    void Add(int64_t nValue);
+    Snapshot GetSnapshot() const;
+
+    /** Upper bound (inclusive) of bucket i, or 0 for the unbounded last bucket */
+    static uint64_t GetBucketBound(size_t i);
+};
+
+/** Telemetry for a single network message type, aggregated over all peers */
+struct CNetMsgCommandStats {
+    std::atomic<uint64_t> nRecvMsgs{0};
+    std::atomic<uint64_t> nRecvBytes{0};
+    std::atomic<uint64_t> nSendMsgs{0};
+    std::atomic<uint64_t> nSendBytes{0};
+
+    // Time (in microseconds) between receiving a message and starting to process it
+    CNetMsgHistogram recvQueueTime;
+    // Time (in microseconds) spent in ProcessMessage
+    CNetMsgHistogram processTime;
+    // Time (in microseconds) waited for cs_main while processing a message
+    CNetMsgHistogram lockWaitTime;
+    // Number of messages already in the send queue of the peer when a message is queued
+    CNetMsgHistogram sendQueueDepth;
+    // Time (in microseconds) between queueing a message and sending its last byte
+    CNetMsgHistogram sendQueueTime;
+};
+
+/**
+ * Per message type network and processing telemetry. Entries for all known message types are created up front and
+ * never removed, so that recording doesn't need any locking. Unknown message types are accounted as
+ * NET_MESSAGE_COMMAND_OTHER.
+ */
+class CNetMsgStats
+{
+private:
+    std::map<std::string, std::unique_ptr<CNetMsgCommandStats>> mapStats;
+    CNetMsgCommandStats* pOtherStats;
+
+public:
+    CNetMsgStats();
+
+    CNetMsgCommandStats& Get(const std::string& strCommand);
+    const std::map<std::string, std::unique_ptr<CNetMsgCommandStats>>& GetAll() const { return mapStats; }
+};
+
+/** Created on first use, as it needs the list of message types from protocol.cpp */
+CNetMsgStats& NetMsgStats();
+
+/** Format the telemetry of all message types which were sent or received in the Prometheus text exposition format */
+std::string NetMsgStatsToPrometheus();
+
+#endif // BITGREEN_NETMSGSTATS_H
@@ -6,6 +6,7 @@
 #include <consensus/validation.h>
 #include <net.h>
 #include <txmempool.h>
+#include <txrelay.h>
 #include <util/validation.h>
 #include <validation.h>
 #include <validationinterface.h>
@@ -69,10 +70,7 @@ TransactionError BroadcastTransaction(const CTransactionRef tx, uint256& hashTx,
         return TransactionError::P2P_DISABLED;
     }
 
-    CInv inv(MSG_TX, hashTx);
-    g_connman->ForEachNode([&inv](CNode* pnode) {
-        pnode->PushInventory(inv);
-    });
+    txRelayQueue.Add(hashTx);
 
     return TransactionError::OK;
 }
@@ -0,0 +1,68 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <relaypayloadcache.h>
+
+#include <crypto/siphash.h>
+#include <saltedhasher.h>
+
+std::size_t CRelayPayloadCache::CacheKeyHasher::operator()(const CacheKey& key) const
+{
+    return SipHashUint256Extra(StaticSaltedHasher::s.k0, StaticSaltedHasher::s.k1, key.hash, (uint32_t)key.nType) ^ key.nVersion;
+}
+
+CRelayPayloadCache::CRelayPayloadCache(size_t nMaxEntriesIn, size_t nMaxBytesIn) :
+    nMaxEntries(nMaxEntriesIn),
+    nMaxBytes(nMaxBytesIn)
+{
+}
+
+std::shared_ptr<const CSharedNetPayload> CRelayPayloadCache::Get(const CacheKey& key)
+{
+    LOCK(cs);
+    auto it = mapEntries.find(key);
+    if (it == mapEntries.end()) {
+        return nullptr;
+    }
+    listEntries.splice(listEntries.begin(), listEntries, it->second);
+    return it->second->second;
+}
+
+void CRelayPayloadCache::Insert(const CacheKey& key, const std::shared_ptr<const CSharedNetPayload>& payload)
+{
+    const size_t nSize = payload->data.size();
+    if (nSize > nMaxBytes) {
+        return;
+    }
+
+    LOCK(cs);
+    auto it = mapEntries.find(key);
+    if (it != mapEntries.end()) {
+        // another thread serialized the same object concurrently
+        listEntries.splice(listEntries.begin(), listEntries, it->second);
+        return;
+    }
+    listEntries.emplace_front(key, payload);
+    mapEntries.emplace(key, listEntries.begin());
+    nBytes += nSize;
+
+    while (listEntries.size() > nMaxEntries || nBytes > nMaxBytes) {
+        const auto& entry = listEntries.back();
+        nBytes -= entry.second->data.size();
+        mapEntries.erase(entry.first);
+        listEntries.pop_back();
+    }
+}
+
+size_t CRelayPayloadCache::GetCount() const
+{
+    LOCK(cs);
+    return listEntries.size();
+}
+
+size_t CRelayPayloadCache::GetBytes() const
+{
+    LOCK(cs);
+    return nBytes;
+}
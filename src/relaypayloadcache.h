@@ -0,0 +1,83 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITGREEN_RELAYPAYLOADCACHE_H
+#define BITGREEN_RELAYPAYLOADCACHE_H
+
+#include <net.h>
+#include <netmessagemaker.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * Serialized payloads of objects which are sent to many peers in a short time, e.g. new blocks, compact blocks,
+ * ISLOCKs and CLSIGs. Entries are keyed by inventory type, hash and serialization version (including flags) and
+ * are referenced by the send queues of the peers, so an object is only serialized and hashed once no matter how
+ * many peers it is relayed to.
+ *
+ * The cache is bounded by the number of entries and by the total size of the cached payloads, as every
+ * serialization variant of an object is a separate entry. The least recently used entries are evicted first and
+ * payloads larger than the size limit are not cached at all.
+ */
+class CRelayPayloadCache
+{
+private:
+    struct CacheKey {
+        int nType;
+        uint256 hash;
+        int nVersion;
+
+        bool operator==(const CacheKey& other) const
+        {
+            return nType == other.nType && hash == other.hash && nVersion == other.nVersion;
+        }
+    };
+
+    struct CacheKeyHasher {
+        std::size_t operator()(const CacheKey& key) const;
+    };
+
+    typedef std::list<std::pair<CacheKey, std::shared_ptr<const CSharedNetPayload>>> EntryList;
+
+    const size_t nMaxEntries;
+    const size_t nMaxBytes;
+
+    mutable CCriticalSection cs;
+    // most recently used entries first
+    EntryList listEntries GUARDED_BY(cs);
+    std::unordered_map<CacheKey, EntryList::iterator, CacheKeyHasher> mapEntries GUARDED_BY(cs);
+    size_t nBytes GUARDED_BY(cs){0};
+
+    std::shared_ptr<const CSharedNetPayload> Get(const CacheKey& key);
+    void Insert(const CacheKey& key, const std::shared_ptr<const CSharedNetPayload>& payload);
+
+public:
+    CRelayPayloadCache(size_t nMaxEntriesIn, size_t nMaxBytesIn);
+
+    template <typename T>
+    CSerializedNetMsg Make(int nSendVersion, int nFlags, std::string strCommand, int nType, const uint256& hash, const T& obj)
+    {
+        const CNetMsgMaker msgMaker(nSendVersion);
+        const CacheKey key{nType, hash, nSendVersion | nFlags};
+        std::shared_ptr<const CSharedNetPayload> payload = Get(key);
+        if (!payload) {
+            // Serialize without holding cs, in the worst case concurrent requests serialize the object twice
+            payload = msgMaker.MakePayload(nFlags, obj);
+            Insert(key, payload);
+        }
+        return msgMaker.MakeShared(std::move(strCommand), std::move(payload));
+    }
+
+    size_t GetCount() const;
+    /** Total size of the cached payloads */
+    size_t GetBytes() const;
+};
+
+#endif // BITGREEN_RELAYPAYLOADCACHE_H
@@ -9,6 +9,7 @@
 #include <core_io.h>
 #include <httpserver.h>
 #include <index/txindex.h>
+#include <netmsgstats.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
@@ -637,6 +638,25 @@ static const struct {
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
 };
 
+static bool http_metrics(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, NetMsgStatsToPrometheus());
+    return true;
+}
+
+void StartMetrics()
+{
+    RegisterHTTPHandler("/metrics", true, http_metrics);
+}
+
+void StopMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
+}
+
 void StartREST()
 {
     for (unsigned int i = 0; i < ARRAYLEN(uri_prefixes); i++)
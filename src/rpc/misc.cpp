@@ -3,15 +3,20 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <clientversion.h>
 #include <crypto/ripemd160.h>
 #include <key_io.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
+#include <optional.h>
 #include <outputtype.h>
 #include <rpc/blockchain.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
 #include <spork.h>
+#include <streams.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <util/validation.h>
@@ -615,6 +620,171 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+/** Number of entries returned per page by the address RPCs if a cursor but no limit is given */
+static const int64_t DEFAULT_ADDRESS_PAGE_LIMIT = 1000;
+/** Maximum number of index entries an address RPC collects without limit and cursor, larger results must be paged */
+static const size_t MAX_ADDRESS_UNPAGED_ENTRIES = 100000;
+
+static UniValue tooManyEntriesError()
+{
+    return JSONRPCError(RPC_INVALID_PARAMETER, strprintf("The addresses have more than %u entries, request them in pages with \"limit\" and \"cursor\"", MAX_ADDRESS_UNPAGED_ENTRIES));
+}
+
+/** Collect the index entries of all addresses of a request without limit and cursor, up to MAX_ADDRESS_UNPAGED_ENTRIES */
+static void getAddressIndexUnpaged(const std::vector<std::pair<uint160, int> >& addresses, int start, int end,
+                                   std::vector<std::pair<CAddressIndexKey, CAmount> >& addressIndex)
+{
+    if (!fAddressIndex || !g_addressindex) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+    if (start <= 0 || end <= 0) {
+        start = end = 0;
+    }
+
+    bool fTooMany = false;
+    for (const auto& address : addresses) {
+        bool ok = g_addressindex->ForEachAddressIndex(address.first, address.second, start, end, nullptr,
+                                                      [&](const CAddressIndexKey& key, CAmount amount) {
+            if (addressIndex.size() == MAX_ADDRESS_UNPAGED_ENTRIES) {
+                fTooMany = true;
+                return false;
+            }
+            addressIndex.emplace_back(key, amount);
+            return true;
+        });
+        if (!ok) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        if (fTooMany) {
+            throw tooManyEntriesError();
+        }
+    }
+}
+
+/** Collect the unspent outputs of all addresses of a request without limit and cursor, up to MAX_ADDRESS_UNPAGED_ENTRIES */
+static void getAddressUnspentUnpaged(const std::vector<std::pair<uint160, int> >& addresses,
+                                     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspentOutputs)
+{
+    if (!fAddressIndex || !g_addressindex) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    bool fTooMany = false;
+    for (const auto& address : addresses) {
+        bool ok = g_addressindex->ForEachAddressUnspent(address.first, address.second, nullptr,
+                                                        [&](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+            if (unspentOutputs.size() == MAX_ADDRESS_UNPAGED_ENTRIES) {
+                fTooMany = true;
+                return false;
+            }
+            unspentOutputs.emplace_back(key, value);
+            return true;
+        });
+        if (!ok) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        if (fTooMany) {
+            throw tooManyEntriesError();
+        }
+    }
+}
+
+/**
+ * Parse the optional "limit" and "cursor" of an address RPC. Returns false if neither is given, in which case all
+ * entries are returned at once. A cursor encodes the position of the address in the request and the index key of the
+ * first entry which was not returned yet.
+ */
+template <typename Key>
+static bool getPageFromParams(const UniValue& params, const std::vector<std::pair<uint160, int> >& addresses,
+                              size_t& limit, uint32_t& addressPos, Optional<Key>& seekKey)
+{
+    if (!params[0].isObject()) {
+        return false;
+    }
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (limitValue.isNull() && cursorValue.isNull()) {
+        return false;
+    }
+
+    limit = DEFAULT_ADDRESS_PAGE_LIMIT;
+    if (!limitValue.isNull()) {
+        int64_t value = limitValue.get_int64();
+        if (value <= 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be greater than 0");
+        }
+        limit = (size_t)value;
+    }
+
+    addressPos = 0;
+    seekKey = nullopt;
+    if (!cursorValue.isNull()) {
+        if (!cursorValue.isStr() || !IsHex(cursorValue.get_str())) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        Key key;
+        try {
+            CDataStream ssCursor(ParseHex(cursorValue.get_str()), SER_DISK, CLIENT_VERSION);
+            ssCursor >> addressPos >> key;
+            if (!ssCursor.empty()) {
+                throw std::ios_base::failure("trailing data");
+            }
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        if (addressPos >= addresses.size() || key.hashBytes != addresses[addressPos].first ||
+            key.type != (unsigned int)addresses[addressPos].second) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor does not match the requested addresses");
+        }
+        seekKey = key;
+    }
+
+    return true;
+}
+
+template <typename Key>
+static std::string encodePageCursor(uint32_t addressPos, const Key& key)
+{
+    CDataStream ssCursor(SER_DISK, CLIENT_VERSION);
+    ssCursor << addressPos << key;
+    return HexStr(ssCursor.begin(), ssCursor.end());
+}
+
+static UniValue addressDeltaToJSON(const CAddressIndexKey& key, CAmount amount)
+{
+    std::string address;
+    if (!getAddressFromIndex(key.type, key.hashBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    UniValue delta(UniValue::VOBJ);
+    delta.pushKV("satoshis", amount);
+    delta.pushKV("txid", key.txhash.GetHex());
+    delta.pushKV("index", (int)key.index);
+    delta.pushKV("blockindex", (int)key.txindex);
+    delta.pushKV("height", key.blockHeight);
+    delta.pushKV("address", address);
+    return delta;
+}
+
+static UniValue addressUtxoToJSON(const CAddressUnspentKey& key, const CAddressUnspentValue& value)
+{
+    std::string address;
+    if (!getAddressFromIndex(key.type, key.hashBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    UniValue output(UniValue::VOBJ);
+    output.pushKV("address", address);
+    output.pushKV("txid", key.txhash.GetHex());
+    output.pushKV("outputIndex", (int)key.index);
+    output.pushKV("script", HexStr(value.script.begin(), value.script.end()));
+    output.pushKV("satoshis", value.satoshis);
+    output.pushKV("height", value.blockHeight);
+    return output;
+}
+
 UniValue getaddressmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -699,6 +869,9 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "      \"address\"  (string) The base58check encoded address\n"
             "      ,...\n"
             "    ]\n"
+            "  \"limit\" (number, optional) Return at most this many outputs, default 1000 if a cursor is given. Without limit\n"
+            "                   and cursor, requests matching more than 100000 index entries fail\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -711,8 +884,14 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    \"height\"  (number) The block height\n"
             "  }\n"
             "]\n"
+            "\nResult (if limit or cursor is given):\n"
+            "{\n"
+            "  \"utxos\"  (array) The outputs as above, ordered by address and outpoint instead of height\n"
+            "  \"cursor\"  (string) The cursor to request the next page with, omitted on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
+            + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"], \"limit\": 100}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
         );
 
@@ -722,32 +901,53 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    if (g_addressindex && !g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is still in the process of being built, try again later");
+    }
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+    size_t limit;
+    uint32_t addressPos;
+    Optional<CAddressUnspentKey> seekKey;
+    if (getPageFromParams(request.params, addresses, limit, addressPos, seekKey)) {
+        if (!fAddressIndex || !g_addressindex) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
+
+        UniValue utxos(UniValue::VARR);
+        std::string cursor;
+        for (uint32_t i = addressPos; i < addresses.size() && cursor.empty(); i++) {
+            bool ok = g_addressindex->ForEachAddressUnspent(addresses[i].first, addresses[i].second,
+                                                            i == addressPos && seekKey ? &*seekKey : nullptr,
+                                                            [&](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+                if (utxos.size() == limit) {
+                    cursor = encodePageCursor(i, key);
+                    return false;
+                }
+                utxos.push_back(addressUtxoToJSON(key, value));
+                return true;
+            });
+            if (!ok) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
+
+        UniValue result(UniValue::VOBJ);
+        result.pushKV("utxos", utxos);
+        if (!cursor.empty()) {
+            result.pushKV("cursor", cursor);
+        }
+        return result;
     }
 
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    getAddressUnspentUnpaged(addresses, unspentOutputs);
+
     std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
 
     UniValue result(UniValue::VARR);
 
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
-        UniValue output(UniValue::VOBJ);
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-        }
-
-        output.pushKV("address", address);
-        output.pushKV("txid", it->first.txhash.GetHex());
-        output.pushKV("outputIndex", (int)it->first.index);
-        output.pushKV("script", HexStr(it->second.script.begin(), it->second.script.end()));
-        output.pushKV("satoshis", it->second.satoshis);
-        output.pushKV("height", it->second.blockHeight);
-        result.push_back(output);
+        result.push_back(addressUtxoToJSON(it->first, it->second));
     }
 
     return result;
@@ -768,6 +968,9 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many deltas, default 1000 if a cursor is given. Without limit\n"
+            "                   and cursor, requests matching more than 100000 index entries fail\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -780,8 +983,14 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nResult (if limit or cursor is given):\n"
+            "{\n"
+            "  \"deltas\"  (array) The deltas as above\n"
+            "  \"cursor\"  (string) The cursor to request the next page with, omitted on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
+            + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"], \"limit\": 100}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
         );
 
@@ -806,36 +1015,55 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    if (g_addressindex && !g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is still in the process of being built, try again later");
+    }
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+    size_t limit;
+    uint32_t addressPos;
+    Optional<CAddressIndexKey> seekKey;
+    if (getPageFromParams(request.params, addresses, limit, addressPos, seekKey)) {
+        if (!fAddressIndex || !g_addressindex) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+
+        if (start <= 0 || end <= 0) {
+            start = end = 0;
+        }
+
+        UniValue deltas(UniValue::VARR);
+        std::string cursor;
+        for (uint32_t i = addressPos; i < addresses.size() && cursor.empty(); i++) {
+            bool ok = g_addressindex->ForEachAddressIndex(addresses[i].first, addresses[i].second, start, end,
+                                                          i == addressPos && seekKey ? &*seekKey : nullptr,
+                                                          [&](const CAddressIndexKey& key, CAmount amount) {
+                if (deltas.size() == limit) {
+                    cursor = encodePageCursor(i, key);
+                    return false;
+                }
+                deltas.push_back(addressDeltaToJSON(key, amount));
+                return true;
+            });
+            if (!ok) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         }
+
+        UniValue result(UniValue::VOBJ);
+        result.pushKV("deltas", deltas);
+        if (!cursor.empty()) {
+            result.pushKV("cursor", cursor);
+        }
+        return result;
     }
 
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    getAddressIndexUnpaged(addresses, start, end, addressIndex);
+
     UniValue result(UniValue::VARR);
 
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-        }
-
-        UniValue delta(UniValue::VOBJ);
-        delta.pushKV("satoshis", it->second);
-        delta.pushKV("txid", it->first.txhash.GetHex());
-        delta.pushKV("index", (int)it->first.index);
-        delta.pushKV("blockindex", (int)it->first.txindex);
-        delta.pushKV("height", it->first.blockHeight);
-        delta.pushKV("address", address);
-        result.push_back(delta);
+        result.push_back(addressDeltaToJSON(it->first, it->second));
     }
 
     return result;
@@ -859,6 +1087,8 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
             "{\n"
             "  \"balance\"  (string) The current balance in duffs\n"
             "  \"received\"  (string) The total number of duffs received (including change)\n"
+            "  \"txcount\"  (numeric) The number of transactions, summed over the addresses\n"
+            "  \"lastheight\"  (numeric) The height of the last block with activity of the addresses, or 0 if there is none\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
@@ -871,27 +1101,31 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
+    if (g_addressindex && !g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is still in the process of being built, try again later");
     }
 
     CAmount balance = 0;
     CAmount received = 0;
+    uint64_t txCount = 0;
+    int lastHeight = 0;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        CAddressBalanceValue value;
+        if (!GetAddressBalance((*it).first, (*it).second, value)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-        balance += it->second;
+        balance += value.balance;
+        received += value.received;
+        txCount += value.txCount;
+        lastHeight = std::max(lastHeight, value.lastHeight);
     }
 
     UniValue result(UniValue::VOBJ);
     result.pushKV("balance", balance);
     result.pushKV("received", received);
+    result.pushKV("txcount", txCount);
+    result.pushKV("lastheight", lastHeight);
 
     return result;
 
@@ -912,14 +1146,24 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many txids, default 1000 if a cursor is given. Without limit\n"
+            "                   and cursor, requests matching more than 100000 index entries fail\n"
+            "  \"cursor\" (string, optional) The cursor returned with the previous page\n"
             "}\n"
             "\nResult:\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nResult (if limit or cursor is given):\n"
+            "{\n"
+            "  \"txids\"  (array) The txids as above, ordered by address and height. A transaction involving several\n"
+            "                     of the addresses is listed once for each of them\n"
+            "  \"cursor\"  (string) The cursor to request the next page with, omitted on the last page\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
+            + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"], \"limit\": 100}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
         );
 
@@ -940,20 +1184,58 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         }
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    if (g_addressindex && !g_addressindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is still in the process of being built, try again later");
+    }
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+    size_t limit;
+    uint32_t addressPos;
+    Optional<CAddressIndexKey> seekKey;
+    if (getPageFromParams(request.params, addresses, limit, addressPos, seekKey)) {
+        if (!fAddressIndex || !g_addressindex) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+
+        if (start <= 0 || end <= 0) {
+            start = end = 0;
+        }
+
+        // The entries of a transaction are adjacent in the index, so a page only ends at the first entry of a
+        // transaction and the same txid is never returned on two pages for the same address
+        UniValue txids(UniValue::VARR);
+        std::string cursor;
+        for (uint32_t i = addressPos; i < addresses.size() && cursor.empty(); i++) {
+            uint256 lastTxHash;
+            bool ok = g_addressindex->ForEachAddressIndex(addresses[i].first, addresses[i].second, start, end,
+                                                          i == addressPos && seekKey ? &*seekKey : nullptr,
+                                                          [&](const CAddressIndexKey& key, CAmount amount) {
+                if (key.txhash == lastTxHash) {
+                    return true;
+                }
+                if (txids.size() == limit) {
+                    cursor = encodePageCursor(i, key);
+                    return false;
+                }
+                txids.push_back(key.txhash.GetHex());
+                lastTxHash = key.txhash;
+                return true;
+            });
+            if (!ok) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
             }
         }
+
+        UniValue result(UniValue::VOBJ);
+        result.pushKV("txids", txids);
+        if (!cursor.empty()) {
+            result.pushKV("cursor", cursor);
+        }
+        return result;
     }
 
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    getAddressIndexUnpaged(addresses, start, end, addressIndex);
+
     std::set<std::pair<int, std::string> > txids;
     UniValue result(UniValue::VARR);
 
@@ -1015,6 +1297,10 @@ UniValue getspentinfo(const JSONRPCRequest& request)
     CSpentIndexKey key(txid, outputIndex);
     CSpentIndexValue value;
 
+    if (g_spentindex && !g_spentindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index is still in the process of being built, try again later");
+    }
+
     if (!GetSpentIndex(key, value)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
     }
@@ -10,6 +10,7 @@
 #include <net.h>
 #include <net_processing.h>
 #include <netbase.h>
+#include <netmsgstats.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
 #include <rpc/protocol.h>
@@ -408,6 +409,97 @@ static UniValue getnettotals(const JSONRPCRequest& request)
     return obj;
 }
 
+static UniValue HistogramToJSON(const CNetMsgHistogram& histogram)
+{
+    const auto snapshot = histogram.GetSnapshot();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("count", snapshot.nCount);
+    obj.pushKV("sum", snapshot.nSum);
+    obj.pushKV("max", snapshot.nMax);
+    UniValue buckets(UniValue::VOBJ);
+    for (size_t i = 0; i < CNetMsgHistogram::BUCKET_COUNT; i++) {
+        if (snapshot.vBuckets[i] == 0) {
+            continue;
+        }
+        uint64_t nBound = CNetMsgHistogram::GetBucketBound(i);
+        buckets.pushKV(nBound ? std::to_string(nBound) : "+Inf", snapshot.vBuckets[i]);
+    }
+    obj.pushKV("buckets", buckets);
+    return obj;
+}
+
+static UniValue getnetmsgstats(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getnetmsgstats",
+                "\nReturns per message type network and processing telemetry, aggregated over all peers since startup.\n"
+                "Only message types which were sent or received are returned, unless a specific one is requested.\n"
+                "Histograms only list non-empty buckets. Each bucket counts the values which are larger than the\n"
+                "previous power of two and less than or equal to its own bound.\n",
+                {
+                    {"command", RPCArg::Type::STR, /* default */ "all message types", "Only return the telemetry of this message type"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"command\": {                  (json object) The message type\n"
+            "    \"recv_msgs\": n,             (numeric) Number of received messages\n"
+            "    \"recv_bytes\": n,            (numeric) Number of received bytes, including headers\n"
+            "    \"sent_msgs\": n,             (numeric) Number of sent messages\n"
+            "    \"sent_bytes\": n,            (numeric) Number of sent bytes, including headers\n"
+            "    \"recv_queue_time\": {...},   (json object) Microseconds between receiving a message and starting to process it\n"
+            "    \"process_time\": {...},      (json object) Microseconds spent processing a message\n"
+            "    \"lock_wait_time\": {...},    (json object) Microseconds waited for cs_main while processing a message\n"
+            "    \"send_queue_depth\": {...},  (json object) Messages queued before a message in the send queue of a peer\n"
+            "    \"send_queue_time\": {...}    (json object) Microseconds between queueing a message and sending its last byte\n"
+            "  },...\n"
+            "}\n"
+            "Each histogram has the following form:\n"
+            "{\n"
+            "  \"count\": n,                   (numeric) Number of recorded values\n"
+            "  \"sum\": n,                     (numeric) Sum of all recorded values\n"
+            "  \"max\": n,                     (numeric) Largest recorded value\n"
+            "  \"buckets\": {                  (json object) Number of values per bucket, keyed by the bucket bound\n"
+            "    \"bound\": n, ...\n"
+            "  }\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getnetmsgstats", "")
+            + HelpExampleCli("getnetmsgstats", "\"inv\"")
+            + HelpExampleRpc("getnetmsgstats", "\"inv\"")
+                },
+            }.Check(request);
+
+    std::string strCommand;
+    if (!request.params[0].isNull()) {
+        strCommand = request.params[0].get_str();
+    }
+
+    const auto& mapStats = NetMsgStats().GetAll();
+    if (!strCommand.empty() && !mapStats.count(strCommand)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown message type");
+    }
+
+    UniValue obj(UniValue::VOBJ);
+    for (const auto& p : mapStats) {
+        const CNetMsgCommandStats& stats = *p.second;
+        if (strCommand.empty() ? (stats.nRecvMsgs == 0 && stats.nSendMsgs == 0) : p.first != strCommand) {
+            continue;
+        }
+        UniValue cmdObj(UniValue::VOBJ);
+        cmdObj.pushKV("recv_msgs", stats.nRecvMsgs.load());
+        cmdObj.pushKV("recv_bytes", stats.nRecvBytes.load());
+        cmdObj.pushKV("sent_msgs", stats.nSendMsgs.load());
+        cmdObj.pushKV("sent_bytes", stats.nSendBytes.load());
+        cmdObj.pushKV("recv_queue_time", HistogramToJSON(stats.recvQueueTime));
+        cmdObj.pushKV("process_time", HistogramToJSON(stats.processTime));
+        cmdObj.pushKV("lock_wait_time", HistogramToJSON(stats.lockWaitTime));
+        cmdObj.pushKV("send_queue_depth", HistogramToJSON(stats.sendQueueDepth));
+        cmdObj.pushKV("send_queue_time", HistogramToJSON(stats.sendQueueTime));
+        obj.pushKV(p.first, cmdObj);
+    }
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -723,6 +815,7 @@ static const CRPCCommand commands[] =
     { "network",            "disconnectnode",         &disconnectnode,         {"address", "nodeid"} },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       {"node"} },
     { "network",            "getnettotals",           &getnettotals,           {} },
+    { "network",            "getnetmsgstats",         &getnetmsgstats,         {"command"} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         {} },
     { "network",            "setban",                 &setban,                 {"subnet", "command", "bantime", "absolute"} },
     { "network",            "listbanned",             &listbanned,             {} },
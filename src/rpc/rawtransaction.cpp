@@ -8,6 +8,7 @@
 #include <compat/byteswap.h>
 #include <consensus/validation.h>
 #include <core_io.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
 #include <key_io.h>
 #include <merkleblock.h>
@@ -271,6 +272,9 @@ static UniValue getrawtransaction(const JSONRPCRequest& request)
     if (g_txindex && !blockindex) {
         f_txindex_ready = g_txindex->BlockUntilSyncedToCurrentChain();
     }
+    if (g_spentindex && fVerbose && !g_spentindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index is still in the process of being built, try again later");
+    }
 
     CTransactionRef tx;
     uint256 hash_block;
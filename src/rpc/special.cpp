@@ -283,7 +283,7 @@ static std::string SignAndSendSpecialTx(const CMutableTransaction& tx)
         const CTransaction& ctx = CTransaction(tx);
 
         CValidationState state;
-        if (!CheckSpecialTx(ctx, ChainActive().Tip(), state)) {
+        if (!CheckSpecialTx(ctx, ChainActive().Tip(), state, SpecialTxSigCacheMode::LOOKUP)) {
             throw std::runtime_error(FormatStateMessage(state));
         }
 
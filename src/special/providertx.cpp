@@ -4,6 +4,7 @@
 
 #include <special/providertx.h>
 #include <special/deterministicmns.h>
+#include <special/sigcache.h>
 #include <special/specialtx.h>
 #include <special/util.h>
 
@@ -45,31 +46,54 @@ static bool CheckService(const uint256& proTxHash, const ProTx& proTx, CValidati
     return true;
 }
 
+// The payload signature checks skip signatures found in the special transaction signature cache, see
+// SpecialTxSigCacheMode for whether verified signatures are added to it or found entries released.
+
 template <typename ProTx>
-static bool CheckHashSig(const ProTx& proTx, const CKeyID& keyID, CValidationState& state)
+static bool CheckHashSig(const CTransaction& tx, const ProTx& proTx, const CKeyID& keyID, SpecialTxSigCacheMode cacheMode, CValidationState& state)
 {
+    const uint256 hash = ::SerializeHash(proTx);
+    const uint256 entry = ComputeSpecialTxSigCacheEntry(tx.GetHash(), hash, Span<const unsigned char>(keyID.begin(), keyID.size()), MakeSpan(proTx.vchSig));
+    if (GetSpecialTxSigCache(entry, cacheMode == SpecialTxSigCacheMode::RELEASE))
+        return true;
     std::string strError;
-    if (!CHashSigner::VerifyHash(::SerializeHash(proTx), keyID, proTx.vchSig, strError)) {
+    if (!CHashSigner::VerifyHash(hash, keyID, proTx.vchSig, strError)) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-sig", strError);
     }
+    if (cacheMode == SpecialTxSigCacheMode::STORE)
+        SetSpecialTxSigCache(entry);
     return true;
 }
 
 template <typename ProTx>
-static bool CheckStringSig(const ProTx& proTx, const CKeyID& keyID, CValidationState& state)
+static bool CheckStringSig(const CTransaction& tx, const ProTx& proTx, const CKeyID& keyID, SpecialTxSigCacheMode cacheMode, CValidationState& state)
 {
+    const std::string strMessage = proTx.MakeSignString();
+    const uint256 entry = ComputeSpecialTxSigCacheEntry(tx.GetHash(), Hash(strMessage.begin(), strMessage.end()), Span<const unsigned char>(keyID.begin(), keyID.size()), MakeSpan(proTx.vchSig));
+    if (GetSpecialTxSigCache(entry, cacheMode == SpecialTxSigCacheMode::RELEASE))
+        return true;
     std::string strError;
-    if (!CMessageSigner::VerifyMessage(keyID, proTx.vchSig, proTx.MakeSignString(), strError)) {
+    if (!CMessageSigner::VerifyMessage(keyID, proTx.vchSig, strMessage, strError)) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-sig", strError);
     }
+    if (cacheMode == SpecialTxSigCacheMode::STORE)
+        SetSpecialTxSigCache(entry);
     return true;
 }
 
 template <typename ProTx>
-static bool CheckHashSig(const ProTx& proTx, const CBLSPublicKey& pubKey, CValidationState& state)
+static bool CheckHashSig(const CTransaction& tx, const ProTx& proTx, const CBLSPublicKey& pubKey, SpecialTxSigCacheMode cacheMode, CValidationState& state)
 {
-    if (!proTx.sig.VerifyInsecure(pubKey, ::SerializeHash(proTx)))
+    const uint256 hash = ::SerializeHash(proTx);
+    const uint256& keyHash = pubKey.GetHash();
+    const uint256& sigHash = proTx.sig.GetHash();
+    const uint256 entry = ComputeSpecialTxSigCacheEntry(tx.GetHash(), hash, Span<const unsigned char>(keyHash.begin(), keyHash.size()), Span<const unsigned char>(sigHash.begin(), sigHash.size()));
+    if (GetSpecialTxSigCache(entry, cacheMode == SpecialTxSigCacheMode::RELEASE))
+        return true;
+    if (!proTx.sig.VerifyInsecure(pubKey, hash))
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-sig");
+    if (cacheMode == SpecialTxSigCacheMode::STORE)
+        SetSpecialTxSigCache(entry);
     return true;
 }
 
@@ -84,7 +108,7 @@ static bool CheckInputsHash(const CTransaction& tx, const ProTx& proTx, CValidat
     return true;
 }
 
-bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, SpecialTxSigCacheMode cacheMode)
 {
     if (tx.nType != TRANSACTION_PROVIDER_REGISTER)
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -179,7 +203,7 @@ bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValid
 
     if (!keyForPayloadSig.IsNull()) {
         // collateral is not part of this ProRegTx, so we must verify ownership of the collateral
-        if (!CheckStringSig(ptx, keyForPayloadSig, state))
+        if (!CheckStringSig(tx, ptx, keyForPayloadSig, cacheMode, state))
             return false;
     } else {
         // collateral is part of this ProRegTx, so we know the collateral is owned by the issuer
@@ -190,7 +214,7 @@ bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValid
     return true;
 }
 
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, SpecialTxSigCacheMode cacheMode)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_SERVICE) {
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -232,14 +256,14 @@ bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVa
         // we can only check the signature if pindexPrev != NULL and the MN is known
         if (!CheckInputsHash(tx, ptx, state))
             return false;
-        if (!CheckHashSig(ptx, mn->pdmnState->pubKeyOperator.Get(), state))
+        if (!CheckHashSig(tx, ptx, mn->pdmnState->pubKeyOperator.Get(), cacheMode, state))
             return false;
     }
 
     return true;
 }
 
-bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, SpecialTxSigCacheMode cacheMode)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_REGISTRAR)
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -296,14 +320,14 @@ bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
 
         if (!CheckInputsHash(tx, ptx, state))
             return false;
-        if (!CheckHashSig(ptx, dmn->pdmnState->keyIDOwner, state))
+        if (!CheckHashSig(tx, ptx, dmn->pdmnState->keyIDOwner, cacheMode, state))
             return false;
     }
 
     return true;
 }
 
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, SpecialTxSigCacheMode cacheMode)
 {
     if (tx.nType != TRANSACTION_PROVIDER_UPDATE_REVOKE)
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-protx-type");
@@ -328,7 +352,7 @@ bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVal
 
         if (!CheckInputsHash(tx, ptx, state))
             return false;
-        if (!CheckHashSig(ptx, dmn->pdmnState->pubKeyOperator.Get(), state))
+        if (!CheckHashSig(tx, ptx, dmn->pdmnState->pubKeyOperator.Get(), cacheMode, state))
             return false;
     }
 
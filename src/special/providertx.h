@@ -8,6 +8,7 @@
 #include <bls/bls.h>
 #include <consensus/validation.h>
 #include <primitives/transaction.h>
+#include <special/sigcache.h>
 
 #include <netaddress.h>
 #include <pubkey.h>
@@ -178,9 +179,9 @@ public:
 };
 
 
-bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
-bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
+bool CheckProRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, SpecialTxSigCacheMode cacheMode);
+bool CheckProUpServTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, SpecialTxSigCacheMode cacheMode);
+bool CheckProUpRegTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, SpecialTxSigCacheMode cacheMode);
+bool CheckProUpRevTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, SpecialTxSigCacheMode cacheMode);
 
 #endif // BITGREEN_SPECIAL_PROVIDERTX_H
@@ -0,0 +1,87 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <special/sigcache.h>
+
+#include <crypto/sha256.h>
+#include <cuckoocache.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <util/system.h>
+
+#include <boost/thread.hpp>
+
+namespace {
+/**
+ * Valid special transaction payload signature cache, to avoid verifying the
+ * signature of a ProTx twice (once when accepted into the memory pool, and
+ * again when accepted into the block chain)
+ */
+class CSpecialTxSigCache
+{
+private:
+    //! Entries are SHA256(nonce || tx hash || signed hash || key || signature):
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_sigcache;
+
+public:
+    CSpecialTxSigCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& txHash, const uint256& msgHash, Span<const unsigned char> key, Span<const unsigned char> sig)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(txHash.begin(), 32).Write(msgHash.begin(), 32).Write(key.data(), key.size()).Write(sig.data(), sig.size()).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry, const bool erase)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        return setValid.contains(entry, erase);
+    }
+
+    void Set(uint256 entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n)
+    {
+        return setValid.setup_bytes(n);
+    }
+};
+
+static CSpecialTxSigCache specialTxSigCache;
+} // namespace
+
+// To be called once in AppInitMain/BasicTestingSetup to initialize the
+// specialTxSigCache.
+void InitSpecialTxSigCache()
+{
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), (int64_t)DEFAULT_MAX_SPECIALTX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = specialTxSigCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu KiB for special transaction signature cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >> 10, nElems);
+}
+
+uint256 ComputeSpecialTxSigCacheEntry(const uint256& txHash, const uint256& msgHash, Span<const unsigned char> key, Span<const unsigned char> sig)
+{
+    uint256 entry;
+    specialTxSigCache.ComputeEntry(entry, txHash, msgHash, key, sig);
+    return entry;
+}
+
+bool GetSpecialTxSigCache(const uint256& entry, bool erase)
+{
+    return specialTxSigCache.Get(entry, erase);
+}
+
+void SetSpecialTxSigCache(const uint256& entry)
+{
+    specialTxSigCache.Set(entry);
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITGREEN_SPECIAL_SIGCACHE_H
+#define BITGREEN_SPECIAL_SIGCACHE_H
+
+#include <span.h>
+#include <uint256.h>
+
+// Special transactions are rare compared to transaction inputs, so a small
+// cache (over 30000 entries) is plenty. It never exceeds half of -maxsigcachesize.
+static const unsigned int DEFAULT_MAX_SPECIALTX_SIG_CACHE_SIZE = 1;
+
+/** How a payload signature check uses the special transaction signature cache */
+enum class SpecialTxSigCacheMode {
+    //! Skip cached signatures and add verified ones (mempool acceptance, block templates)
+    STORE,
+    //! Skip cached signatures and release their entries (block connection)
+    RELEASE,
+    //! Skip cached signatures, leave the cache untouched (RPC checks of transactions about to be signed)
+    LOOKUP,
+};
+
+/**
+ * Compute the entry for a verified special transaction payload signature. It
+ * commits to the transaction, the signed hash, the key and the signature, so a
+ * key change in the masternode list between mempool acceptance and block
+ * connection can't cause a stale hit.
+ */
+uint256 ComputeSpecialTxSigCacheEntry(const uint256& txHash, const uint256& msgHash, Span<const unsigned char> key, Span<const unsigned char> sig);
+
+/**
+ * Check whether a payload signature was verified before. If erase is set, the
+ * entry may be evicted once found, as done for the script signature cache when
+ * the transaction's block is connected.
+ */
+bool GetSpecialTxSigCache(const uint256& entry, bool erase);
+
+/** Remember a successfully verified payload signature. */
+void SetSpecialTxSigCache(const uint256& entry);
+
+void InitSpecialTxSigCache();
+
+#endif // BITGREEN_SPECIAL_SIGCACHE_H
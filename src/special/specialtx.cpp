@@ -19,7 +19,7 @@
 #include <llmq/quorums_blockprocessor.h>
 
 
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state)
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, SpecialTxSigCacheMode cacheMode)
 {
     if (tx.nVersion < 2 || tx.nType == TRANSACTION_NORMAL || tx.nType == TRANSACTION_STAKE)
         return true;
@@ -28,13 +28,13 @@ bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CVali
     case TRANSACTION_COINBASE:
         return CheckCbTx(tx, pindexPrev, state);
     case TRANSACTION_PROVIDER_REGISTER:
-        return CheckProRegTx(tx, pindexPrev, state);
+        return CheckProRegTx(tx, pindexPrev, state, cacheMode);
     case TRANSACTION_PROVIDER_UPDATE_SERVICE:
-        return CheckProUpServTx(tx, pindexPrev, state);
+        return CheckProUpServTx(tx, pindexPrev, state, cacheMode);
     case TRANSACTION_PROVIDER_UPDATE_REGISTRAR:
-        return CheckProUpRegTx(tx, pindexPrev, state);
+        return CheckProUpRegTx(tx, pindexPrev, state, cacheMode);
     case TRANSACTION_PROVIDER_UPDATE_REVOKE:
-        return CheckProUpRevTx(tx, pindexPrev, state);
+        return CheckProUpRevTx(tx, pindexPrev, state, cacheMode);
     case TRANSACTION_QUORUM_COMMITMENT:
         return llmq::CheckLLMQCommitment(tx, pindexPrev, state);
     }
@@ -93,7 +93,9 @@ bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CV
 
     for (int i = 0; i < (int)block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
-        if (!CheckSpecialTx(tx, pindex->pprev, state))
+        // Payload signatures verified at mempool acceptance are skipped. As for scripts, they are only added to the
+        // cache when the block is just checked, not when it is connected.
+        if (!CheckSpecialTx(tx, pindex->pprev, state, fJustCheck ? SpecialTxSigCacheMode::STORE : SpecialTxSigCacheMode::RELEASE))
             return false;
         if (!ProcessSpecialTx(tx, pindex, state))
             return false;
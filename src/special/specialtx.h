@@ -6,6 +6,7 @@
 #define BITGREEN_SPECIAL_TRANSACTION
 
 #include <primitives/transaction.h>
+#include <special/sigcache.h>
 #include <streams.h>
 #include <version.h>
 
@@ -14,7 +15,8 @@ class CBlock;
 class CBlockIndex;
 class CValidationState;
 
-bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state);
+/** Check a special transaction in the context of pindexPrev, using the payload signature cache as set by cacheMode. */
+bool CheckSpecialTx(const CTransaction& tx, const CBlockIndex* pindexPrev, CValidationState& state, SpecialTxSigCacheMode cacheMode);
 bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, bool fCheckCbTxMerleRoots);
 bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex);
 
@@ -375,5 +375,38 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+/** Aggregated activity of an address, maintained so that balance queries don't need to read the full history */
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+    uint64_t txCount;
+    int lastHeight;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(VARINT(txCount));
+        READWRITE(lastHeight);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        txCount = 0;
+        lastHeight = 0;
+    }
+
+    bool IsNull() const {
+        return (txCount == 0);
+    }
+};
+
 
 #endif // BITCOIN_SPENTINDEX_H
@@ -0,0 +1,258 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
+#include <optional.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <test/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+static CAmount GetValueTo(const CTransaction& tx, const CScript& scriptPubKey)
+{
+    CAmount nValue = 0;
+    for (const CTxOut& out : tx.vout) {
+        if (out.scriptPubKey == scriptPubKey) {
+            nValue += out.nValue;
+        }
+    }
+    return nValue;
+}
+
+/** Spend the P2PK output of a coinbase to a P2PKH output of the same key. */
+static CMutableTransaction MakeSpend(const CKey& key, const CTransaction& coinbase)
+{
+    const CScript p2pk = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(coinbase.GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 11 * CENT;
+    spend.vout[0].scriptPubKey = GetScriptForDestination(PKHash(key.GetPubKey()));
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(p2pk, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    return spend;
+}
+
+static void WaitForSync(BaseIndex& index)
+{
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_initial_sync, TestChain100Setup)
+{
+    AddressIndex addressindex(1 << 20, true);
+    SpentIndex spentindex(1 << 20, true);
+
+    const uint160 keyHash(coinbaseKey.GetPubKey().GetID());
+    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
+
+    // Nothing is indexed before the indexes are started.
+    BOOST_CHECK(addressindex.FindAddressUnspent(keyHash, 1, unspentOutputs));
+    BOOST_CHECK(unspentOutputs.empty());
+
+    addressindex.Start();
+    spentindex.Start();
+    WaitForSync(addressindex);
+    WaitForSync(spentindex);
+
+    // The P2PK coinbase outputs of the initial chain are indexed under the key hash.
+    BOOST_CHECK(addressindex.FindAddressUnspent(keyHash, 1, unspentOutputs));
+    BOOST_CHECK_EQUAL(unspentOutputs.size(), m_coinbase_txns.size());
+    BOOST_CHECK(addressindex.FindAddressIndex(keyHash, 1, addressIndex));
+    BOOST_CHECK_EQUAL(addressIndex.size(), m_coinbase_txns.size());
+
+    // The balance record aggregates the whole history.
+    CScript p2pk = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CAmount nMined = 0;
+    for (const auto& txn : m_coinbase_txns) {
+        nMined += GetValueTo(*txn, p2pk);
+    }
+    CAddressBalanceValue balance;
+    BOOST_CHECK(addressindex.FindAddressBalance(keyHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, nMined);
+    BOOST_CHECK_EQUAL(balance.received, nMined);
+    BOOST_CHECK_EQUAL(balance.txCount, m_coinbase_txns.size());
+    BOOST_CHECK_EQUAL(balance.lastHeight, (int)m_coinbase_txns.size());
+
+    // Spend the first coinbase to a P2PKH output of the same key in a new block.
+    const CMutableTransaction spend = MakeSpend(coinbaseKey, *m_coinbase_txns[0]);
+    const CBlock block = CreateAndProcessBlock({spend}, p2pk);
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(spentindex.BlockUntilSyncedToCurrentChain());
+
+    // The spent output is replaced by the new P2PKH output and the coinbase of the new block.
+    unspentOutputs.clear();
+    BOOST_CHECK(addressindex.FindAddressUnspent(keyHash, 1, unspentOutputs));
+    BOOST_CHECK_EQUAL(unspentOutputs.size(), m_coinbase_txns.size() + 1);
+    for (const auto& entry : unspentOutputs) {
+        BOOST_CHECK(entry.first.txhash != m_coinbase_txns[0]->GetHash());
+    }
+
+    // Activity of the new block: the coinbase output, the spent input and the P2PKH output.
+    addressIndex.clear();
+    BOOST_CHECK(addressindex.FindAddressIndex(keyHash, 1, addressIndex));
+    BOOST_CHECK_EQUAL(addressIndex.size(), m_coinbase_txns.size() + 3);
+
+    // The spending transaction is counted once, although it both spends from and pays to the address.
+    const CAmount nSpent = GetValueTo(*m_coinbase_txns[0], p2pk);
+    const CAmount nNewCoinbase = GetValueTo(*block.vtx[0], p2pk);
+    BOOST_CHECK(addressindex.FindAddressBalance(keyHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, nMined - nSpent + 11 * CENT + nNewCoinbase);
+    BOOST_CHECK_EQUAL(balance.received, nMined + 11 * CENT + nNewCoinbase);
+    BOOST_CHECK_EQUAL(balance.txCount, m_coinbase_txns.size() + 2);
+    BOOST_CHECK_EQUAL(balance.lastHeight, (int)m_coinbase_txns.size() + 1);
+
+    // Addresses without activity have a null record.
+    BOOST_CHECK(addressindex.FindAddressBalance(uint160(), 1, balance));
+    BOOST_CHECK(balance.IsNull());
+
+    CSpentIndexValue value;
+    BOOST_CHECK(spentindex.FindSpentIndex(CSpentIndexKey(m_coinbase_txns[0]->GetHash(), 0), value));
+    BOOST_CHECK(value.txid == spend.GetHash());
+    BOOST_CHECK_EQUAL(value.inputIndex, 0U);
+    BOOST_CHECK_EQUAL(value.addressType, 1);
+    BOOST_CHECK(value.addressHash == keyHash);
+    BOOST_CHECK(!spentindex.FindSpentIndex(CSpentIndexKey(block.vtx[1]->GetHash(), 0), value));
+
+    // Paging through the activity by resuming at the first key not consumed yields the same entries in order.
+    std::vector<std::pair<CAddressIndexKey, CAmount>> paged;
+    Optional<CAddressIndexKey> seekKey;
+    do {
+        size_t nPage = 0;
+        Optional<CAddressIndexKey> nextKey;
+        BOOST_CHECK(addressindex.ForEachAddressIndex(keyHash, 1, 0, 0, seekKey ? &*seekKey : nullptr,
+                                                     [&](const CAddressIndexKey& key, CAmount amount) {
+            if (nPage == 7) {
+                nextKey = key;
+                return false;
+            }
+            paged.emplace_back(key, amount);
+            nPage++;
+            return true;
+        }));
+        seekKey = nextKey;
+    } while (seekKey);
+    BOOST_REQUIRE_EQUAL(paged.size(), addressIndex.size());
+    for (size_t i = 0; i < paged.size(); i++) {
+        BOOST_CHECK(paged[i].first.txhash == addressIndex[i].first.txhash);
+        BOOST_CHECK_EQUAL(paged[i].first.index, addressIndex[i].first.index);
+        BOOST_CHECK_EQUAL(paged[i].second, addressIndex[i].second);
+    }
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    addressindex.Stop();
+    spentindex.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_reorg, TestChain100Setup)
+{
+    AddressIndex addressindex(1 << 20, true);
+    SpentIndex spentindex(1 << 20, true);
+    TimestampIndex timestampindex(1 << 20, true);
+    addressindex.Start();
+    spentindex.Start();
+    timestampindex.Start();
+    WaitForSync(addressindex);
+    WaitForSync(spentindex);
+    WaitForSync(timestampindex);
+
+    const uint160 keyHash(coinbaseKey.GetPubKey().GetID());
+    const CScript p2pk = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const COutPoint spentOutpoint(m_coinbase_txns[0]->GetHash(), 0);
+    const unsigned int nTimeLow = ::ChainActive().Tip()->nTime;
+
+    // Block A spends the first coinbase and is then replaced by block B, which spends nothing.
+    const CMutableTransaction spend = MakeSpend(coinbaseKey, *m_coinbase_txns[0]);
+    const CBlock blockA = CreateAndProcessBlock({spend}, p2pk);
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(spentindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(timestampindex.BlockUntilSyncedToCurrentChain());
+
+    CSpentIndexValue value;
+    BOOST_CHECK(spentindex.FindSpentIndex(CSpentIndexKey(spentOutpoint.hash, spentOutpoint.n), value));
+    std::vector<uint256> hashes;
+    BOOST_CHECK(timestampindex.FindBlockHashes(std::numeric_limits<unsigned int>::max(), nTimeLow, hashes));
+    BOOST_CHECK(std::count(hashes.begin(), hashes.end(), blockA.GetHash()) == 1);
+
+    {
+        CBlockIndex* pindexA = WITH_LOCK(cs_main, return LookupBlockIndex(blockA.GetHash()));
+        BOOST_REQUIRE(pindexA);
+        CValidationState state;
+        BOOST_REQUIRE(InvalidateBlock(state, Params(), pindexA));
+    }
+    const CBlock blockB = CreateAndProcessBlock({}, p2pk);
+    BOOST_REQUIRE(blockB.GetHash() != blockA.GetHash());
+    BOOST_CHECK(addressindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(spentindex.BlockUntilSyncedToCurrentChain());
+    BOOST_CHECK(timestampindex.BlockUntilSyncedToCurrentChain());
+
+    // Rewinding block A restored the spent coinbase and removed the outputs and activity of block A.
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> unspentOutputs;
+    BOOST_CHECK(addressindex.FindAddressUnspent(keyHash, 1, unspentOutputs));
+    BOOST_CHECK_EQUAL(unspentOutputs.size(), m_coinbase_txns.size() + 1);
+    BOOST_CHECK(std::count_if(unspentOutputs.begin(), unspentOutputs.end(), [&](const std::pair<CAddressUnspentKey, CAddressUnspentValue>& entry) {
+        return entry.first.txhash == spentOutpoint.hash;
+    }) == 1);
+    std::vector<std::pair<CAddressIndexKey, CAmount>> addressIndex;
+    BOOST_CHECK(addressindex.FindAddressIndex(keyHash, 1, addressIndex));
+    BOOST_CHECK_EQUAL(addressIndex.size(), m_coinbase_txns.size() + 1);
+    for (const auto& entry : addressIndex) {
+        BOOST_CHECK(entry.first.txhash != spend.GetHash() && entry.first.txhash != blockA.vtx[0]->GetHash());
+    }
+
+    CAmount nMined = 0;
+    for (const auto& txn : m_coinbase_txns) {
+        nMined += GetValueTo(*txn, p2pk);
+    }
+    nMined += GetValueTo(*blockB.vtx[0], p2pk);
+    CAddressBalanceValue balance;
+    BOOST_CHECK(addressindex.FindAddressBalance(keyHash, 1, balance));
+    BOOST_CHECK_EQUAL(balance.balance, nMined);
+    BOOST_CHECK_EQUAL(balance.received, nMined);
+    BOOST_CHECK_EQUAL(balance.txCount, m_coinbase_txns.size() + 1);
+    BOOST_CHECK_EQUAL(balance.lastHeight, (int)m_coinbase_txns.size() + 1);
+
+    BOOST_CHECK(!spentindex.FindSpentIndex(CSpentIndexKey(spentOutpoint.hash, spentOutpoint.n), value));
+
+    hashes.clear();
+    BOOST_CHECK(timestampindex.FindBlockHashes(std::numeric_limits<unsigned int>::max(), nTimeLow, hashes));
+    BOOST_CHECK(std::count(hashes.begin(), hashes.end(), blockA.GetHash()) == 0);
+    BOOST_CHECK(std::count(hashes.begin(), hashes.end(), blockB.GetHash()) == 1);
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    addressindex.Stop();
+    spentindex.Stop();
+    timestampindex.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -321,6 +321,73 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(DeterministicTxPrefillTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+    CBlock block(BuildBlockTestCase());
+
+    // coinstake, marked by an empty first output
+    CMutableTransaction coinstake;
+    coinstake.vin.resize(1);
+    coinstake.vin[0].prevout.hash = InsecureRand256();
+    coinstake.vin[0].prevout.n = 0;
+    coinstake.vout.resize(2);
+    coinstake.vout[0].SetEmpty();
+    coinstake.vout[1].nValue = 42;
+    coinstake.nVersion = 3;
+    coinstake.nType = TRANSACTION_STAKE;
+
+    CMutableTransaction qc;
+    qc.nVersion = 2;
+    qc.nType = TRANSACTION_QUORUM_COMMITMENT;
+    qc.vExtraPayload.resize(32);
+
+    // [coinbase, coinstake, tx in mempool, quorum commitment, locked tx not in the mempool]
+    CTransactionRef lockedTx = block.vtx[2];
+    block.vtx = {block.vtx[0], MakeTransactionRef(coinstake), block.vtx[1], MakeTransactionRef(qc), lockedTx};
+    bool mutated;
+    block.hashMerkleRoot = BlockMerkleRoot(block, &mutated);
+    assert(!mutated);
+
+    LOCK2(cs_main, pool.cs);
+    pool.addUnchecked(entry.FromTx(block.vtx[2]));
+
+    TestHeaderAndShortIDs shortIDs(block);
+    BOOST_CHECK_EQUAL(shortIDs.prefilledtxn.size(), 3U);
+    BOOST_CHECK_EQUAL(shortIDs.shorttxids.size(), 2U);
+    // indexes are offsets since the last prefilled tx
+    BOOST_CHECK_EQUAL(shortIDs.prefilledtxn[0].index, 0);
+    BOOST_CHECK_EQUAL(shortIDs.prefilledtxn[1].index, 0);
+    BOOST_CHECK_EQUAL(shortIDs.prefilledtxn[2].index, 1);
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << CBlockHeaderAndShortTxIDs(block, true);
+
+    CBlockHeaderAndShortTxIDs shortIDs2;
+    stream >> shortIDs2;
+
+    // without the locked tx only that one is missing
+    {
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(shortIDs2, extra_txn) == READ_STATUS_OK);
+        for (size_t i = 0; i < 4; i++) {
+            BOOST_CHECK(partialBlock.IsTxAvailable(i));
+        }
+        BOOST_CHECK(!partialBlock.IsTxAvailable(4));
+    }
+
+    // with it, the block can be reconstructed without a round trip, removed entries are skipped
+    {
+        std::vector<std::pair<uint256, CTransactionRef>> extra_locked_txn{{uint256(), nullptr}, {lockedTx->GetWitnessHash(), lockedTx}};
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(shortIDs2, extra_txn, extra_locked_txn) == READ_STATUS_OK);
+        for (size_t i = 0; i < 5; i++) {
+            BOOST_CHECK(partialBlock.IsTxAvailable(i));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BlockTransactionsRequest req1;
     req1.blockhash = InsecureRand256();
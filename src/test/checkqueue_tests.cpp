@@ -267,6 +267,40 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure)
     tg.join_all();
 }
 
+// Test that the groups of checks added while earlier groups are still being
+// processed (the blocks of the script check pipeline) have separate results.
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Groups)
+{
+    auto fail_queue = MakeUnique<Failing_Queue>(QUEUE_BATCH_SIZE);
+    boost::thread_group tg;
+    for (auto x = 0; x < nScriptCheckThreads; ++x) {
+       tg.create_thread([&]{fail_queue->Thread();});
+    }
+
+    for (auto times = 0; times < 10; ++times) {
+        CCheckQueueControl<FailingCheck> control(fail_queue.get());
+        std::vector<std::pair<unsigned int, bool>> groups;
+        for (size_t i = 0; i < 20; ++i) {
+            const bool fails = InsecureRandBool();
+            std::vector<FailingCheck> vChecks;
+            vChecks.resize(InsecureRandRange(200) + 1, false);
+            vChecks[InsecureRandRange(vChecks.size())] = fails;
+            control.Add(vChecks);
+            groups.emplace_back(control.EndGroup(), fails);
+            // Join the groups one group late, like the blocks of the pipeline
+            if (groups.size() > 1) {
+                BOOST_REQUIRE(control.Wait(groups[groups.size() - 2].first) != groups[groups.size() - 2].second);
+            }
+        }
+        BOOST_REQUIRE(control.Wait(groups.back().first) != groups.back().second);
+        // Groups without checks pass
+        BOOST_REQUIRE(control.Wait(control.EndGroup()));
+        BOOST_REQUIRE(control.Wait());
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
 // Test that unique checks are actually all called individually, rather than
 // just one check being called repeatedly. Test that checks are not called
 // more than once as well
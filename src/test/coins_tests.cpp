@@ -8,6 +8,7 @@
 #include <script/standard.h>
 #include <streams.h>
 #include <test/setup_common.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
@@ -861,4 +862,54 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_background_flush)
+{
+    CCoinsViewDB db(1 << 20, true);
+    CCoinsViewBackgroundFlush flusher(&db, &db);
+    CCoinsViewCache cache(&flusher);
+
+    std::vector<COutPoint> outpoints;
+    for (int i = 0; i < 100; i++) {
+        COutPoint outpoint(InsecureRand256(), 0);
+        cache.AddCoin(outpoint, Coin(CTxOut(i + 1, CScript() << OP_TRUE), 1, false, false), false);
+        outpoints.push_back(outpoint);
+    }
+    const uint256 block1 = InsecureRand256();
+    cache.SetBestBlock(block1);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+
+    // The flushed coins can be read back while they are being written.
+    Coin coin;
+    BOOST_CHECK(cache.GetCoin(outpoints[0], coin));
+    BOOST_CHECK_EQUAL(coin.out.nValue, 1);
+    BOOST_CHECK(flusher.GetBestBlock() == block1);
+
+    BOOST_CHECK(flusher.Sync());
+    BOOST_CHECK(db.GetBestBlock() == block1);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    for (const COutPoint& outpoint : outpoints) {
+        BOOST_CHECK(db.HaveCoin(outpoint));
+    }
+
+    // Spends are written as erasures, the next flush waits for the previous one.
+    BOOST_CHECK(cache.SpendCoin(outpoints[0]));
+    const uint256 block2 = InsecureRand256();
+    cache.SetBestBlock(block2);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(cache.SpendCoin(outpoints[1]));
+    const uint256 block3 = InsecureRand256();
+    cache.SetBestBlock(block3);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!cache.HaveCoin(outpoints[0]));
+    BOOST_CHECK(!cache.HaveCoin(outpoints[1]));
+    BOOST_CHECK(cache.HaveCoin(outpoints[2]));
+
+    BOOST_CHECK(flusher.Sync());
+    BOOST_CHECK(db.GetBestBlock() == block3);
+    BOOST_CHECK(!db.HaveCoin(outpoints[0]));
+    BOOST_CHECK(!db.HaveCoin(outpoints[1]));
+    BOOST_CHECK(db.HaveCoin(outpoints[2]));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,210 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <flat-database.h>
+
+#include <fs.h>
+#include <hash.h>
+#include <streams.h>
+#include <test/setup_common.h>
+
+#include <map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** A minimal cache with log support, finding its changes by comparing serialization hashes */
+class TestCache
+{
+public:
+    std::map<int, int> mapEntries;
+    std::map<int, uint256> mapLogged;
+    //! Make writing a checkpoint fail
+    bool fFailWrite{false};
+
+    void GetLogRecords(std::vector<std::vector<unsigned char>>& vRecords)
+    {
+        std::map<int, uint256> mapHashes;
+        for (const auto& p : mapEntries) {
+            uint256 hash = SerializeHash(p.second);
+            auto it = mapLogged.find(p.first);
+            if (it == mapLogged.end() || it->second != hash) {
+                vRecords.emplace_back();
+                CVectorWriter(SER_DISK, CLIENT_VERSION, vRecords.back(), 0) << true << p.first << p.second;
+            }
+            mapHashes.emplace(p.first, hash);
+        }
+        for (const auto& p : mapLogged) {
+            if (!mapEntries.count(p.first)) {
+                vRecords.emplace_back();
+                CVectorWriter(SER_DISK, CLIENT_VERSION, vRecords.back(), 0) << false << p.first;
+            }
+        }
+        mapLogged = std::move(mapHashes);
+    }
+
+    void ApplyLogRecord(const std::vector<unsigned char>& vRecord)
+    {
+        CDataStream ss(vRecord, SER_DISK, CLIENT_VERSION);
+        bool fPut;
+        int nKey;
+        ss >> fPut >> nKey;
+        if (fPut) {
+            ss >> mapEntries[nKey];
+        } else {
+            mapEntries.erase(nKey);
+        }
+    }
+
+    void Clear() { mapEntries.clear(); }
+    void CheckAndRemove() {}
+    std::string ToString() const { return strprintf("%d entries", mapEntries.size()); }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        if (!ser_action.ForRead() && fFailWrite) {
+            throw std::ios_base::failure("write failed");
+        }
+        READWRITE(mapEntries);
+    }
+};
+
+static TestCache LoadCache()
+{
+    TestCache cache;
+    CFlatDB<TestCache> flatdb("testcache.dat", "magicTestCache");
+    BOOST_REQUIRE(flatdb.Load(cache));
+    return cache;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(flatdb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(flatdb_log_replay)
+{
+    static_assert(FlatDBHasLog<TestCache>::value, "TestCache supports the log");
+
+    const fs::path pathLog = GetDataDir() / "testcache.log";
+    CFlatDB<TestCache> flatdb("testcache.dat", "magicTestCache");
+    TestCache cache;
+    for (int i = 0; i < 100; i++) {
+        cache.mapEntries[i] = i;
+    }
+
+    // without a checkpoint the first flush writes one
+    BOOST_CHECK(flatdb.Flush(cache));
+    BOOST_CHECK(fs::exists(GetDataDir() / "testcache.dat"));
+    BOOST_CHECK(!fs::exists(pathLog));
+    BOOST_CHECK(LoadCache().mapEntries == cache.mapEntries);
+
+    // later changes are appended to the log and replayed on top of the checkpoint
+    cache.mapEntries[1] = 1000;
+    cache.mapEntries.erase(2);
+    cache.mapEntries[200] = 200;
+    BOOST_CHECK(flatdb.Flush(cache));
+    BOOST_CHECK(fs::exists(pathLog));
+    const uint64_t nLogSize = fs::file_size(pathLog);
+    BOOST_CHECK(LoadCache().mapEntries == cache.mapEntries);
+
+    // nothing changed, nothing is written
+    BOOST_CHECK(flatdb.Flush(cache));
+    BOOST_CHECK_EQUAL(fs::file_size(pathLog), nLogSize);
+
+    // a torn record at the end is ignored and overwritten by the next flush
+    {
+        FILE* file = fsbridge::fopen(pathLog, "ab");
+        const unsigned char garbage[] = {0x10, 0x01, 0x02, 0x03};
+        BOOST_REQUIRE(fwrite(garbage, 1, sizeof(garbage), file) == sizeof(garbage));
+        fclose(file);
+    }
+    BOOST_CHECK(LoadCache().mapEntries == cache.mapEntries);
+    cache.mapEntries[3] = 3000;
+    BOOST_CHECK(flatdb.Flush(cache));
+    BOOST_CHECK(LoadCache().mapEntries == cache.mapEntries);
+
+    // a record which doesn't match its hash stops the replay
+    TestCache before = LoadCache();
+    cache.mapEntries[4] = 4000;
+    BOOST_CHECK(flatdb.Flush(cache));
+    {
+        FILE* file = fsbridge::fopen(pathLog, "rb+");
+        BOOST_REQUIRE(fseek(file, -(long)sizeof(uint256) - 1, SEEK_END) == 0);
+        BOOST_REQUIRE(fputc(0xff, file) != EOF);
+        fclose(file);
+    }
+    BOOST_CHECK(LoadCache().mapEntries == before.mapEntries);
+
+    // a checkpoint replaces the log
+    BOOST_CHECK(flatdb.Dump(cache));
+    BOOST_CHECK(!fs::exists(pathLog));
+    BOOST_CHECK(LoadCache().mapEntries == cache.mapEntries);
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_log_checkpoint)
+{
+    const fs::path pathLog = GetDataDir() / "testcache.log";
+    CFlatDB<TestCache> flatdb("testcache.dat", "magicTestCache");
+    TestCache cache;
+    cache.mapEntries[1] = 1;
+    BOOST_CHECK(flatdb.Dump(cache));
+    cache.mapEntries[2] = 2;
+    BOOST_CHECK(flatdb.Flush(cache));
+
+    // a log is never applied to another checkpoint
+    std::vector<char> vLog(fs::file_size(pathLog));
+    {
+        FILE* file = fsbridge::fopen(pathLog, "rb");
+        BOOST_REQUIRE(fread(vLog.data(), 1, vLog.size(), file) == vLog.size());
+        fclose(file);
+    }
+    TestCache other;
+    other.mapEntries[5] = 5;
+    BOOST_CHECK(flatdb.Dump(other));
+    {
+        FILE* file = fsbridge::fopen(pathLog, "wb");
+        BOOST_REQUIRE(fwrite(vLog.data(), 1, vLog.size(), file) == vLog.size());
+        fclose(file);
+    }
+    BOOST_CHECK(LoadCache().mapEntries == other.mapEntries);
+
+    // once the log outgrows the checkpoint a new checkpoint is written
+    for (int i = 0; i < 100 && fs::exists(pathLog); i++) {
+        other.mapEntries[5] = i;
+        BOOST_CHECK(flatdb.Flush(other));
+    }
+    BOOST_CHECK(!fs::exists(pathLog));
+    BOOST_CHECK(LoadCache().mapEntries == other.mapEntries);
+}
+
+BOOST_AUTO_TEST_CASE(flatdb_dump_failure)
+{
+    const fs::path pathLog = GetDataDir() / "testcache.log";
+    CFlatDB<TestCache> flatdb("testcache.dat", "magicTestCache");
+    TestCache cache;
+    cache.mapEntries[1] = 1;
+    BOOST_CHECK(flatdb.Dump(cache));
+    cache.mapEntries[2] = 2;
+    BOOST_CHECK(flatdb.Flush(cache));
+
+    // a failed checkpoint keeps the previous one, and the changes it no longer tracks are appended to its log
+    cache.mapEntries[3] = 3;
+    cache.fFailWrite = true;
+    BOOST_CHECK(!flatdb.Dump(cache));
+    BOOST_CHECK(fs::exists(pathLog));
+    cache.fFailWrite = false;
+    BOOST_CHECK(LoadCache().mapEntries == cache.mapEntries);
+
+    // so later changes are logged without a gap
+    cache.mapEntries[4] = 4;
+    BOOST_CHECK(flatdb.Flush(cache));
+    BOOST_CHECK(LoadCache().mapEntries == cache.mapEntries);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
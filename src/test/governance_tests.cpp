@@ -0,0 +1,285 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bls/bls.h>
+#include <governance/governance.h>
+#include <governance/governance-classes.h>
+#include <governance/governance-vote.h>
+#include <governance/governance-votedb.h>
+#include <key.h>
+#include <key_io.h>
+#include <special/deterministicmns.h>
+#include <util/strencodings.h>
+
+#include <test/setup_common.h>
+
+#include <memory>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_tests, BasicTestingSetup)
+
+static CDeterministicMNCPtr MakeMN(uint64_t internalId, const CBLSPublicKey& pubKeyOperator, const CKeyID& keyIDVoting)
+{
+    auto state = std::make_shared<CDeterministicMNState>();
+    state->keyIDOwner = keyIDVoting;
+    state->pubKeyOperator.Set(pubKeyOperator);
+    state->keyIDVoting = keyIDVoting;
+
+    auto dmn = std::make_shared<CDeterministicMN>();
+    dmn->proTxHash = InsecureRand256();
+    dmn->internalId = internalId;
+    dmn->collateralOutpoint = COutPoint(InsecureRand256(), 0);
+    dmn->pdmnState = state;
+    return dmn;
+}
+
+BOOST_AUTO_TEST_CASE(verify_vote_signatures_duplicates)
+{
+    CBLSSecretKey skOperator, skOther;
+    skOperator.MakeNewKey();
+    skOther.MakeNewKey();
+    CKey keyVoting, keyOther;
+    keyVoting.MakeNewKey(true);
+    keyOther.MakeNewKey(true);
+
+    CDeterministicMNList mnList(uint256(), 1, 2);
+    auto dmnBLS = MakeMN(0, skOperator.GetPublicKey(), keyOther.GetPubKey().GetID());
+    auto dmnECDSA = MakeMN(1, skOther.GetPublicKey(), keyVoting.GetPubKey().GetID());
+    mnList.AddMN(dmnBLS);
+    mnList.AddMN(dmnECDSA);
+
+    const uint256 nParentHash = InsecureRand256();
+
+    // copies of a vote share its hash no matter which signature they carry
+    CGovernanceVote voteBLS(dmnBLS->collateralOutpoint, nParentHash, VOTE_SIGNAL_DELETE, VOTE_OUTCOME_YES);
+    CGovernanceVote voteBLSForged = voteBLS;
+    CGovernanceVote voteBLSGarbage = voteBLS;
+    BOOST_REQUIRE(voteBLS.Sign(skOperator));
+    BOOST_REQUIRE(voteBLSForged.Sign(skOther));
+    voteBLSGarbage.SetSignature({1, 2, 3});
+    BOOST_CHECK(voteBLS.GetHash() == voteBLSForged.GetHash());
+    BOOST_CHECK(voteBLS.GetSignature() != voteBLSForged.GetSignature());
+
+    CGovernanceVote voteECDSA(dmnECDSA->collateralOutpoint, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO);
+    CGovernanceVote voteECDSAForged = voteECDSA;
+    BOOST_REQUIRE(voteECDSA.Sign(keyVoting, keyVoting.GetPubKey().GetID()));
+    BOOST_REQUIRE(voteECDSAForged.Sign(keyOther, keyOther.GetPubKey().GetID()));
+    BOOST_CHECK(voteECDSA.GetHash() == voteECDSAForged.GetHash());
+
+    CGovernanceVote voteUnknown(COutPoint(InsecureRand256(), 0), nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+    BOOST_REQUIRE(voteUnknown.Sign(skOther));
+
+    // the forged copies come first, so that a verdict kept per vote hash would poison the honest votes
+    std::vector<std::pair<CGovernanceVote, bool>> vecVotes{
+        {voteBLSForged, false},
+        {voteBLS, false},
+        {voteECDSAForged, true},
+        {voteECDSA, true},
+        {voteUnknown, false},
+        {voteBLSGarbage, false},
+        {voteBLS, false},
+    };
+    std::vector<CGovernanceManager::VoteSigResult> vecResults;
+    CGovernanceManager govman;
+    govman.VerifyVoteSignatures(mnList, vecVotes, vecResults);
+
+    BOOST_REQUIRE_EQUAL(vecResults.size(), vecVotes.size());
+    BOOST_CHECK_EQUAL(vecResults[0], CGovernanceManager::VOTE_SIG_INVALID);
+    BOOST_CHECK_EQUAL(vecResults[1], CGovernanceManager::VOTE_SIG_VALID);
+    BOOST_CHECK_EQUAL(vecResults[2], CGovernanceManager::VOTE_SIG_INVALID);
+    BOOST_CHECK_EQUAL(vecResults[3], CGovernanceManager::VOTE_SIG_VALID);
+    BOOST_CHECK_EQUAL(vecResults[4], CGovernanceManager::VOTE_SIG_UNCHECKED);
+    BOOST_CHECK_EQUAL(vecResults[5], CGovernanceManager::VOTE_SIG_INVALID);
+    BOOST_CHECK_EQUAL(vecResults[6], CGovernanceManager::VOTE_SIG_VALID);
+
+    // the honest votes are also accepted when verified on their own
+    govman.VerifyVoteSignatures(mnList, {{voteBLS, false}, {voteECDSA, true}}, vecResults);
+    BOOST_CHECK(vecResults == std::vector<CGovernanceManager::VoteSigResult>(2, CGovernanceManager::VOTE_SIG_VALID));
+}
+
+static CGovernanceObject MakeTrigger(int nBlockHeight, const std::string& strAddress, const std::string& strAmount)
+{
+    std::string strData = strprintf("{\"event_block_height\": %d, \"payment_addresses\": \"%s\", \"payment_amounts\": \"%s\", \"type\": %d}",
+        nBlockHeight, strAddress, strAmount, GOVERNANCE_OBJECT_TRIGGER);
+    return CGovernanceObject(uint256(), 1, GetTime(), InsecureRand256(), HexStr(strData.begin(), strData.end()));
+}
+
+static void AddVotes(CGovernanceObject& govobj, vote_outcome_enum_t eOutcome, int nCount)
+{
+    for (int i = 0; i < nCount; i++) {
+        CGovernanceVote vote(COutPoint(InsecureRand256(), 0), govobj.GetHash(), VOTE_SIGNAL_FUNDING, eOutcome);
+        governanceVoteDb->WriteVote(vote);
+        BOOST_REQUIRE(govobj.RestoreVote(vote));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(vote_tallies)
+{
+    CGovernanceObject govobj = MakeTrigger(100, "", "1");
+    AddVotes(govobj, VOTE_OUTCOME_YES, 3);
+    AddVotes(govobj, VOTE_OUTCOME_NO, 2);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_FUNDING), 3);
+    BOOST_CHECK_EQUAL(govobj.GetNoCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(govobj.GetAbsoluteYesCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_DELETE), 0);
+
+    // a newer vote of a masternode replaces its vote in the tallies
+    const COutPoint outpoint(InsecureRand256(), 0);
+    CGovernanceVote vote(outpoint, govobj.GetHash(), VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+    vote.SetTime(1000);
+    BOOST_REQUIRE(govobj.RestoreVote(vote));
+    CGovernanceVote voteNewer(outpoint, govobj.GetHash(), VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_ABSTAIN);
+    voteNewer.SetTime(2000);
+    BOOST_REQUIRE(govobj.RestoreVote(voteNewer));
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_FUNDING), 3);
+    BOOST_CHECK_EQUAL(govobj.GetAbstainCount(VOTE_SIGNAL_FUNDING), 1);
+
+    // the tallies are rebuilt from the current votes when an object is read from disk
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << govobj;
+    CGovernanceObject govobjLoaded;
+    ss >> govobjLoaded;
+    BOOST_CHECK_EQUAL(govobjLoaded.GetYesCount(VOTE_SIGNAL_FUNDING), 3);
+    BOOST_CHECK_EQUAL(govobjLoaded.GetNoCount(VOTE_SIGNAL_FUNDING), 2);
+    BOOST_CHECK_EQUAL(govobjLoaded.GetAbstainCount(VOTE_SIGNAL_FUNDING), 1);
+    BOOST_CHECK_EQUAL(CGovernanceObject(govobjLoaded).GetNoCount(VOTE_SIGNAL_FUNDING), 2);
+
+    govobj.EraseVotes();
+    BOOST_CHECK_EQUAL(govobj.GetYesCount(VOTE_SIGNAL_FUNDING), 0);
+    BOOST_CHECK_EQUAL(govobj.GetAbstainCount(VOTE_SIGNAL_FUNDING), 0);
+}
+
+static CAmount GetSuperblockPayment(int nBlockHeight)
+{
+    std::vector<CTxOut> vout;
+    if (!CSuperblockManager::GetSuperblockPayments(nBlockHeight, vout)) {
+        return 0;
+    }
+    BOOST_REQUIRE_EQUAL(vout.size(), 1U);
+    return vout[0].nValue;
+}
+
+BOOST_AUTO_TEST_CASE(superblock_trigger_index)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const std::string strAddress = EncodeDestination(PKHash(key.GetPubKey()));
+
+    int nLastSuperblock, nNextSuperblock;
+    CSuperblock::GetNearestSuperblocksHeights(0, nLastSuperblock, nNextSuperblock);
+    const int nSuperblockCycle = Params().GetConsensus().nSuperblockCycle;
+
+    // the winner of the first height has the most yes votes after subtracting no votes,
+    // the trigger for the second height has no net yes votes and never wins
+    CGovernanceObject trigger1 = MakeTrigger(nNextSuperblock, strAddress, "1");
+    CGovernanceObject trigger2 = MakeTrigger(nNextSuperblock, strAddress, "2");
+    CGovernanceObject trigger3 = MakeTrigger(nNextSuperblock + nSuperblockCycle, strAddress, "3");
+    AddVotes(trigger1, VOTE_OUTCOME_YES, 3);
+    AddVotes(trigger2, VOTE_OUTCOME_YES, 4);
+    AddVotes(trigger2, VOTE_OUTCOME_NO, 2);
+    AddVotes(trigger3, VOTE_OUTCOME_YES, 1);
+    AddVotes(trigger3, VOTE_OUTCOME_NO, 1);
+
+    // governance objects are seeded like governance.log would be replayed, which skips their validation
+    governance.Clear();
+    std::vector<std::vector<unsigned char>> vRecords;
+    governance.GetLogRecords(vRecords);
+    BOOST_REQUIRE(!vRecords.empty());
+    std::string strVersion;
+    CDataStream(vRecords[0], SER_DISK, CLIENT_VERSION) >> strVersion;
+    for (const CGovernanceObject* pObj : {&trigger1, &trigger2, &trigger3}) {
+        std::vector<unsigned char> vRecord;
+        CVectorWriter(SER_DISK, CLIENT_VERSION, vRecord, 0) << strVersion << 'o' << pObj->GetHash() << *pObj;
+        governance.ApplyLogRecord(vRecord);
+    }
+    governance.InitOnLoad();
+
+    BOOST_CHECK_EQUAL(GetSuperblockPayment(nNextSuperblock), 1 * COIN);
+    BOOST_CHECK_EQUAL(GetSuperblockPayment(nNextSuperblock + nSuperblockCycle), 0);
+    BOOST_CHECK_EQUAL(GetSuperblockPayment(nNextSuperblock + 2 * nSuperblockCycle), 0);
+    BOOST_CHECK_EQUAL(GetSuperblockPayment(nNextSuperblock + 1), 0);
+
+    // new votes on a trigger update the precomputed winner
+    {
+        LOCK(governance.cs);
+        CGovernanceObject* pObj = governance.FindGovernanceObject(trigger2.GetHash());
+        BOOST_REQUIRE(pObj != nullptr);
+        AddVotes(*pObj, VOTE_OUTCOME_YES, 2);
+    }
+    BOOST_CHECK_EQUAL(GetSuperblockPayment(nNextSuperblock), 2 * COIN);
+    {
+        LOCK(governance.cs);
+        AddVotes(*governance.FindGovernanceObject(trigger3.GetHash()), VOTE_OUTCOME_YES, 1);
+    }
+    BOOST_CHECK_EQUAL(GetSuperblockPayment(nNextSuperblock + nSuperblockCycle), 3 * COIN);
+
+    // removed objects are dropped from the index
+    governance.Clear();
+    BOOST_CHECK_EQUAL(GetSuperblockPayment(nNextSuperblock), 0);
+    BOOST_CHECK_EQUAL(GetSuperblockPayment(nNextSuperblock + nSuperblockCycle), 0);
+}
+
+static char GetLogRecordType(const std::vector<unsigned char>& vRecord)
+{
+    std::string strVersion;
+    char nType;
+    CDataStream(vRecord, SER_DISK, CLIENT_VERSION) >> strVersion >> nType;
+    return nType;
+}
+
+BOOST_AUTO_TEST_CASE(log_records)
+{
+    CGovernanceManager govman;
+    std::vector<std::vector<unsigned char>> vRecords;
+    govman.GetLogRecords(vRecords);
+    BOOST_CHECK(vRecords.empty());
+
+    // every part of the state is logged after clearing it
+    govman.Clear();
+    govman.GetLogRecords(vRecords);
+    BOOST_REQUIRE_EQUAL(vRecords.size(), 5U);
+    std::string strVersion;
+    CDataStream(vRecords[0], SER_DISK, CLIENT_VERSION) >> strVersion;
+
+    // replayed records are not logged again
+    CGovernanceObject govobj = MakeTrigger(100, "", "1");
+    const uint256 nHash = govobj.GetHash();
+    std::vector<unsigned char> vRecord;
+    CVectorWriter(SER_DISK, CLIENT_VERSION, vRecord, 0) << strVersion << 'o' << nHash << govobj;
+    govman.ApplyLogRecord(vRecord);
+    vRecords.clear();
+    govman.GetLogRecords(vRecords);
+    BOOST_CHECK(vRecords.empty());
+
+    // a vote record adds the vote to its object
+    CGovernanceVote vote(COutPoint(InsecureRand256(), 0), nHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+    governanceVoteDb->WriteVote(vote);
+    vRecord.clear();
+    CVectorWriter(SER_DISK, CLIENT_VERSION, vRecord, 0) << strVersion << 'v' << vote;
+    govman.ApplyLogRecord(vRecord);
+    {
+        LOCK(govman.cs);
+        CGovernanceObject* pObj = govman.FindGovernanceObject(nHash);
+        BOOST_REQUIRE(pObj != nullptr);
+        BOOST_CHECK_EQUAL(pObj->GetYesCount(VOTE_SIGNAL_FUNDING), 1);
+    }
+
+    // only the objects marked as dirty are logged
+    govman.SetObjectDirty(nHash);
+    govman.GetLogRecords(vRecords);
+    BOOST_REQUIRE_EQUAL(vRecords.size(), 1U);
+    BOOST_CHECK_EQUAL(GetLogRecordType(vRecords[0]), 'o');
+    vRecords.clear();
+    govman.GetLogRecords(vRecords);
+    BOOST_CHECK(vRecords.empty());
+
+    govman.Clear();
+    govman.GetLogRecords(vRecords);
+    BOOST_REQUIRE(!vRecords.empty());
+    BOOST_CHECK_EQUAL(GetLogRecordType(vRecords[0]), 'e');
+}
+
+BOOST_AUTO_TEST_SUITE_END()
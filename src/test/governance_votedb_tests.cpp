@@ -0,0 +1,152 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <governance/governance-votedb.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(governance_votedb_tests, BasicTestingSetup)
+
+static CGovernanceVote MakeVote(const COutPoint& outpoint, const uint256& nParentHash, vote_signal_enum_t eSignal, vote_outcome_enum_t eOutcome, int64_t nTime)
+{
+    CGovernanceVote vote(outpoint, nParentHash, eSignal, eOutcome);
+    vote.SetTime(nTime);
+    return vote;
+}
+
+BOOST_AUTO_TEST_CASE(votefile_add_and_load)
+{
+    uint256 nParentHash = InsecureRand256();
+    COutPoint mn1(InsecureRand256(), 0);
+    COutPoint mn2(InsecureRand256(), 1);
+
+    CGovernanceObjectVoteFile fileVotes;
+    fileVotes.SetDiskOwner();
+    CGovernanceVote vote1 = MakeVote(mn1, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000);
+    CGovernanceVote vote2 = MakeVote(mn2, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 1000);
+    fileVotes.AddVote(vote1);
+    fileVotes.AddVote(vote2);
+    // adding the same vote twice must be a no-op
+    fileVotes.AddVote(vote1);
+
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 2);
+    BOOST_CHECK(fileVotes.HasVote(vote1.GetHash()));
+    BOOST_CHECK(fileVotes.HasVote(vote2.GetHash()));
+
+    // votes are read back from disk
+    CGovernanceVote voteRead;
+    BOOST_CHECK(governanceVoteDb->ReadVote(vote1.GetHash(), voteRead));
+    BOOST_CHECK(voteRead == vote1);
+    BOOST_CHECK_EQUAL(fileVotes.GetVotes().size(), 2U);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK(fileVotes.SerializeVoteToStream(vote2.GetHash(), ss));
+    ss >> voteRead;
+    BOOST_CHECK(voteRead == vote2);
+
+    // a newer vote from the same masternode on the same signal replaces the old one
+    CGovernanceVote vote3 = MakeVote(mn1, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 2000);
+    fileVotes.AddVote(vote3);
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 2);
+    BOOST_CHECK(!fileVotes.HasVote(vote1.GetHash()));
+    BOOST_CHECK(!governanceVoteDb->ReadVote(vote1.GetHash(), voteRead));
+
+    fileVotes.RemoveVotesFromMasternode(mn2);
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 1);
+    BOOST_CHECK(!governanceVoteDb->ReadVote(vote2.GetHash(), voteRead));
+
+    fileVotes.EraseAll();
+    BOOST_CHECK_EQUAL(fileVotes.GetVoteCount(), 0);
+    BOOST_CHECK(!governanceVoteDb->ReadVote(vote3.GetHash(), voteRead));
+}
+
+BOOST_AUTO_TEST_CASE(votefile_serialize_index)
+{
+    uint256 nParentHash = InsecureRand256();
+    COutPoint mn(InsecureRand256(), 0);
+
+    CGovernanceObjectVoteFile fileVotes;
+    CGovernanceVote vote = MakeVote(mn, nParentHash, VOTE_SIGNAL_DELETE, VOTE_OUTCOME_YES, 1000);
+    fileVotes.AddVote(vote);
+
+    // only the index is serialized, the vote itself stays on disk
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << fileVotes;
+    CGovernanceObjectVoteFile fileVotes2;
+    ss >> fileVotes2;
+    BOOST_CHECK(fileVotes2.HasVote(vote.GetHash()));
+    BOOST_CHECK_EQUAL(fileVotes2.GetVotes().size(), 1U);
+
+    // unreferenced votes are pruned
+    BOOST_CHECK_EQUAL(governanceVoteDb->EraseVotesIf([](const uint256&, const CGovernanceVote&) { return false; }), 1U);
+    BOOST_CHECK(fileVotes2.GetVotes().empty());
+}
+
+BOOST_AUTO_TEST_CASE(votefile_copies)
+{
+    uint256 nParentHash = InsecureRand256();
+    COutPoint mn(InsecureRand256(), 0);
+    CGovernanceVote vote = MakeVote(mn, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000);
+    CGovernanceVote voteRead;
+
+    CGovernanceObjectVoteFile fileVotes;
+    fileVotes.SetDiskOwner();
+    fileVotes.AddVote(vote);
+    {
+        // a copy is a view, erasing it leaves the votes on disk the original still references
+        CGovernanceObjectVoteFile fileCopy(fileVotes);
+        BOOST_CHECK(!fileCopy.IsDiskOwner());
+        fileCopy.EraseAll();
+        BOOST_CHECK_EQUAL(fileCopy.GetVoteCount(), 0);
+        BOOST_CHECK(governanceVoteDb->ReadVote(vote.GetHash(), voteRead));
+        BOOST_CHECK_EQUAL(fileVotes.GetVotes().size(), 1U);
+    }
+    {
+        // also once the owner is gone, only the file made owner erases
+        std::unique_ptr<CGovernanceObjectVoteFile> pOriginal(new CGovernanceObjectVoteFile(fileVotes));
+        pOriginal->SetDiskOwner();
+        CGovernanceObjectVoteFile fileCopy(*pOriginal);
+        pOriginal.reset();
+        fileCopy.EraseAll();
+        BOOST_CHECK(governanceVoteDb->ReadVote(vote.GetHash(), voteRead));
+    }
+    fileVotes.EraseAll();
+    BOOST_CHECK(!governanceVoteDb->ReadVote(vote.GetHash(), voteRead));
+}
+
+BOOST_AUTO_TEST_CASE(votefile_unclean_shutdown)
+{
+    uint256 nParentHash = InsecureRand256();
+    COutPoint mn1(InsecureRand256(), 0);
+    COutPoint mn2(InsecureRand256(), 1);
+    CGovernanceVote vote1 = MakeVote(mn1, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000);
+    CGovernanceVote vote2 = MakeVote(mn2, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES, 1000);
+
+    // the index was dumped with vote1, then vote1 was erased and vote2 written before the node crashed
+    CGovernanceObjectVoteFile fileVotes;
+    fileVotes.SetDiskOwner();
+    fileVotes.AddVote(vote1);
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << fileVotes;
+    fileVotes.AddVote(vote2);
+    fileVotes.EraseAll();
+    governanceVoteDb->WriteVote(vote2);
+
+    CGovernanceObjectVoteFile fileLoaded;
+    ss >> fileLoaded;
+    BOOST_CHECK_EQUAL(fileLoaded.RemoveMissingVotes(), 1U);
+    BOOST_CHECK(!fileLoaded.HasVote(vote1.GetHash()));
+    BOOST_CHECK(fileLoaded.RestoreVote(vote2));
+    BOOST_CHECK(fileLoaded.HasVote(vote2.GetHash()));
+    BOOST_CHECK_EQUAL(fileLoaded.GetVotes().size(), 1U);
+
+    // a vote replaced by a newer one is not restored
+    CGovernanceVote vote2old = MakeVote(mn2, nParentHash, VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_NO, 500);
+    BOOST_CHECK(!fileLoaded.RestoreVote(vote2old));
+    BOOST_CHECK(!fileLoaded.HasVote(vote2old.GetHash()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,165 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternodes/meta.h>
+#include <special/deterministicmns.h>
+#include <streams.h>
+
+#include <test/setup_common.h>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+struct MasternodeMetaSetup : public BasicTestingSetup {
+    MasternodeMetaSetup() { mmetaman.Clear(); }
+    ~MasternodeMetaSetup() { mmetaman.Clear(); }
+};
+
+BOOST_FIXTURE_TEST_SUITE(masternode_meta_tests, MasternodeMetaSetup)
+
+static std::vector<uint256> MakeHashes(size_t nCount)
+{
+    std::vector<uint256> vecHashes;
+    for (size_t i = 0; i < nCount; i++) {
+        vecHashes.push_back(InsecureRand256());
+    }
+    return vecHashes;
+}
+
+BOOST_AUTO_TEST_CASE(meta_lookup_and_serialize)
+{
+    const std::vector<uint256> vecProTxHashes = MakeHashes(100);
+
+    BOOST_CHECK(mmetaman.GetMetaInfo(vecProTxHashes[0], false) == nullptr);
+    BOOST_CHECK_EQUAL(mmetaman.GetMetaInfoCount(), 0U);
+    for (const auto& proTxHash : vecProTxHashes) {
+        auto mm = mmetaman.GetMetaInfo(proTxHash);
+        BOOST_REQUIRE(mm != nullptr);
+        BOOST_CHECK(mm->GetProTxHash() == proTxHash);
+        // lookups return the same entry
+        BOOST_CHECK(mmetaman.GetMetaInfo(proTxHash, false) == mm);
+    }
+    BOOST_CHECK_EQUAL(mmetaman.GetMetaInfoCount(), vecProTxHashes.size());
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << mmetaman;
+    mmetaman.Clear();
+    BOOST_CHECK_EQUAL(mmetaman.GetMetaInfoCount(), 0U);
+    ss >> mmetaman;
+    BOOST_CHECK_EQUAL(mmetaman.GetMetaInfoCount(), vecProTxHashes.size());
+    for (const auto& proTxHash : vecProTxHashes) {
+        BOOST_CHECK(mmetaman.GetMetaInfo(proTxHash, false) != nullptr);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(meta_concurrent_access)
+{
+    // every thread creates and looks up the same entries, each of them must only be created once
+    const std::vector<uint256> vecProTxHashes = MakeHashes(1000);
+    const uint256 nGovernanceObjectHash = InsecureRand256();
+    std::atomic<int> nMissing{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([&]() {
+            for (const auto& proTxHash : vecProTxHashes) {
+                mmetaman.AddGovernanceVote(proTxHash, nGovernanceObjectHash);
+                if (mmetaman.GetMetaInfo(proTxHash, false) == nullptr) {
+                    nMissing++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(nMissing, 0);
+    BOOST_CHECK_EQUAL(mmetaman.GetMetaInfoCount(), vecProTxHashes.size());
+}
+
+BOOST_AUTO_TEST_CASE(meta_evict_removed_masternodes)
+{
+    const std::vector<uint256> vecProTxHashes = MakeHashes(50);
+    const uint256 nHashKept = InsecureRand256();
+    const uint256 nHashRemoved = InsecureRand256();
+
+    // only every other masternode is still registered
+    CDeterministicMNList mnList(uint256(), 1, vecProTxHashes.size());
+    for (size_t i = 0; i < vecProTxHashes.size(); i++) {
+        if (i % 2 == 0) {
+            auto state = std::make_shared<CDeterministicMNState>();
+            state->keyIDOwner = CKeyID(uint160(std::vector<unsigned char>(vecProTxHashes[i].begin(), vecProTxHashes[i].begin() + 20)));
+            auto dmn = std::make_shared<CDeterministicMN>();
+            dmn->proTxHash = vecProTxHashes[i];
+            dmn->internalId = i;
+            dmn->collateralOutpoint = COutPoint(vecProTxHashes[i], 0);
+            dmn->pdmnState = state;
+            mnList.AddMN(dmn);
+            mmetaman.AddGovernanceVote(vecProTxHashes[i], nHashKept);
+        } else {
+            mmetaman.AddGovernanceVote(vecProTxHashes[i], nHashRemoved);
+        }
+    }
+    mmetaman.GetAndClearDirtyGovernanceObjectHashes();
+
+    mmetaman.RemoveMissingMasternodes(mnList);
+    BOOST_CHECK_EQUAL(mmetaman.GetMetaInfoCount(), vecProTxHashes.size() / 2);
+    for (size_t i = 0; i < vecProTxHashes.size(); i++) {
+        BOOST_CHECK_EQUAL(mmetaman.GetMetaInfo(vecProTxHashes[i], false) != nullptr, i % 2 == 0);
+    }
+
+    // only the objects voted on by removed masternodes need to be recalculated
+    std::vector<uint256> vecDirty = mmetaman.GetAndClearDirtyGovernanceObjectHashes();
+    BOOST_CHECK(!vecDirty.empty());
+    BOOST_CHECK(std::all_of(vecDirty.begin(), vecDirty.end(), [&](const uint256& nHash) { return nHash == nHashRemoved; }));
+
+    // nothing left to evict
+    mmetaman.RemoveMissingMasternodes(mnList);
+    BOOST_CHECK_EQUAL(mmetaman.GetMetaInfoCount(), vecProTxHashes.size() / 2);
+    BOOST_CHECK(mmetaman.GetAndClearDirtyGovernanceObjectHashes().empty());
+}
+
+BOOST_AUTO_TEST_CASE(meta_log_records)
+{
+    const std::vector<uint256> vecProTxHashes = MakeHashes(10);
+    const uint256 nGovernanceObjectHash = InsecureRand256();
+    CMasternodeMetaMan metaman, metamanReplayed;
+    std::vector<std::vector<unsigned char>> vRecords;
+
+    // only the changed meta infos are logged, and only once
+    for (const auto& proTxHash : vecProTxHashes) {
+        metaman.AddGovernanceVote(proTxHash, nGovernanceObjectHash);
+    }
+    metaman.GetLogRecords(vRecords);
+    BOOST_CHECK_EQUAL(vRecords.size(), vecProTxHashes.size());
+    for (const auto& vRecord : vRecords) {
+        metamanReplayed.ApplyLogRecord(vRecord);
+    }
+    BOOST_CHECK_EQUAL(metamanReplayed.GetMetaInfoCount(), vecProTxHashes.size());
+    vRecords.clear();
+    metaman.GetLogRecords(vRecords);
+    BOOST_CHECK(vRecords.empty());
+
+    metaman.RemoveGovernanceObject(InsecureRand256());
+    metaman.GetLogRecords(vRecords);
+    BOOST_CHECK(vRecords.empty());
+    metaman.RemoveGovernanceObject(nGovernanceObjectHash);
+    metaman.GetLogRecords(vRecords);
+    BOOST_CHECK_EQUAL(vRecords.size(), vecProTxHashes.size());
+
+    // evicted meta infos are erased on replay
+    vRecords.clear();
+    metaman.RemoveMissingMasternodes(CDeterministicMNList());
+    metaman.GetLogRecords(vRecords);
+    BOOST_CHECK_EQUAL(vRecords.size(), vecProTxHashes.size());
+    for (const auto& vRecord : vRecords) {
+        metamanReplayed.ApplyLogRecord(vRecord);
+    }
+    BOOST_CHECK_EQUAL(metamanReplayed.GetMetaInfoCount(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
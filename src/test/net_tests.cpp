@@ -12,6 +12,9 @@
 #include <streams.h>
 #include <net.h>
 #include <netbase.h>
+#include <netmessagemaker.h>
+#include <netmsgstats.h>
+#include <special/deterministicmns.h>
 #include <chainparams.h>
 #include <util/memory.h>
 #include <util/system.h>
@@ -190,6 +193,188 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+BOOST_AUTO_TEST_CASE(netmsgstats_histogram)
+{
+    CNetMsgHistogram histogram;
+    for (int64_t nValue : std::vector<int64_t>{-5, 0, 1, 2, 3, 4, 5, 1000, std::numeric_limits<int64_t>::max()}) {
+        histogram.Add(nValue);
+    }
+    const auto snapshot = histogram.GetSnapshot();
+    BOOST_CHECK_EQUAL(snapshot.nCount, 9U);
+    BOOST_CHECK_EQUAL(snapshot.nMax, (uint64_t)std::numeric_limits<int64_t>::max());
+    BOOST_CHECK_EQUAL(snapshot.vBuckets[0], 3U); // -5 (clamped to 0), 0 and 1
+    BOOST_CHECK_EQUAL(snapshot.vBuckets[1], 1U); // 2
+    BOOST_CHECK_EQUAL(snapshot.vBuckets[2], 2U); // 3 and 4
+    BOOST_CHECK_EQUAL(snapshot.vBuckets[3], 1U); // 5
+    BOOST_CHECK_EQUAL(snapshot.vBuckets[10], 1U); // 1000
+    BOOST_CHECK_EQUAL(snapshot.vBuckets[CNetMsgHistogram::BUCKET_COUNT - 1], 1U);
+    BOOST_CHECK_EQUAL(CNetMsgHistogram::GetBucketBound(10), 1024U);
+    BOOST_CHECK_EQUAL(CNetMsgHistogram::GetBucketBound(CNetMsgHistogram::BUCKET_COUNT - 1), 0U);
+
+    // unknown message types are accounted together
+    BOOST_CHECK_EQUAL(&NetMsgStats().Get("foo"), &NetMsgStats().Get(NET_MESSAGE_COMMAND_OTHER));
+    BOOST_CHECK(&NetMsgStats().Get(NetMsgType::INV) != &NetMsgStats().Get(NET_MESSAGE_COMMAND_OTHER));
+
+    NetMsgStats().Get(NetMsgType::GETBLOCKTXN).nRecvMsgs++;
+    NetMsgStats().Get(NetMsgType::GETBLOCKTXN).processTime.Add(3);
+    std::string strMetrics = NetMsgStatsToPrometheus();
+    BOOST_CHECK(strMetrics.find("bitgreen_net_msg_process_seconds_bucket{command=\"getblocktxn\",le=\"4e-06\"} 1\n") != std::string::npos);
+    BOOST_CHECK(strMetrics.find("bitgreen_net_msg_process_seconds_count{command=\"getblocktxn\"} 1\n") != std::string::npos);
+}
+
+#ifndef WIN32
+static std::vector<unsigned char> SerializeWithHeader(const std::string& strCommand, const std::vector<unsigned char>& data)
+{
+    uint256 hash = Hash(data.begin(), data.end());
+    CMessageHeader hdr(Params().MessageStart(), strCommand.c_str(), data.size());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+
+    std::vector<unsigned char> vData;
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, vData, 0, hdr};
+    vData.insert(vData.end(), data.begin(), data.end());
+    return vData;
+}
+
+static std::vector<unsigned char> ReadAvailable(SOCKET hSocket)
+{
+    std::vector<unsigned char> vData;
+    unsigned char pchBuf[0x10000];
+    ssize_t nBytes;
+    while ((nBytes = recv(hSocket, (char*)pchBuf, sizeof(pchBuf), MSG_DONTWAIT)) > 0) {
+        vData.insert(vData.end(), pchBuf, pchBuf + nBytes);
+    }
+    return vData;
+}
+
+BOOST_AUTO_TEST_CASE(cnode_send_queue)
+{
+    int fds[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    SetSocketNonBlocking(fds[0], true);
+
+    CConnman connman(0x1337, 0x1337);
+    CAddress addr(CService(CNetAddr(), 0), NODE_NONE);
+    CNode node(0, NODE_NETWORK, 0, fds[0], addr, 0, 0, CAddress(), "", true);
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+
+    // owned and shared payloads end up on the wire exactly like before
+    std::vector<unsigned char> vExpected;
+    auto ping = msgMaker.Make(NetMsgType::PING, uint64_t(42));
+    vExpected = SerializeWithHeader(NetMsgType::PING, ping.data);
+    connman.PushMessage(&node, std::move(ping));
+
+    auto payload = msgMaker.MakePayload(0, std::vector<unsigned char>(1000, 0x55));
+    for (int i = 0; i < 2; i++) {
+        auto vMsg = SerializeWithHeader(NetMsgType::BLOCK, payload->data);
+        vExpected.insert(vExpected.end(), vMsg.begin(), vMsg.end());
+        connman.PushMessage(&node, msgMaker.MakeShared(NetMsgType::BLOCK, payload));
+    }
+    connman.PushMessage(&node, msgMaker.Make(NetMsgType::VERACK));
+    auto vVerack = SerializeWithHeader(NetMsgType::VERACK, {});
+    vExpected.insert(vExpected.end(), vVerack.begin(), vVerack.end());
+
+    BOOST_CHECK(ReadAvailable(fds[1]) == vExpected);
+    {
+        LOCK(node.cs_vSend);
+        BOOST_CHECK(node.vSendMsg.empty());
+        BOOST_CHECK_EQUAL(node.nSendSize, 0);
+        BOOST_CHECK_EQUAL(node.nSendOffset, 0);
+    }
+
+    // a payload which doesn't fit into the socket buffer is only partially sent and stays queued
+    auto bigPayload = msgMaker.MakePayload(0, std::vector<unsigned char>(8 * 1000 * 1000, 0xaa));
+    connman.PushMessage(&node, msgMaker.MakeShared(NetMsgType::BLOCK, bigPayload));
+    connman.PushMessage(&node, msgMaker.Make(NetMsgType::VERACK));
+    size_t nTotalSize = 2 * CMessageHeader::HEADER_SIZE + bigPayload->data.size();
+    size_t nReceived = ReadAvailable(fds[1]).size();
+    BOOST_CHECK(nReceived > 0 && nReceived < nTotalSize);
+    {
+        LOCK(node.cs_vSend);
+        BOOST_CHECK_EQUAL(node.vSendMsg.size(), 2);
+        BOOST_CHECK_EQUAL(node.nSendSize, nTotalSize - nReceived);
+        BOOST_CHECK_EQUAL(node.nSendOffset, nReceived);
+    }
+
+    SOCKET hRemote = fds[1];
+    CloseSocket(hRemote);
+}
+#endif // WIN32
+
+static CDeterministicMNCPtr MakeMasternode(uint64_t internalId, const CService& addr)
+{
+    auto dmn = std::make_shared<CDeterministicMN>();
+    dmn->proTxHash = InsecureRand256();
+    auto state = std::make_shared<CDeterministicMNState>();
+    state->addr = addr;
+    state->keyIDOwner = CKeyID(uint160(std::vector<unsigned char>(dmn->proTxHash.begin(), dmn->proTxHash.begin() + 20)));
+    dmn->internalId = internalId;
+    dmn->collateralOutpoint = COutPoint(InsecureRand256(), 0);
+    dmn->pdmnState = state;
+    return dmn;
+}
+
+BOOST_AUTO_TEST_CASE(masternode_connection_order)
+{
+    CConnman connman(0x1337, 0x1337);
+    CDeterministicMNList mnList(uint256(), 1, 6);
+    std::vector<CDeterministicMNCPtr> vMNs;
+    for (int i = 0; i < 6; i++) {
+        vMNs.emplace_back(MakeMasternode(i, LookupNumeric(strprintf("10.0.0.%d", i + 1).c_str(), 8333)));
+        mnList.AddMN(vMNs.back());
+    }
+    const auto addrOf = [&](int i) { return vMNs[i]->pdmnState->addr; };
+
+    // quorum A has an upcoming DKG, quorum B doesn't
+    const uint256 quorumA = InsecureRand256();
+    const uint256 quorumB = InsecureRand256();
+    connman.AddMasternodeQuorumNodes(Consensus::LLMQ_50_60, quorumB, {vMNs[2]->proTxHash, vMNs[3]->proTxHash, vMNs[4]->proTxHash});
+    connman.AddMasternodeQuorumNodes(Consensus::LLMQ_50_60, quorumA, {vMNs[0]->proTxHash, vMNs[1]->proTxHash}, true);
+
+    std::set<CService> connectedNodes;
+    std::set<uint256> connectedProRegTxHashes;
+    bool fMoreWork = false;
+
+    // priority members come first, then the others
+    std::vector<CService> vSelected = connman.SelectMasternodeConnections(mnList, connectedNodes, connectedProRegTxHashes, 10, fMoreWork);
+    BOOST_REQUIRE_EQUAL(vSelected.size(), 5U);
+    BOOST_CHECK(!fMoreWork);
+    BOOST_CHECK(std::set<CService>(vSelected.begin(), vSelected.begin() + 2) == std::set<CService>({addrOf(0), addrOf(1)}));
+    BOOST_CHECK(std::set<CService>(vSelected.begin() + 2, vSelected.end()) == std::set<CService>({addrOf(2), addrOf(3), addrOf(4)}));
+
+    // only as many as requested
+    vSelected = connman.SelectMasternodeConnections(mnList, connectedNodes, connectedProRegTxHashes, 2, fMoreWork);
+    BOOST_CHECK(fMoreWork);
+    BOOST_CHECK(std::set<CService>(vSelected.begin(), vSelected.end()) == std::set<CService>({addrOf(0), addrOf(1)}));
+
+    // connected masternodes are skipped, no matter if they are known by address or by proRegTxHash
+    connectedNodes.emplace(addrOf(0));
+    connectedProRegTxHashes.emplace(vMNs[2]->proTxHash);
+    fMoreWork = false;
+    vSelected = connman.SelectMasternodeConnections(mnList, connectedNodes, connectedProRegTxHashes, 10, fMoreWork);
+    BOOST_REQUIRE_EQUAL(vSelected.size(), 3U);
+    BOOST_CHECK(vSelected[0] == addrOf(1));
+    BOOST_CHECK(std::set<CService>(vSelected.begin() + 1, vSelected.end()) == std::set<CService>({addrOf(3), addrOf(4)}));
+
+    // once all its members are connected, quorum A loses its priority and its members are shuffled with the others
+    connectedNodes.emplace(addrOf(1));
+    vSelected = connman.SelectMasternodeConnections(mnList, connectedNodes, connectedProRegTxHashes, 10, fMoreWork);
+    BOOST_CHECK(std::set<CService>(vSelected.begin(), vSelected.end()) == std::set<CService>({addrOf(3), addrOf(4)}));
+    connectedNodes.clear();
+    connectedProRegTxHashes.clear();
+    bool fQuorumBFirst = false;
+    for (int i = 0; i < 100 && !fQuorumBFirst; i++) {
+        vSelected = connman.SelectMasternodeConnections(mnList, connectedNodes, connectedProRegTxHashes, 10, fMoreWork);
+        BOOST_REQUIRE_EQUAL(vSelected.size(), 5U);
+        fQuorumBFirst = vSelected[0] != addrOf(0) && vSelected[0] != addrOf(1);
+    }
+    BOOST_CHECK(fQuorumBFirst);
+
+    // members of removed quorums are not connected to anymore
+    connman.RemoveMasternodeQuorumNodes(Consensus::LLMQ_50_60, quorumB);
+    vSelected = connman.SelectMasternodeConnections(mnList, connectedNodes, connectedProRegTxHashes, 10, fMoreWork);
+    BOOST_CHECK(std::set<CService>(vSelected.begin(), vSelected.end()) == std::set<CService>({addrOf(0), addrOf(1)}));
+}
+
 // prior to PR #14728, this test triggers an undefined behavior
 BOOST_AUTO_TEST_CASE(ipv4_peer_with_ipv6_addrMe_test)
 {
@@ -0,0 +1,156 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <net.h>
+#include <net_processing.h>
+
+#include <test/setup_common.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(peer_message_pool_tests, BasicTestingSetup)
+
+static std::vector<std::unique_ptr<CNode>> MakeNodes(int nCount)
+{
+    std::vector<std::unique_ptr<CNode>> vNodes;
+    for (int i = 0; i < nCount; i++) {
+        vNodes.emplace_back(new CNode(i, ServiceFlags(NODE_NETWORK), 0, INVALID_SOCKET, CAddress(), 0, 0, CAddress(), "", /*fInboundIn=*/ true));
+    }
+    return vNodes;
+}
+
+static std::list<CNetMessage> MakeMessage(uint32_t nSequence)
+{
+    std::list<CNetMessage> msgs;
+    msgs.emplace_back(Params().MessageStart(), SER_NETWORK, PROTOCOL_VERSION);
+    msgs.back().vRecv << nSequence;
+    return msgs;
+}
+
+BOOST_AUTO_TEST_CASE(per_peer_ordering)
+{
+    const int nNodes = 8;
+    const uint32_t nMessages = 500;
+    auto vNodes = MakeNodes(nNodes);
+
+    // only one job per peer runs at a time, so the per peer vectors are never written concurrently
+    std::vector<std::vector<uint32_t>> vProcessed(nNodes);
+    std::vector<std::atomic<int>> vRunning(nNodes);
+    for (auto& nRunning : vRunning) {
+        nRunning = 0;
+    }
+    std::atomic<int> nOverlaps{0};
+    std::atomic<uint32_t> nTotal{0};
+    std::atomic<int> nIdle{0};
+    CPeerMessagePool pool([&](CNode* pnode, CNetMessage& msg) {
+        const NodeId id = pnode->GetId();
+        if (vRunning[id]++ != 0) {
+            nOverlaps++;
+        }
+        uint32_t nSequence;
+        msg.vRecv >> nSequence;
+        vProcessed[id].push_back(nSequence);
+        vRunning[id]--;
+        nTotal++;
+    }, [&]() { nIdle++; });
+    pool.Start(4, "test-msgproc");
+
+    // messages of all peers are interleaved, in batches of varying size per peer
+    std::vector<uint32_t> vNext(nNodes, 0);
+    uint32_t nQueued = 0;
+    while (nQueued < nNodes * nMessages) {
+        const int id = InsecureRandRange(nNodes);
+        for (uint64_t n = InsecureRandRange(8); n > 0 && vNext[id] < nMessages; n--) {
+            BOOST_CHECK(pool.Enqueue(vNodes[id].get(), MakeMessage(vNext[id]++)));
+            nQueued++;
+        }
+    }
+
+    for (int i = 0; i < 1000 && nTotal < nQueued; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    pool.Stop();
+
+    BOOST_CHECK_EQUAL(nTotal, nQueued);
+    BOOST_CHECK_EQUAL(nOverlaps, 0);
+    BOOST_CHECK(nIdle > 0);
+    for (int id = 0; id < nNodes; id++) {
+        BOOST_REQUIRE_EQUAL(vProcessed[id].size(), nMessages);
+        for (uint32_t i = 0; i < nMessages; i++) {
+            BOOST_CHECK_EQUAL(vProcessed[id][i], i);
+        }
+        BOOST_CHECK_EQUAL(vNodes[id]->GetRefCount(), 0);
+        LOCK(vNodes[id]->cs_vPoolProcessMsg);
+        BOOST_CHECK(!vNodes[id]->fPoolProcessing);
+    }
+
+    // nothing is queued after the pool was stopped
+    BOOST_CHECK(!pool.Enqueue(vNodes[0].get(), MakeMessage(0)));
+    BOOST_CHECK_EQUAL(vNodes[0]->GetRefCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(stop_releases_queued_peers)
+{
+    const int nNodes = 4;
+    auto vNodes = MakeNodes(nNodes);
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool fBlocked = false;
+    bool fUnblock = false;
+    std::atomic<int> nTotal{0};
+    CPeerMessagePool pool([&](CNode* pnode, CNetMessage& msg) {
+        nTotal++;
+        std::unique_lock<std::mutex> lock(mutex);
+        fBlocked = true;
+        cond.notify_all();
+        cond.wait(lock, [&] { return fUnblock; });
+    }, []() {});
+    pool.Start(1, "test-msgproc");
+
+    // the single thread blocks on the first message, everything else stays queued
+    for (int id = 0; id < nNodes; id++) {
+        for (uint32_t i = 0; i < 3; i++) {
+            BOOST_CHECK(pool.Enqueue(vNodes[id].get(), MakeMessage(i)));
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return fBlocked; });
+    }
+    for (int id = 0; id < nNodes; id++) {
+        BOOST_CHECK_EQUAL(vNodes[id]->GetRefCount(), 1);
+    }
+
+    std::thread stopThread([&] { pool.Stop(); });
+    while (!pool.GetInterrupt()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        fUnblock = true;
+        cond.notify_all();
+    }
+    stopThread.join();
+
+    // the remaining messages are dropped, but every peer is released
+    BOOST_CHECK_EQUAL(nTotal, 1);
+    for (int id = 0; id < nNodes; id++) {
+        BOOST_CHECK_EQUAL(vNodes[id]->GetRefCount(), 0);
+        LOCK(vNodes[id]->cs_vPoolProcessMsg);
+        BOOST_CHECK(vNodes[id]->vPoolProcessMsg.empty());
+        BOOST_CHECK(!vNodes[id]->fPoolProcessing);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
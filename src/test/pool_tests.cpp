@@ -0,0 +1,76 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <memusage.h>
+#include <support/allocators/pool.h>
+#include <test/setup_common.h>
+
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(pool_resource_reuse)
+{
+    PoolResource<128, 8> resource(1024);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0U);
+
+    // Freed blocks are handed out again for requests of the same rounded size.
+    void* a = resource.Allocate(20, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    resource.Deallocate(a, 20, 8);
+    BOOST_CHECK(resource.Allocate(24, 8) == a);
+    void* b = resource.Allocate(16, 8);
+    BOOST_CHECK(b != a);
+
+    // Requests larger than the largest block don't use the chunks.
+    void* large = resource.Allocate(256, 8);
+    resource.Deallocate(large, 256, 8);
+
+    // A new chunk is only allocated once the current one is used up.
+    for (int i = 0; i < 1024 / 128; i++) {
+        resource.Allocate(128, 8);
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 1024U);
+}
+
+BOOST_AUTO_TEST_CASE(pool_coins_map)
+{
+    CCoinsMap map;
+    BOOST_CHECK_EQUAL(map.get_allocator().resource()->NumAllocatedChunks(), 0U);
+
+    for (uint32_t i = 0; i < 10000; i++) {
+        map.emplace(std::piecewise_construct, std::forward_as_tuple(InsecureRand256(), i), std::tuple<>());
+    }
+    const size_t nChunks = map.get_allocator().resource()->NumAllocatedChunks();
+    BOOST_CHECK(nChunks > 0);
+    // The memory usage accounts for the chunks of the pool, not per node.
+    BOOST_CHECK(memusage::DynamicUsage(map) >= nChunks * map.get_allocator().resource()->ChunkSizeBytes());
+
+    // Erased nodes are reused rather than growing the pool.
+    std::vector<COutPoint> outpoints;
+    for (const auto& entry : map) {
+        outpoints.push_back(entry.first);
+    }
+    for (const COutPoint& outpoint : outpoints) {
+        map.erase(outpoint);
+    }
+    for (uint32_t i = 0; i < 10000; i++) {
+        map.emplace(std::piecewise_construct, std::forward_as_tuple(InsecureRand256(), i), std::tuple<>());
+    }
+    BOOST_CHECK_EQUAL(map.get_allocator().resource()->NumAllocatedChunks(), nChunks);
+
+    // A moved-from map stays usable and shares the pool with the map it was moved to.
+    CCoinsMap moved(std::move(map));
+    BOOST_CHECK(moved.get_allocator() == map.get_allocator());
+    map.clear();
+    map.emplace(std::piecewise_construct, std::forward_as_tuple(InsecureRand256(), 0), std::tuple<>());
+    BOOST_CHECK_EQUAL(map.size(), 1U);
+    BOOST_CHECK_EQUAL(moved.size(), 10000U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
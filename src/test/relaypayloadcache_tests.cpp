@@ -0,0 +1,96 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <relaypayloadcache.h>
+
+#include <primitives/transaction.h>
+#include <protocol.h>
+#include <version.h>
+
+#include <test/setup_common.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(relaypayloadcache_tests, BasicTestingSetup)
+
+// serializes to 303 bytes
+static const std::vector<unsigned char> OBJ(300, 0x42);
+
+static std::shared_ptr<const CSharedNetPayload> MakePayload(CRelayPayloadCache& cache, const uint256& hash, int nFlags = 0)
+{
+    CSerializedNetMsg msg = cache.Make(PROTOCOL_VERSION, nFlags, NetMsgType::BLOCK, MSG_BLOCK, hash, OBJ);
+    BOOST_CHECK(msg.data.empty());
+    BOOST_REQUIRE(msg.sharedData);
+    BOOST_CHECK_EQUAL(msg.sharedData->data.size(), 303U);
+    return msg.sharedData;
+}
+
+BOOST_AUTO_TEST_CASE(relaypayloadcache_hits)
+{
+    CRelayPayloadCache cache(10, 10000);
+    const uint256 hash1 = InsecureRand256();
+    const uint256 hash2 = InsecureRand256();
+
+    auto payload1 = MakePayload(cache, hash1);
+    BOOST_CHECK(MakePayload(cache, hash1) == payload1);
+    BOOST_CHECK_EQUAL(cache.GetCount(), 1U);
+    BOOST_CHECK_EQUAL(cache.GetBytes(), 303U);
+
+    // other objects and serialization variants are separate entries
+    BOOST_CHECK(MakePayload(cache, hash2) != payload1);
+    auto payloadNoWitness = MakePayload(cache, hash1, SERIALIZE_TRANSACTION_NO_WITNESS);
+    BOOST_CHECK(payloadNoWitness != payload1);
+    BOOST_CHECK(MakePayload(cache, hash1, SERIALIZE_TRANSACTION_NO_WITNESS) == payloadNoWitness);
+    CSerializedNetMsg msg = cache.Make(PROTOCOL_VERSION, 0, NetMsgType::CMPCTBLOCK, MSG_CMPCT_BLOCK, hash1, OBJ);
+    BOOST_CHECK(msg.sharedData != payload1);
+    BOOST_CHECK_EQUAL(cache.GetCount(), 4U);
+    BOOST_CHECK_EQUAL(cache.GetBytes(), 4 * 303U);
+}
+
+BOOST_AUTO_TEST_CASE(relaypayloadcache_eviction)
+{
+    std::vector<uint256> vHashes;
+    for (int i = 0; i < 5; i++) {
+        vHashes.push_back(InsecureRand256());
+    }
+
+    // bounded by size, the least recently used entry is evicted first
+    {
+        CRelayPayloadCache cache(10, 1000);
+        auto payload0 = MakePayload(cache, vHashes[0]);
+        auto payload1 = MakePayload(cache, vHashes[1]);
+        auto payload2 = MakePayload(cache, vHashes[2]);
+        BOOST_CHECK(MakePayload(cache, vHashes[0]) == payload0);
+        MakePayload(cache, vHashes[3]);
+        BOOST_CHECK_EQUAL(cache.GetCount(), 3U);
+        BOOST_CHECK_EQUAL(cache.GetBytes(), 3 * 303U);
+        BOOST_CHECK(MakePayload(cache, vHashes[0]) == payload0);
+        BOOST_CHECK(MakePayload(cache, vHashes[2]) == payload2);
+        BOOST_CHECK(MakePayload(cache, vHashes[1]) != payload1);
+    }
+
+    // bounded by the number of entries
+    {
+        CRelayPayloadCache cache(2, 10000);
+        auto payload0 = MakePayload(cache, vHashes[0]);
+        MakePayload(cache, vHashes[1]);
+        MakePayload(cache, vHashes[2]);
+        BOOST_CHECK_EQUAL(cache.GetCount(), 2U);
+        BOOST_CHECK_EQUAL(cache.GetBytes(), 2 * 303U);
+        BOOST_CHECK(MakePayload(cache, vHashes[0]) != payload0);
+    }
+
+    // payloads larger than the whole cache are not cached
+    {
+        CRelayPayloadCache cache(10, 300);
+        auto payload0 = MakePayload(cache, vHashes[0]);
+        BOOST_CHECK_EQUAL(cache.GetCount(), 0U);
+        BOOST_CHECK_EQUAL(cache.GetBytes(), 0U);
+        BOOST_CHECK(MakePayload(cache, vHashes[0]) != payload0);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <governance/governance-votedb.h>
 #include <init.h>
 #include <miner.h>
 #include <net.h>
@@ -18,6 +19,7 @@
 #include <rpc/register.h>
 #include <rpc/server.h>
 #include <script/sigcache.h>
+#include <special/sigcache.h>
 #include <special/specialdb.h>
 #include <streams.h>
 #include <txdb.h>
@@ -57,7 +59,9 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     SetupNetworking();
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitSpecialTxSigCache();
     fCheckBlockIndex = true;
+    governanceVoteDb.reset(new CGovernanceVoteDB(1 << 20, true, true));
     static bool noui_connected = false;
     if (!noui_connected) {
         noui_connect();
@@ -67,6 +71,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
 
 BasicTestingSetup::~BasicTestingSetup()
 {
+    governanceVoteDb.reset();
     LogInstance().DisconnectTestLogger();
     fs::remove_all(m_path_root);
     ECC_Stop();
@@ -100,6 +105,9 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
     nScriptCheckThreads = 3;
     for (int i = 0; i < nScriptCheckThreads - 1; i++)
         threadGroup.create_thread([i]() { return ThreadScriptCheck(i); });
+    nCoinPrefetchThreads = 2;
+    for (int i = 0; i < nCoinPrefetchThreads; i++)
+        threadGroup.create_thread([i]() { return ThreadCoinPrefetch(i); });
 
     g_banman = MakeUnique<BanMan>(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
     g_connman = MakeUnique<CConnman>(0x1337, 0x1337); // Deterministic randomness for tests.
@@ -0,0 +1,132 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bls/bls.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <hash.h>
+#include <netbase.h>
+#include <special/deterministicmns.h>
+#include <special/providertx.h>
+#include <special/sigcache.h>
+#include <special/specialdb.h>
+#include <special/specialtx.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+struct SpecialTxSigCacheSetup : public TestingSetup {
+    SpecialTxSigCacheSetup()
+    {
+        deterministicMNManager.reset(new CDeterministicMNManager(*pspecialdb));
+        // start with an empty cache
+        InitSpecialTxSigCache();
+    }
+    ~SpecialTxSigCacheSetup() { deterministicMNManager.reset(); }
+};
+
+BOOST_FIXTURE_TEST_SUITE(specialtx_sigcache_tests, SpecialTxSigCacheSetup)
+
+// Store the masternode list of pindex with a single masternode, the way CDeterministicMNManager stores its snapshots
+static void WriteMasternodeList(const CBlockIndex* pindex, const uint256& proTxHash, const CBLSPublicKey& pubKeyOperator)
+{
+    auto state = std::make_shared<CDeterministicMNState>();
+    state->keyIDOwner = CKeyID(uint160(std::vector<unsigned char>(proTxHash.begin(), proTxHash.begin() + 20)));
+    state->pubKeyOperator.Set(pubKeyOperator);
+    auto dmn = std::make_shared<CDeterministicMN>();
+    dmn->proTxHash = proTxHash;
+    dmn->internalId = 0;
+    dmn->collateralOutpoint = COutPoint(proTxHash, 0);
+    dmn->pdmnState = state;
+
+    CDeterministicMNList mnList(pindex->GetBlockHash(), pindex->nHeight, 1);
+    mnList.AddMN(dmn);
+    pspecialdb->Write(std::make_pair(std::string("dmn_S"), pindex->GetBlockHash()), mnList);
+}
+
+static CTransaction MakeProUpServTx(const uint256& proTxHash, const CBLSSecretKey& key)
+{
+    CMutableTransaction tx;
+    tx.nVersion = 2;
+    tx.nType = TRANSACTION_PROVIDER_UPDATE_SERVICE;
+    tx.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+
+    CProUpServTx ptx;
+    ptx.proTxHash = proTxHash;
+    ptx.addr = LookupNumeric("1.2.3.4", Params().GetDefaultPort());
+    ptx.inputsHash = CalcTxInputsHash(CTransaction(tx));
+    ptx.sig = key.Sign(::SerializeHash(ptx));
+    SetTxPayload(tx, ptx);
+    return CTransaction(tx);
+}
+
+// The cache entry CheckProUpServTx looks up for tx when the masternode has the operator key pubKeyOperator
+static uint256 GetCacheEntry(const CTransaction& tx, const CBLSPublicKey& pubKeyOperator)
+{
+    CProUpServTx ptx;
+    BOOST_REQUIRE(GetTxPayload(tx, ptx));
+    const uint256& keyHash = pubKeyOperator.GetHash();
+    const uint256& sigHash = ptx.sig.GetHash();
+    return ComputeSpecialTxSigCacheEntry(tx.GetHash(), ::SerializeHash(ptx), Span<const unsigned char>(keyHash.begin(), keyHash.size()), Span<const unsigned char>(sigHash.begin(), sigHash.size()));
+}
+
+BOOST_AUTO_TEST_CASE(proupservtx_sigcache)
+{
+    const uint256 proTxHash = InsecureRand256();
+    CBLSSecretKey operatorKey, newOperatorKey, otherKey;
+    operatorKey.MakeNewKey();
+    newOperatorKey.MakeNewKey();
+    otherKey.MakeNewKey();
+
+    // the operator key changes from the list of block A to the one of block B
+    const uint256 hashA = InsecureRand256();
+    const uint256 hashB = InsecureRand256();
+    CBlockIndex indexA, indexB;
+    indexA.phashBlock = &hashA;
+    indexA.nHeight = 1;
+    indexB.phashBlock = &hashB;
+    indexB.nHeight = 2;
+    WriteMasternodeList(&indexA, proTxHash, operatorKey.GetPublicKey());
+    WriteMasternodeList(&indexB, proTxHash, newOperatorKey.GetPublicKey());
+
+    CValidationState state;
+    const CTransaction tx = MakeProUpServTx(proTxHash, operatorKey);
+    const uint256 entry = GetCacheEntry(tx, operatorKey.GetPublicKey());
+
+    // Lookup only checks neither add nor release entries
+    BOOST_CHECK(CheckProUpServTx(tx, &indexA, state, SpecialTxSigCacheMode::LOOKUP));
+    BOOST_CHECK(!GetSpecialTxSigCache(entry, false));
+    BOOST_CHECK(CheckProUpServTx(tx, &indexA, state, SpecialTxSigCacheMode::STORE));
+    BOOST_CHECK(GetSpecialTxSigCache(entry, false));
+
+    // A signature is only checked against the key which signed it, a changed operator key misses the cache
+    BOOST_CHECK(!CheckProUpServTx(tx, &indexB, state, SpecialTxSigCacheMode::RELEASE));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-protx-sig");
+
+    // Block connection trusts cached signatures: a transaction signed with the wrong key passes if its entry is cached
+    const CTransaction txBadSig = MakeProUpServTx(proTxHash, otherKey);
+    state = CValidationState();
+    BOOST_CHECK(!CheckProUpServTx(txBadSig, &indexA, state, SpecialTxSigCacheMode::LOOKUP));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-protx-sig");
+    const uint256 entryBadSig = GetCacheEntry(txBadSig, operatorKey.GetPublicKey());
+    SetSpecialTxSigCache(entryBadSig);
+    state = CValidationState();
+    BOOST_CHECK(CheckProUpServTx(txBadSig, &indexA, state, SpecialTxSigCacheMode::LOOKUP));
+    BOOST_CHECK(CheckProUpServTx(txBadSig, &indexA, state, SpecialTxSigCacheMode::RELEASE));
+
+    // The entry was released by block connection, so it is overwritten by the next entries (filling the cache twice
+    // over, see InitSpecialTxSigCache)
+    const size_t nFill = 2 * (((size_t)DEFAULT_MAX_SPECIALTX_SIG_CACHE_SIZE << 20) / sizeof(uint256));
+    for (size_t i = 0; i < nFill; i++) {
+        SetSpecialTxSigCache(InsecureRand256());
+    }
+    BOOST_CHECK(!GetSpecialTxSigCache(entryBadSig, false));
+    state = CValidationState();
+    BOOST_CHECK(!CheckProUpServTx(txBadSig, &indexA, state, SpecialTxSigCacheMode::LOOKUP));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-protx-sig");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
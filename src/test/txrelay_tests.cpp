@@ -0,0 +1,105 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <txmempool.h>
+#include <txrelay.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txrelay_tests, BasicTestingSetup)
+
+static CTransactionRef MakeTx(const COutPoint& prevout)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = prevout;
+    tx.vin[0].scriptSig = CScript() << OP_11;
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx.vout[0].nValue = 10 * COIN;
+    return MakeTransactionRef(tx);
+}
+
+static std::vector<uint256> Announce(const CTxRelayQueue& queue, uint64_t& nCursor, size_t nMax, CAmount nMinFeePerK = 0)
+{
+    std::vector<uint256> vHashes;
+    queue.ForEachFrom(nCursor, nMax, [&](const CTxRelayQueue::Entry& entry) {
+        if (entry.nFeePerK < nMinFeePerK) {
+            return false;
+        }
+        vHashes.push_back(entry.hash);
+        return true;
+    });
+    return vHashes;
+}
+
+BOOST_AUTO_TEST_CASE(txrelay_epochs)
+{
+    CTxMemPool pool;
+    CTxRelayQueue queue;
+    TestMemPoolEntryHelper entry;
+
+    // parent with a low fee, its child and an unrelated transaction with a high fee
+    CTransactionRef txParent = MakeTx(COutPoint(InsecureRand256(), 0));
+    CTransactionRef txChild = MakeTx(COutPoint(txParent->GetHash(), 0));
+    CTransactionRef txHighFee = MakeTx(COutPoint(InsecureRand256(), 0));
+    CTransactionRef txNotInMempool = MakeTx(COutPoint(InsecureRand256(), 0));
+    {
+        LOCK2(cs_main, pool.cs);
+        pool.addUnchecked(entry.Fee(1000).FromTx(txParent));
+        pool.addUnchecked(entry.Fee(100000).FromTx(txChild));
+        pool.addUnchecked(entry.Fee(100000).FromTx(txHighFee));
+    }
+
+    uint64_t nCursorEarly = queue.GetEndSequence();
+
+    // relayed in reverse order and twice, sealing orders and deduplicates them
+    queue.Add(txHighFee->GetHash());
+    queue.Add(txChild->GetHash());
+    queue.Add(txNotInMempool->GetHash());
+    queue.Add(txParent->GetHash());
+    queue.Add(txChild->GetHash());
+    BOOST_CHECK_EQUAL(queue.GetPendingCount(), 5U);
+    queue.SealEpoch(pool, 1000);
+    BOOST_CHECK_EQUAL(queue.GetPendingCount(), 0U);
+    BOOST_CHECK_EQUAL(queue.GetLogSize(), 3U);
+
+    uint64_t nCursorLate = queue.GetEndSequence();
+    BOOST_CHECK(Announce(queue, nCursorLate, 100).empty());
+
+    // parents are announced before children, otherwise by fee rate
+    uint64_t nCursor = nCursorEarly;
+    std::vector<uint256> vExpected{txHighFee->GetHash(), txParent->GetHash(), txChild->GetHash()};
+    BOOST_CHECK(Announce(queue, nCursor, 100) == vExpected);
+    BOOST_CHECK_EQUAL(nCursor, queue.GetEndSequence());
+
+    // the per peer limit leaves the rest for the next trickle
+    nCursor = nCursorEarly;
+    BOOST_CHECK(Announce(queue, nCursor, 2) == std::vector<uint256>(vExpected.begin(), vExpected.begin() + 2));
+    BOOST_CHECK(Announce(queue, nCursor, 2) == std::vector<uint256>(vExpected.begin() + 2, vExpected.end()));
+
+    // filtered entries don't count towards the limit
+    nCursor = nCursorEarly;
+    BOOST_CHECK(Announce(queue, nCursor, 2, 50000) == std::vector<uint256>({txHighFee->GetHash(), txChild->GetHash()}));
+
+    // removed entries are not announced anymore but still served for getdata
+    BOOST_CHECK(queue.Find(txNotInMempool->GetHash()) == nullptr);
+    queue.Remove({txHighFee});
+    nCursor = nCursorEarly;
+    BOOST_CHECK(Announce(queue, nCursor, 100) == std::vector<uint256>({txParent->GetHash(), txChild->GetHash()}));
+    BOOST_CHECK(queue.Find(txHighFee->GetHash()) == txHighFee);
+
+    // entries expire, peers which were behind continue at the start of the log
+    queue.Add(txHighFee->GetHash());
+    queue.SealEpoch(pool, 1000 + TX_RELAY_EXPIRY_MICROS + 1);
+    BOOST_CHECK_EQUAL(queue.GetLogSize(), 1U);
+    BOOST_CHECK(queue.Find(txParent->GetHash()) == nullptr);
+    BOOST_CHECK(queue.Find(txHighFee->GetHash()) == txHighFee);
+    nCursor = nCursorEarly;
+    BOOST_CHECK(Announce(queue, nCursor, 100) == std::vector<uint256>({txHighFee->GetHash()}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -334,4 +334,93 @@ BOOST_AUTO_TEST_CASE(mempool_locks_reorg)
         rpc_thread.join();
     }
 }
+BOOST_AUTO_TEST_CASE(processnewblockheaders_invalid_header_in_batch)
+{
+    std::vector<CBlockHeader> headers;
+    uint256 hashPrev = Params().GenesisBlock().GetHash();
+    for (int i = 0; i < 20; i++) {
+        auto pblock = GoodBlock(hashPrev);
+        headers.push_back(pblock->GetBlockHeader());
+        hashPrev = pblock->GetHash();
+    }
+
+    // a header in the middle of the batch doesn't carry the required difficulty
+    headers[10].nBits ^= 1;
+
+    CValidationState state;
+    CBlockHeader first_invalid;
+    BOOST_CHECK(!ProcessNewBlockHeaders(headers, state, Params(), nullptr, &first_invalid));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-diffbits");
+    BOOST_CHECK(first_invalid.GetHash() == headers[10].GetHash());
+
+    LOCK(cs_main);
+    for (size_t i = 0; i < headers.size(); i++) {
+        BOOST_CHECK_EQUAL(LookupBlockIndex(headers[i].GetHash()) != nullptr, i < 10);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(invalid_pending_block_restores_tip)
+{
+    bool ignored;
+    auto ProcessBlock = [&ignored](std::shared_ptr<const CBlock> block) -> bool {
+        return ProcessNewBlock(Params(), block, /* fForceProcessing */ true, /* fNewBlock */ &ignored);
+    };
+
+    BOOST_REQUIRE(ProcessBlock(std::make_shared<CBlock>(Params().GenesisBlock())));
+    auto funding = GoodBlock(Params().GenesisBlock().GetHash());
+    BOOST_REQUIRE(ProcessBlock(funding));
+    auto last_mined = funding;
+    for (int j = COINBASE_MATURITY; j > 0; --j) {
+        last_mined = GoodBlock(last_mined->GetHash());
+        BOOST_REQUIRE(ProcessBlock(last_mined));
+    }
+    const uint256 tip_init{last_mined->GetHash()};
+
+    // The script checks of a block only stay pending during initial block download
+    BOOST_REQUIRE(nScriptCheckThreads);
+    BOOST_REQUIRE(::ChainstateActive().IsInitialBlockDownload());
+
+    // A block whose only flaw is a witness script not matching the spent P2WSH output, so it fails on the script
+    // check threads only, followed by two valid blocks
+    CMutableTransaction mtx;
+    mtx.vin.push_back(CTxIn{COutPoint{funding->vtx[0]->GetHash(), 1}, CScript{}});
+    mtx.vin[0].scriptWitness.stack.push_back(std::vector<unsigned char>{OP_FALSE});
+    mtx.vout.push_back(funding->vtx[0]->vout[1]);
+    mtx.vout[0].nValue -= 1000;
+    auto pblockBad = Block(tip_init);
+    pblockBad->vtx.push_back(MakeTransactionRef(mtx));
+    std::vector<std::shared_ptr<const CBlock>> chain{FinalizeBlock(pblockBad)};
+    for (int j = 0; j < 2; j++) {
+        chain.push_back(GoodBlock(chain.back()->GetHash()));
+    }
+
+    // Hold back the invalid block, so that all three are connected in one go with the first one pending
+    std::vector<CBlockHeader> headers;
+    for (const auto& pblock : chain) {
+        headers.push_back(pblock->GetBlockHeader());
+    }
+    CValidationState state;
+    BOOST_REQUIRE(ProcessNewBlockHeaders(headers, state, Params()));
+    BOOST_CHECK(ProcessBlock(chain[2]));
+    BOOST_CHECK(ProcessBlock(chain[1]));
+    BOOST_CHECK_EQUAL(::ChainActive().Tip()->GetBlockHash(), tip_init);
+    ProcessBlock(chain[0]);
+
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(::ChainActive().Tip()->GetBlockHash(), tip_init);
+        BOOST_CHECK(LookupBlockIndex(chain[0]->GetHash())->nStatus & BLOCK_FAILED_VALID);
+        const auto& candidates = ::ChainstateActive().setBlockIndexCandidates;
+        BOOST_CHECK(candidates.count(::ChainActive().Tip()));
+        for (const CBlockIndex* pindex : candidates) {
+            BOOST_CHECK(pindex->IsValid(BLOCK_VALID_TRANSACTIONS));
+        }
+    }
+
+    // The chain keeps growing on the restored tip
+    last_mined = GoodBlock(tip_init);
+    BOOST_REQUIRE(ProcessBlock(last_mined));
+    BOOST_CHECK_EQUAL(::ChainActive().Tip()->GetBlockHash(), last_mined->GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
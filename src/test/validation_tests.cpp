@@ -74,4 +74,24 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+BOOST_AUTO_TEST_CASE(block_header_hashes)
+{
+    for (size_t nCount : {(size_t)256, (size_t)1}) {
+        std::vector<CBlockHeader> headers(nCount);
+        for (size_t i = 0; i < nCount; i++) {
+            headers[i].nVersion = 1;
+            headers[i].hashPrevBlock = i ? headers[i - 1].GetHash() : Params().GenesisBlock().GetHash();
+            headers[i].nTime = i;
+            headers[i].nNonce = i;
+        }
+
+        std::vector<uint256> hashes;
+        GetBlockHeaderHashes(headers, hashes);
+        BOOST_REQUIRE_EQUAL(hashes.size(), nCount);
+        for (size_t i = 0; i < nCount; i++) {
+            BOOST_CHECK(hashes[i] == headers[i].GetHash());
+        }
+    }
+}
 BOOST_AUTO_TEST_SUITE_END()
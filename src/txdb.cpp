@@ -12,9 +12,12 @@
 #include <shutdown.h>
 #include <ui_interface.h>
 #include <uint256.h>
+#include <util/memory.h>
 #include <util/system.h>
+#include <util/time.h>
 #include <util/translation.h>
 
+#include <functional>
 #include <stdint.h>
 
 #include <boost/thread.hpp>
@@ -31,11 +34,11 @@ static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
-//! insight slices
-static const char DB_ADDRESSINDEX = 'a';
-static const char DB_ADDRESSUNSPENTINDEX = 'u';
-static const char DB_TIMESTAMPINDEX = 's';
-static const char DB_SPENTINDEX = 'P';
+//! insight slices written by previous versions, see EraseLegacyIndexes
+static const char DB_LEGACY_ADDRESSINDEX = 'a';
+static const char DB_LEGACY_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_LEGACY_TIMESTAMPINDEX = 's';
+static const char DB_LEGACY_SPENTINDEX = 'P';
 
 namespace {
 
@@ -89,11 +92,11 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    return BeginBatchWrite(hashBlock) && WriteCoins(mapCoins, hashBlock, true);
+}
+
+bool CCoinsViewDB::BeginBatchWrite(const uint256 &hashBlock) {
     CDBBatch batch(db);
-    size_t count = 0;
-    size_t changed = 0;
-    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
-    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
     assert(!hashBlock.IsNull());
 
     uint256 old_tip = GetBestBlock();
@@ -112,6 +115,15 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     // interrupting after partial writes from multiple independent reorgs.
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
+    return db.WriteBatch(batch);
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fErase) {
+    CDBBatch batch(db);
+    size_t count = 0;
+    size_t changed = 0;
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
 
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
@@ -123,8 +135,12 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (fErase) {
+            CCoinsMap::iterator itOld = it++;
+            mapCoins.erase(itOld);
+        } else {
+            ++it;
+        }
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -154,6 +170,128 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
+CCoinsViewBackgroundFlush::CCoinsViewBackgroundFlush(CCoinsView* base, CCoinsViewDB* db) :
+    CCoinsViewBacked(base), m_db(db)
+{
+    m_thread_flush = std::thread(&TraceThread<std::function<void()>>, "coinsflush",
+                                 std::bind(&CCoinsViewBackgroundFlush::ThreadFlush, this));
+}
+
+CCoinsViewBackgroundFlush::~CCoinsViewBackgroundFlush()
+{
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    m_thread_flush.join();
+}
+
+void CCoinsViewBackgroundFlush::ThreadFlush()
+{
+    while (true) {
+        uint256 hashBlock;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return m_stop || (m_writing && !m_write_failed); });
+            if (!m_writing || m_write_failed) {
+                return;
+            }
+            hashBlock = m_snapshot_block;
+        }
+
+        int64_t nStart = GetTimeMillis();
+        bool fWritten = false;
+        try {
+            fWritten = m_db->WriteCoins(*m_snapshot, hashBlock, false);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        LogPrint(BCLog::COINDB, "Background flush of %u entries for block %s took %dms\n",
+                 m_snapshot->size(), hashBlock.ToString(), GetTimeMillis() - nStart);
+
+        // Free the snapshot outside of the lock, lookups are answered from the database from here on
+        std::unique_ptr<CCoinsMap> written;
+        {
+            LOCK(m_mutex);
+            if (fWritten) {
+                written = std::move(m_snapshot);
+                m_writing = false;
+            } else {
+                m_write_failed = true;
+            }
+        }
+        m_cond.notify_all();
+    }
+}
+
+bool CCoinsViewBackgroundFlush::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    {
+        LOCK(m_mutex);
+        if (m_writing) {
+            CCoinsMap::const_iterator it = m_snapshot->find(outpoint);
+            if (it != m_snapshot->end()) {
+                coin = it->second.coin;
+                return !coin.IsSpent();
+            }
+        }
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewBackgroundFlush::HaveCoin(const COutPoint &outpoint) const
+{
+    Coin coin;
+    return GetCoin(outpoint, coin);
+}
+
+uint256 CCoinsViewBackgroundFlush::GetBestBlock() const
+{
+    {
+        LOCK(m_mutex);
+        if (m_writing) {
+            return m_snapshot_block;
+        }
+    }
+    return base->GetBestBlock();
+}
+
+bool CCoinsViewBackgroundFlush::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    if (!Sync()) {
+        return false;
+    }
+    // Marking the transition synchronously keeps the database consistent with what is committed after the flush
+    // returns (e.g. the special transactions database): after a crash the database is rolled forward to hashBlock.
+    if (!m_db->BeginBatchWrite(hashBlock)) {
+        return false;
+    }
+    {
+        LOCK(m_mutex);
+        // The moved-from map shares its pool with the snapshot, the cache replaces it by a map with a new pool
+        // after BatchWrite, so that only the flush thread frees into the old pool
+        m_snapshot = MakeUnique<CCoinsMap>(std::move(mapCoins));
+        m_snapshot_block = hashBlock;
+        m_writing = true;
+    }
+    m_cond.notify_all();
+    return true;
+}
+
+CCoinsViewCursor *CCoinsViewBackgroundFlush::Cursor() const
+{
+    Sync();
+    return base->Cursor();
+}
+
+bool CCoinsViewBackgroundFlush::Sync() const
+{
+    WAIT_LOCK(m_mutex, lock);
+    m_cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return !m_writing || m_write_failed; });
+    return !m_write_failed;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe), mapHasTxIndexCache(10000, 20000) {
 }
 
@@ -261,143 +399,73 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return ret;
 }
 
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(std::make_pair(DB_SPENTINDEX, key), value);
-}
-
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
+bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
+    return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
 
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
+bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
+    char ch;
+    if (!Read(std::make_pair(DB_FLAG, name), ch))
+        return false;
+    fValue = ch == '1';
+    return true;
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
-                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
-
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
-
-    while (pcursor->Valid()) {
+/** Erase all entries of one legacy index slice, in batches of at most 16 MiB. */
+template <typename K>
+static bool EraseLegacyIndex(CDBWrapper& db, char prefix)
+{
+    const size_t batch_size = 1 << 24; // 16 MiB
+    CDBBatch batch(db);
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    std::pair<char, K> key;
+    for (pcursor->Seek(prefix); pcursor->Valid(); pcursor->Next()) {
         boost::this_thread::interruption_point();
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
-            }
-        } else {
+        if (!pcursor->GetKey(key) || key.first != prefix) {
             break;
         }
-    }
-
-    return true;
-}
-
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
-
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    if (start > 0 && end > 0) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
-    } else {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
-    }
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash) {
-            if (end > 0 && key.second.blockHeight > end) {
-                break;
-            }
-            CAmount nValue;
-            if (pcursor->GetValue(nValue)) {
-                addressIndex.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address index value");
+        batch.Erase(key);
+        if (batch.SizeEstimate() > batch_size) {
+            if (!db.WriteBatch(batch)) {
+                return false;
             }
-        } else {
-            break;
+            batch.Clear();
         }
     }
-
+    if (!db.WriteBatch(batch)) {
+        return false;
+    }
+    db.CompactRange(prefix, (char)(prefix + 1));
     return true;
 }
 
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes) {
-
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
-
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, CTimestampIndexKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp <= high) {
-            hashes.push_back(key.second.blockHash);
-            pcursor->Next();
-        } else {
-            break;
+bool CBlockTreeDB::EraseLegacyIndexes()
+{
+    bool fLegacy = false;
+    for (const char* name : {"addressindex", "timestampindex", "spentindex"}) {
+        bool fValue = false;
+        if (ReadFlag(name, fValue) && fValue) {
+            fLegacy = true;
         }
     }
+    if (!fLegacy) {
+        return true;
+    }
 
-    return true;
-}
-
-bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
-    return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
-}
-
-bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
-    char ch;
-    if (!Read(std::make_pair(DB_FLAG, name), ch))
-        return false;
-    fValue = ch == '1';
+    // Clear the flags first, so that a downgraded node sees the indexes as disabled instead of incomplete
+    LogPrintf("Removing address, timestamp and spent index data of previous versions...\n");
+    for (const char* name : {"addressindex", "timestampindex", "spentindex"}) {
+        if (!WriteFlag(name, false)) {
+            return error("%s: cannot write block index db flag", __func__);
+        }
+    }
+    if (!EraseLegacyIndex<CAddressIndexKey>(*this, DB_LEGACY_ADDRESSINDEX) ||
+        !EraseLegacyIndex<CAddressUnspentKey>(*this, DB_LEGACY_ADDRESSUNSPENTINDEX) ||
+        !EraseLegacyIndex<CTimestampIndexKey>(*this, DB_LEGACY_TIMESTAMPINDEX) ||
+        !EraseLegacyIndex<CSpentIndexKey>(*this, DB_LEGACY_SPENTINDEX)) {
+        return error("%s: cannot erase legacy index entries", __func__);
+    }
+    LogPrintf("Removing address, timestamp and spent index data of previous versions... [DONE]\n");
     return true;
 }
 
@@ -13,10 +13,13 @@
 #include <index/txindex.h>
 #include <primitives/block.h>
 #include <spentindex.h>
+#include <sync.h>
 
+#include <condition_variable>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -62,6 +65,12 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    //! First step of BatchWrite: mark the database as being in transition to hashBlock (see ReplayBlocks).
+    bool BeginBatchWrite(const uint256 &hashBlock);
+    //! Second step of BatchWrite: write the dirty entries of mapCoins and mark the database as consistent with
+    //! hashBlock. If fErase is false, the entries are left in mapCoins so that other threads can keep reading them.
+    bool WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool fErase);
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
@@ -89,6 +98,53 @@ private:
     friend class CCoinsViewDB;
 };
 
+/**
+ * CCoinsView between the coins tip cache and the coin database which writes flushes on a background thread.
+ *
+ * BatchWrite marks the database as being in transition to the new best block, takes over the flushed entries as a
+ * frozen snapshot and returns, so that validation continues on the emptied cache while the snapshot is written.
+ * Lookups are answered from the snapshot until it is written completely. Only one snapshot is written at a time, a
+ * flush waits for the previous one. If the node stops during a write, ReplayBlocks rolls the database forward on the
+ * next start, as after an interrupted synchronous flush.
+ *
+ * Lookups are safe from several threads, but must not run concurrently with BatchWrite.
+ */
+class CCoinsViewBackgroundFlush final : public CCoinsViewBacked
+{
+private:
+    CCoinsViewDB* const m_db;
+
+    mutable Mutex m_mutex;
+    mutable std::condition_variable m_cond;
+    //! The entries being written, set while m_writing is. Not modified while it is set, so the flush thread reads it
+    //! without m_mutex.
+    std::unique_ptr<CCoinsMap> m_snapshot;
+    uint256 m_snapshot_block GUARDED_BY(m_mutex);
+    bool m_writing GUARDED_BY(m_mutex){false};
+    bool m_write_failed GUARDED_BY(m_mutex){false};
+    bool m_stop GUARDED_BY(m_mutex){false};
+
+    std::thread m_thread_flush;
+
+    void ThreadFlush();
+
+public:
+    //! base is read from for coins which are not in the snapshot, db is written to. base must be backed by db.
+    CCoinsViewBackgroundFlush(CCoinsView* base, CCoinsViewDB* db);
+    //! Finishes the pending write, if any.
+    ~CCoinsViewBackgroundFlush();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    //! The cursor iterates the database, so it waits for the pending write.
+    CCoinsViewCursor *Cursor() const override;
+
+    //! Wait until the pending write, if any, is complete. Returns false if it failed.
+    bool Sync() const;
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
@@ -113,18 +169,10 @@ public:
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    //! Remove the address, timestamp and spent index entries which previous versions stored in this database
+    bool EraseLegacyIndexes();
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 
-    //! insight indexes
-    bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
-    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
-    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
-    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
-    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool ReadAddressIndex(uint160 addressHash, int type, std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start = 0, int end = 0);
-    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
-    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
 };
 
 #endif // BITGREEN_TXDB_H
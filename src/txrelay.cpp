@@ -0,0 +1,108 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <txrelay.h>
+
+#include <txmempool.h>
+
+#include <algorithm>
+
+CTxRelayQueue txRelayQueue;
+
+void CTxRelayQueue::Add(const uint256& txid)
+{
+    LOCK(cs);
+    vPending.emplace_back(txid);
+}
+
+void CTxRelayQueue::SealEpoch(CTxMemPool& pool, int64_t nNow)
+{
+    LOCK(cs_seal);
+
+    std::vector<uint256> vHashes;
+    {
+        LOCK(cs);
+        while (!vEntries.empty() && vEntries.front().nExpire < nNow) {
+            const Entry& entry = vEntries.front();
+            auto it = mapSequenceByHash.find(entry.hash);
+            if (it != mapSequenceByHash.end() && it->second == entry.nSequence) {
+                mapSequenceByHash.erase(it);
+            }
+            vEntries.pop_front();
+            nFirstSequence++;
+        }
+        vHashes.swap(vPending);
+    }
+    if (vHashes.empty()) {
+        return;
+    }
+
+    std::sort(vHashes.begin(), vHashes.end());
+    vHashes.erase(std::unique(vHashes.begin(), vHashes.end()), vHashes.end());
+
+    std::vector<Entry> vNewEntries;
+    vNewEntries.reserve(vHashes.size());
+    {
+        LOCK(pool.cs);
+        for (const uint256& hash : vHashes) {
+            auto txinfo = pool.info(hash);
+            // Not in the mempool anymore? don't bother announcing it
+            if (!txinfo.tx) {
+                continue;
+            }
+            vNewEntries.push_back(Entry{0, hash, std::move(txinfo.tx), txinfo.feeRate.GetFeePerK(), nNow + TX_RELAY_EXPIRY_MICROS, false});
+        }
+        // Topologically and fee-rate sort the epoch for privacy and priority reasons
+        std::sort(vNewEntries.begin(), vNewEntries.end(), [&pool](const Entry& a, const Entry& b) {
+            return pool.CompareDepthAndScore(a.hash, b.hash);
+        });
+    }
+
+    LOCK(cs);
+    for (auto& entry : vNewEntries) {
+        entry.nSequence = nFirstSequence + vEntries.size();
+        mapSequenceByHash[entry.hash] = entry.nSequence;
+        vEntries.emplace_back(std::move(entry));
+    }
+}
+
+uint64_t CTxRelayQueue::GetEndSequence() const
+{
+    LOCK(cs);
+    return nFirstSequence + vEntries.size();
+}
+
+CTransactionRef CTxRelayQueue::Find(const uint256& txid) const
+{
+    LOCK(cs);
+    auto it = mapSequenceByHash.find(txid);
+    if (it == mapSequenceByHash.end()) {
+        return nullptr;
+    }
+    return vEntries[it->second - nFirstSequence].tx;
+}
+
+void CTxRelayQueue::Remove(const std::vector<CTransactionRef>& vtx)
+{
+    LOCK(cs);
+    for (const auto& tx : vtx) {
+        auto it = mapSequenceByHash.find(tx->GetHash());
+        if (it == mapSequenceByHash.end()) {
+            continue;
+        }
+        vEntries[it->second - nFirstSequence].fRemoved = true;
+    }
+}
+
+size_t CTxRelayQueue::GetPendingCount() const
+{
+    LOCK(cs);
+    return vPending.size();
+}
+
+size_t CTxRelayQueue::GetLogSize() const
+{
+    LOCK(cs);
+    return vEntries.size();
+}
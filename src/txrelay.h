@@ -0,0 +1,102 @@
+// Copyright (c) 2020 The BitGreen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITGREEN_TXRELAY_H
+#define BITGREEN_TXRELAY_H
+
+#include <amount.h>
+#include <primitives/transaction.h>
+#include <saltedhasher.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+class CTxMemPool;
+
+/** How long transactions are kept for announcement and getdata after they were sealed into an epoch */
+static const int64_t TX_RELAY_EXPIRY_MICROS = 15 * 60 * 1000000LL;
+
+/**
+ * Shared, ordered log of transactions to announce to peers.
+ *
+ * Transactions to relay are collected in a pending set. When a peer is due for a trickle, the pending set is
+ * sealed into a new relay epoch: the transactions are looked up in the mempool once and ordered topologically and
+ * by fee rate (the order previously computed per peer and trickle), then appended to the log with increasing
+ * sequence numbers. Each peer only keeps a cursor into the log and applies its own filters while walking it, so a
+ * trickle costs O(transactions announced) instead of O(transactions * log(transactions)) per peer.
+ *
+ * The log also replaces the relay map used to answer getdata requests for recently announced transactions.
+ */
+class CTxRelayQueue
+{
+public:
+    struct Entry {
+        uint64_t nSequence;
+        uint256 hash;
+        CTransactionRef tx;
+        CAmount nFeePerK;
+        int64_t nExpire;
+        // Removed entries are not announced anymore, but still served to peers which already got the announcement
+        bool fRemoved;
+    };
+
+private:
+    mutable CCriticalSection cs;
+    // Serializes SealEpoch, so that epochs are appended in the order they were sealed
+    CCriticalSection cs_seal;
+
+    std::vector<uint256> vPending GUARDED_BY(cs);
+    std::deque<Entry> vEntries GUARDED_BY(cs);
+    // Sequence number of the first entry in vEntries
+    uint64_t nFirstSequence GUARDED_BY(cs){0};
+    // For getdata: the latest entry of each transaction in the log
+    std::unordered_map<uint256, uint64_t, StaticSaltedHasher> mapSequenceByHash GUARDED_BY(cs);
+
+public:
+    /** Queue a transaction which is (or was just added) in the mempool for announcement to all peers */
+    void Add(const uint256& txid);
+
+    /** Seal all pending transactions into a new epoch and expire old entries */
+    void SealEpoch(CTxMemPool& pool, int64_t nNow);
+
+    /** Sequence number the next sealed transaction will get. New peers start announcing from here */
+    uint64_t GetEndSequence() const;
+
+    /** Get a recently announced transaction to answer a getdata request */
+    CTransactionRef Find(const uint256& txid) const;
+
+    /** Stop announcing the given transactions, e.g. because they were included in a block */
+    void Remove(const std::vector<CTransactionRef>& vtx);
+
+    /**
+     * Walk the log from nCursor and call func for each entry until it returned true for nMax entries. nCursor is
+     * advanced past the last visited entry. Entries which were expired before the peer got to them are skipped.
+     */
+    template <typename Callable>
+    void ForEachFrom(uint64_t& nCursor, size_t nMax, Callable&& func) const
+    {
+        LOCK(cs);
+        if (nCursor < nFirstSequence) {
+            nCursor = nFirstSequence;
+        }
+        size_t nCount = 0;
+        for (size_t i = nCursor - nFirstSequence; i < vEntries.size() && nCount < nMax; i++) {
+            const Entry& entry = vEntries[i];
+            nCursor = entry.nSequence + 1;
+            if (!entry.fRemoved && func(entry)) {
+                nCount++;
+            }
+        }
+    }
+
+    size_t GetPendingCount() const;
+    size_t GetLogSize() const;
+};
+
+extern CTxRelayQueue txRelayQueue;
+
+#endif // BITGREEN_TXRELAY_H
@@ -17,6 +17,9 @@
 #include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
+#include <index/timestampindex.h>
 #include <index/txindex.h>
 #include <llmq/quorums_chainlocks.h>
 #include <llmq/quorums_instantsend.h>
@@ -31,6 +34,7 @@
 #include <primitives/transaction.h>
 #include <random.h>
 #include <reverse_iterator.h>
+#include <saltedhasher.h>
 #include <script/script.h>
 #include <script/sigcache.h>
 #include <script/standard.h>
@@ -57,6 +61,7 @@
 #include <future>
 #include <sstream>
 #include <string>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -115,6 +120,7 @@ Mutex g_best_block_mutex;
 std::condition_variable g_best_block_cv;
 uint256 g_best_block;
 int nScriptCheckThreads = 0;
+int nCoinPrefetchThreads = 0;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fTxIndex = true;
@@ -187,6 +193,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 std::unique_ptr<CCoinsViewDB> pcoinsdbview;
+std::unique_ptr<CCoinsViewBackgroundFlush> pcoinsflusher;
 std::unique_ptr<CCoinsViewCache> pcoinsTip;
 std::unique_ptr<CBlockTreeDB> pblocktree;
 
@@ -798,7 +805,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         // check special TXs after all the other checks. If we'd do this before the other checks, we might end up
         // DoS scoring a node for non-critical errors, e.g. duplicate keys because a TX is received that was already
         // mined
-        if (!CheckSpecialTx(tx, ChainActive().Tip(), state))
+        if (!CheckSpecialTx(tx, ChainActive().Tip(), state, SpecialTxSigCacheMode::STORE))
             return false;
 
         if (pool.existsProviderTxConflict(tx))
@@ -932,7 +939,7 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::v
     if (!fTimestampIndex)
         return error("Timestamp index not enabled");
 
-    if (!pblocktree->ReadTimestampIndex(high, low, hashes))
+    if (!g_timestampindex || !g_timestampindex->FindBlockHashes(high, low, hashes))
         return error("Unable to get hashes for timestamps");
 
     return true;
@@ -946,7 +953,7 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     if (mempool.getSpentIndex(key, value))
         return true;
 
-    if (!pblocktree->ReadSpentIndex(key, value))
+    if (!g_spentindex || !g_spentindex->FindSpentIndex(key, value))
         return false;
 
     return true;
@@ -958,7 +965,7 @@ bool GetAddressIndex(uint160 addressHash, int type,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!g_addressindex || !g_addressindex->FindAddressIndex(addressHash, type, addressIndex, start, end))
         return error("unable to get txids for address");
 
     return true;
@@ -970,12 +977,23 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+    if (!g_addressindex || !g_addressindex->FindAddressUnspent(addressHash, type, unspentOutputs))
         return error("unable to get txids for address");
 
     return true;
 }
 
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!g_addressindex || !g_addressindex->FindAddressBalance(addressHash, type, value))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
 
 /**
  * Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock.
@@ -1630,10 +1648,6 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         return DISCONNECT_FAILED;
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
-
     if (!UndoSpecialTxsInBlock(block, pindex))
         return DISCONNECT_FAILED;
 
@@ -1644,41 +1658,6 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         bool is_coinbase = tx.IsCoinBase();
         bool is_coinstake = tx.IsCoinStake();
 
-        if (fAddressIndex) {
-
-            for (unsigned int k = tx.vout.size(); k-- > 0;) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, k, false), out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, k), CAddressUnspentValue()));
-                } else {
-                    continue;
-                }
-
-            }
-
-        }
-
         // Check that all outputs are available and match the outputs in the block itself
         // exactly.
         for (size_t o = 0; o < tx.vout.size(); o++) {
@@ -1702,49 +1681,9 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
 
             for (unsigned int j = tx.vin.size(); j-- > 0;) {
                 const COutPoint &out = tx.vin[j].prevout;
-                int undoHeight = txundo.vprevout[j].nHeight;
                 int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out);
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
-
-                const CTxIn input = tx.vin[j];
-
-                if (fSpentIndex) {
-                    // undo and delete the spent index
-                    spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue()));
-                }
-
-                if (fAddressIndex) {
-                    const Coin &coin = view.AccessCoin(tx.vin[j].prevout);
-                    const CTxOut &prevout = coin.out;
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undoHeight)));
-
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undoHeight)));
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, j, false), prevout.nValue));
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, j), CAddressUnspentValue()));
-                    } else {
-                        continue;
-                    }
-                }
-
             }
         }
     }
@@ -1752,24 +1691,6 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    if (fSpentIndex) {
-        if (!pblocktree->UpdateSpentIndex(spentIndex)) {
-            AbortNode("Failed to delete spent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-
-    if (fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            AbortNode("Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            AbortNode("Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-
     pspecialdb->WriteBestBlock(pindex->pprev->GetBlockHash());
 
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
@@ -1836,6 +1757,92 @@ void ThreadScriptCheck(int worker_num) {
     scriptcheckqueue.Thread();
 }
 
+/**
+ * Closure reading one coin from a view on a coin prefetch thread. Read errors are not reported here: the coin is then
+ * left spent and fetched again (and the error handled) when the block is connected.
+ */
+class CCoinPrefetch
+{
+private:
+    const CCoinsView* pview;
+    const COutPoint* poutpoint;
+    Coin* pcoin;
+
+public:
+    CCoinPrefetch() : pview(nullptr), poutpoint(nullptr), pcoin(nullptr) {}
+    CCoinPrefetch(const CCoinsView& view, const COutPoint& outpoint, Coin& coin) :
+        pview(&view), poutpoint(&outpoint), pcoin(&coin) {}
+
+    bool operator()()
+    {
+        try {
+            if (!pview->GetCoin(*poutpoint, *pcoin)) {
+                pcoin->Clear();
+            }
+        } catch (const std::exception&) {
+            pcoin->Clear();
+        }
+        return true;
+    }
+
+    void swap(CCoinPrefetch& check)
+    {
+        std::swap(pview, check.pview);
+        std::swap(poutpoint, check.poutpoint);
+        std::swap(pcoin, check.pcoin);
+    }
+};
+
+static CCheckQueue<CCoinPrefetch> coinprefetchqueue(128);
+
+void ThreadCoinPrefetch(int worker_num) {
+    util::ThreadRename(strprintf("coinpf.%i", worker_num));
+    coinprefetchqueue.Thread();
+}
+
+void PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& base)
+{
+    if (!nCoinPrefetchThreads) {
+        return;
+    }
+
+    std::unordered_set<uint256, StaticSaltedHasher> setBlockTxids;
+    setBlockTxids.reserve(block.vtx.size());
+    std::vector<COutPoint> vOutPoints;
+    for (const CTransactionRef& tx : block.vtx) {
+        setBlockTxids.emplace(tx->GetHash());
+        if (tx->IsCoinBase()) {
+            continue;
+        }
+        for (const CTxIn& txin : tx->vin) {
+            if (!setBlockTxids.count(txin.prevout.hash) && !cache.HaveCoinInCache(txin.prevout)) {
+                vOutPoints.emplace_back(txin.prevout);
+            }
+        }
+    }
+
+    // Not worth waking up the worker threads, the coins are fetched lazily while connecting the block
+    if (vOutPoints.size() < MIN_PARALLEL_PREFETCH_INPUTS) {
+        return;
+    }
+
+    std::vector<Coin> vCoins(vOutPoints.size());
+    std::vector<CCoinPrefetch> vChecks;
+    vChecks.reserve(vOutPoints.size());
+    for (size_t i = 0; i < vOutPoints.size(); i++) {
+        vChecks.emplace_back(base, vOutPoints[i], vCoins[i]);
+    }
+    {
+        CCheckQueueControl<CCoinPrefetch> control(&coinprefetchqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    for (size_t i = 0; i < vOutPoints.size(); i++) {
+        cache.AddPrefetchedCoin(vOutPoints[i], std::move(vCoins[i]));
+    }
+}
+
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params)
@@ -2014,7 +2021,8 @@ bool CChainState::PoSContextualBlockChecks(const CBlock& block, CValidationState
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck)
+                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck,
+                  CCheckQueueControl<CScriptCheck>* pcontrol, std::vector<PrecomputedTransactionData>* ptxdata)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -2213,7 +2221,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     CBlockUndo blockundo;
 
-    CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads && !pcontrol ? &scriptcheckqueue : nullptr);
+    CCheckQueueControl<CScriptCheck>& checks = pcontrol ? *pcontrol : control;
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
@@ -2222,16 +2231,16 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     int nInputs = 0;
     int64_t nSigOpsCost = 0;
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
-    std::vector<PrecomputedTransactionData> txdata;
+    // Checks left to the caller in pcontrol may still run after returning, so their data is owned by the caller
+    assert(!pcontrol == !ptxdata);
+    std::vector<PrecomputedTransactionData> txdataLocal;
+    std::vector<PrecomputedTransactionData>& txdata = ptxdata ? *ptxdata : txdataLocal;
+    assert(txdata.empty());
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
-        const uint256 txhash = tx.GetHash();
         nInputs += tx.vin.size();
 
         if (!tx.IsCoinBase())
@@ -2267,47 +2276,6 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                 return state.Invalid(ValidationInvalidReason::CONSENSUS, error("%s: contains a non-BIP68-final transaction", __func__),
                                  REJECT_INVALID, "bad-txns-nonfinal");
             }
-
-            if (fAddressIndex || fSpentIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-                    const CTxIn input = tx.vin[j];
-                    const Coin& coin = view.AccessCoin(tx.vin[j].prevout);
-                    const CTxOut &prevout = coin.out;
-                    uint160 hashBytes;
-                    int addressType;
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        hashBytes = Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1);
-                        addressType = 1;
-                    } else {
-                        hashBytes.SetNull();
-                        addressType = 0;
-                    }
-
-                    if (fAddressIndex && addressType > 0) {
-                        // record spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
-
-                        // remove address from unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                    }
-
-                    if (fSpentIndex) {
-                        // add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
-                    }
-                }
-
-            }
-
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -2341,45 +2309,12 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                 return error("ConnectBlock(): CheckInputs on %s failed with %s",
                     tx.GetHash().ToString(), FormatStateMessage(state));
             }
-            control.Add(vChecks);
+            checks.Add(vChecks);
         }
 
         if (tx.IsCoinStake() || tx.IsCoinBase())
             nValueOut += tx.GetValueOut();
 
-        if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, txhash, k, false), out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                } else {
-                    continue;
-                }
-
-            }
-        }
-
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
@@ -2396,7 +2331,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                                block.vtx[0]->GetValueOut(), blockReward),
                                REJECT_INVALID, "bad-cb-amount");
 
-    if (!control.Wait())
+    // The caller joins the checks added to pcontrol
+    if (!pcontrol && !control.Wait())
         return state.Invalid(ValidationInvalidReason::CONSENSUS, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
     LogPrint(BCLog::BENCHMARK, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
@@ -2478,7 +2414,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     if (!WriteUndoDataForBlock(blockundo, state, pindex, chainparams))
         return false;
 
-    if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
+    if (!pcontrol && !pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
         pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
         setDirtyBlockIndex.insert(pindex);
     }
@@ -2489,24 +2425,6 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     if (!WriteTxIndexDataForBlock(block, state, pindex))
         return false;
 
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-    }
-
-    if (fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
-
-    if (fTimestampIndex)
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
     assert(pindex->phashBlock);
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
@@ -2601,9 +2519,13 @@ bool CChainState::FlushStateToDisk(
                     return AbortNode(state, "Failed to write to block index database");
                 }
             }
-            // Finally remove any pruned files
-            if (fFlushForPrune)
+            // Finally remove any pruned files. A pending coins write may need their blocks to be replayed after a crash.
+            if (fFlushForPrune) {
+                if (pcoinsflusher && !pcoinsflusher->Sync()) {
+                    return AbortNode(state, "Failed to write to coin database");
+                }
                 UnlinkPrunedFiles(setFilesToPrune);
+            }
             nLastWrite = nNow;
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -2616,9 +2538,12 @@ bool CChainState::FlushStateToDisk(
             if (!CheckDiskSpace(GetDataDir(), 48 * 2 * 2 * pcoinsTip->GetCacheSize())) {
                 return AbortNode(state, "Disk space is too low!", _("Error: Disk space is too low!").translated, CClientUIInterface::MSG_NOPREFIX);
             }
-            // Flush the chainstate (which may refer to block index entries).
+            // Flush the chainstate (which may refer to block index entries). Unless the flush is forced, the coins are
+            // written in the background.
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            if (mode == FlushStateMode::ALWAYS && pcoinsflusher && !pcoinsflusher->Sync())
+                return AbortNode(state, "Failed to write to coin database");
             if (!pspecialdb->CommitRootTransaction())
                 return AbortNode(state, "Failed to commit specialDB");
             nLastFlush = nNow;
@@ -2670,15 +2595,24 @@ static void AppendWarning(std::string& res, const std::string& warn)
     res += warn;
 }
 
-/** Check warning conditions and do some notifications on new chain tip set. */
-void static UpdateTip(const CBlockIndex *pindexNew, const CChainParams& chainParams) {
+/** Wake up the threads waiting for a new best block, e.g. the waitfornewblock RPC. */
+static void PublishBestBlock(const CBlockIndex* pindexNew)
+{
+    LOCK(g_best_block_mutex);
+    g_best_block = pindexNew->GetBlockHash();
+    g_best_block_cv.notify_all();
+}
+
+/**
+ * Check warning conditions and do some notifications on new chain tip set. The tip is not published as the best
+ * block if fPublish is false, which the caller must then do with PublishBestBlock.
+ */
+void static UpdateTip(const CBlockIndex *pindexNew, const CChainParams& chainParams, bool fPublish = true) {
     // New best block
     mempool.AddTransactionsUpdated(1);
 
-    {
-        LOCK(g_best_block_mutex);
-        g_best_block = pindexNew->GetBlockHash();
-        g_best_block_cv.notify_all();
+    if (fPublish) {
+        PublishBestBlock(pindexNew);
     }
 
     std::string warningMessages;
@@ -2730,7 +2664,7 @@ void static UpdateTip(const CBlockIndex *pindexNew, const CChainParams& chainPar
   * disconnectpool (note that the caller is responsible for mempool consistency
   * in any case).
   */
-bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& chainparams, DisconnectedBlockTransactions *disconnectpool)
+bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& chainparams, DisconnectedBlockTransactions *disconnectpool, bool fNotify)
 {
     CBlockIndex *pindexDelete = m_chain.Tip();
     assert(pindexDelete);
@@ -2772,6 +2706,9 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
     m_chain.SetTip(pindexDelete->pprev);
 
     UpdateTip(pindexDelete->pprev, chainparams);
+    if (!fNotify) {
+        return true;
+    }
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
     GetMainSignals().BlockDisconnected(pblock);
@@ -2851,13 +2788,110 @@ public:
     }
 };
 
+/**
+ * Script checks of the blocks connected in a row during initial block download, which are joined one block late: the
+ * checks of a block keep running on the script check threads while the next block is connected on top of it, and its
+ * verdict is only joined once the checks of the next block were queued behind them. This keeps the workers busy across
+ * block boundaries, which matters for the many small blocks of a proof-of-stake chain.
+ *
+ * Until its verdict is joined, the pending block is connected to pcoinsTip and m_chain, but it is not announced nor
+ * published as g_best_block, its transactions stay in the mempool and the chain state is not written to disk. As
+ * ActivateBestChainStep joins it before releasing cs_main, a pending block whose scripts turn out to be invalid can be
+ * disconnected again without anyone having seen it.
+ */
+class ScriptCheckPipeline
+{
+public:
+    //! The connected block whose script checks are pending, if any
+    CBlockIndex* pindex{nullptr};
+    //! The pending block and the precomputed data of its transactions, which its script checks refer to
+    std::shared_ptr<const CBlock> pblock;
+    std::vector<PrecomputedTransactionData> txdata;
+    //! The check group of the pending block
+    unsigned int nGroup{0};
+
+    //! Declared last, so that it is destroyed first, waiting for the checks still referring to pblock and txdata
+    CCheckQueueControl<CScriptCheck> control;
+
+    explicit ScriptCheckPipeline(CCheckQueue<CScriptCheck>* pqueue) : control(pqueue) {}
+};
+
+/**
+ * Join the script checks of the pending block of pipeline, if any. If they passed, the connection of the block is
+ * completed: it is announced and its transactions are removed from the mempool. Returns false if they failed, in
+ * which case the block stays pending, to be disconnected with DisconnectPendingBlock.
+ */
+bool CChainState::JoinPendingBlock(ScriptCheckPipeline& pipeline, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool)
+{
+    if (!pipeline.pindex) {
+        return true;
+    }
+    if (!pipeline.control.Wait(pipeline.nGroup)) {
+        return false;
+    }
+    pipeline.txdata.clear();
+    CBlockIndex* pindex = pipeline.pindex;
+    if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
+        pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+        setDirtyBlockIndex.insert(pindex);
+    }
+    CValidationState state;
+    GetMainSignals().BlockChecked(*pipeline.pblock, state);
+    // Remove conflicting transactions from the mempool.
+    mempool.removeForBlock(pipeline.pblock->vtx, pindex->nHeight);
+    disconnectpool.removeForBlock(pipeline.pblock->vtx);
+    connectTrace.BlockConnected(pindex, std::move(pipeline.pblock));
+    pipeline.pindex = nullptr;
+    // Held back by ConnectTip until now, see ScriptCheckPipeline
+    PublishBestBlock(pindex);
+    return true;
+}
+
+/**
+ * Disconnect the pending block of pipeline, whose script checks failed, from the tip and mark it invalid. The blocks
+ * which were pruned from setBlockIndexCandidates while the pending block was the tip are candidates again.
+ */
+bool CChainState::DisconnectPendingBlock(CValidationState& state, const CChainParams& chainparams, ScriptCheckPipeline& pipeline)
+{
+    CBlockIndex* pindex = pipeline.pindex;
+    std::shared_ptr<const CBlock> pblock = std::move(pipeline.pblock);
+    pipeline.txdata.clear();
+    pipeline.pindex = nullptr;
+    assert(pindex == m_chain.Tip());
+    if (!DisconnectTip(state, chainparams, nullptr, false)) {
+        return AbortNode(state, "Failed to disconnect block; see debug.log for details");
+    }
+    state.Invalid(ValidationInvalidReason::CONSENSUS, error("%s: CheckQueue failed for block %s", __func__, pindex->GetBlockHash().ToString()), REJECT_INVALID, "block-validation-failed");
+    InvalidBlockFound(pindex, state);
+    GetMainSignals().BlockChecked(*pblock, state);
+
+    // The new tip may not be in setBlockIndexCandidates anymore, see InvalidateBlock
+    for (const auto& entry : m_blockman.m_block_index) {
+        CBlockIndex* pindexCandidate = entry.second;
+        if (pindexCandidate->IsValid(BLOCK_VALID_TRANSACTIONS) && pindexCandidate->HaveTxsDownloaded() && !setBlockIndexCandidates.value_comp()(pindexCandidate, m_chain.Tip())) {
+            setBlockIndexCandidates.insert(pindexCandidate);
+        }
+    }
+    return false;
+}
+
+/** Join the pending block of pipeline and write the chain state to disk if needed, now that all its blocks are verified. */
+bool CChainState::FinishScriptCheckPipeline(CValidationState& state, const CChainParams& chainparams, ScriptCheckPipeline& pipeline, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool)
+{
+    if (!JoinPendingBlock(pipeline, connectTrace, disconnectpool)) {
+        return DisconnectPendingBlock(state, chainparams, pipeline);
+    }
+    return FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED);
+}
+
 /**
  * Connect a new block to m_chain. pblock is either nullptr or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
  *
- * The block is added to connectTrace if connection succeeds.
+ * The block is added to connectTrace if connection succeeds. If pipeline is given, the
+ * script checks of the block are left pending in it instead, see ScriptCheckPipeline.
  */
-bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions &disconnectpool)
+bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions &disconnectpool, ScriptCheckPipeline* pipeline)
 {
     assert(pindexNew->pprev == m_chain.Tip());
     // Read block from disk.
@@ -2865,8 +2899,13 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     std::shared_ptr<const CBlock> pthisBlock;
     if (!pblock) {
         std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
+        if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus())) {
+            // Don't leave a block with unverified scripts connected behind
+            if (pipeline && !JoinPendingBlock(*pipeline, connectTrace, disconnectpool)) {
+                DisconnectPendingBlock(state, chainparams, *pipeline);
+            }
             return AbortNode(state, "Failed to read block");
+        }
         pthisBlock = pblockNew;
     } else {
         pthisBlock = pblock;
@@ -2876,41 +2915,71 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCHMARK, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    bool fPendingValid = true;
     {
         auto dbTx = pspecialdb->BeginTransaction();
+        PrefetchBlockInputs(blockConnecting, *pcoinsTip, pcoinsflusher ? static_cast<const CCoinsView&>(*pcoinsflusher) : *pcoinsdbview);
         CCoinsViewCache view(pcoinsTip.get());
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
-        GetMainSignals().BlockChecked(blockConnecting, state);
-        if (!rv) {
-            if (state.IsInvalid())
-                InvalidBlockFound(pindexNew, state);
-            return error("%s: ConnectBlock %s failed, %s", __func__, pindexNew->GetBlockHash().ToString(), FormatStateMessage(state));
-        }
-        nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
-        LogPrint(BCLog::BENCHMARK, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
-        bool flushed = view.Flush();
-        assert(flushed);
-        dbTx->Commit();
+        std::vector<PrecomputedTransactionData> txdata;
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, pipeline ? &pipeline->control : nullptr, pipeline ? &txdata : nullptr);
+        if (pipeline) {
+            // The checks of this block are queued behind the ones of the pending block, join the latter now. If it
+            // turns out to be invalid, this block is dropped before it is applied.
+            const unsigned int nGroup = pipeline->control.EndGroup();
+            fPendingValid = JoinPendingBlock(*pipeline, connectTrace, disconnectpool);
+            if (rv && fPendingValid) {
+                pipeline->pindex = pindexNew;
+                pipeline->pblock = pthisBlock;
+                // Moving keeps the elements in place, so the queued checks can keep pointing into it
+                pipeline->txdata = std::move(txdata);
+                pipeline->nGroup = nGroup;
+            } else {
+                pipeline->control.Wait(nGroup);
+            }
+        }
+        if (fPendingValid) {
+            // A pending block is announced as checked once its scripts are verified
+            if (!pipeline || !rv)
+                GetMainSignals().BlockChecked(blockConnecting, state);
+            if (!rv) {
+                if (state.IsInvalid())
+                    InvalidBlockFound(pindexNew, state);
+                return error("%s: ConnectBlock %s failed, %s", __func__, pindexNew->GetBlockHash().ToString(), FormatStateMessage(state));
+            }
+            nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
+            LogPrint(BCLog::BENCHMARK, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
+            bool flushed = view.Flush();
+            assert(flushed);
+            dbTx->Commit();
+        }
+    }
+    if (!fPendingValid) {
+        // The block this one was connected on top of has invalid scripts, this block was dropped without being applied
+        return DisconnectPendingBlock(state, chainparams, *pipeline);
     }
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
     LogPrint(BCLog::BENCHMARK, "  - Flush: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime4 - nTime3) * MILLI, nTimeFlush * MICRO, nTimeFlush * MILLI / nBlocksTotal);
-    // Write the chain state to disk, if necessary.
-    if (!FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED))
+    // Write the chain state to disk, if necessary. A pending block is not written before its scripts are verified.
+    if (!pipeline && !FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED))
         return false;
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
     LogPrint(BCLog::BENCHMARK, "  - Writing chainstate: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime5 - nTime4) * MILLI, nTimeChainState * MICRO, nTimeChainState * MILLI / nBlocksTotal);
-    // Remove conflicting transactions from the mempool.;
-    mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
-    disconnectpool.removeForBlock(blockConnecting.vtx);
+    if (!pipeline) {
+        // Remove conflicting transactions from the mempool.;
+        mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
+        disconnectpool.removeForBlock(blockConnecting.vtx);
+    }
     // Update m_chain & related variables.
     m_chain.SetTip(pindexNew);
-    UpdateTip(pindexNew, chainparams);
+    UpdateTip(pindexNew, chainparams, !pipeline);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
     LogPrint(BCLog::BENCHMARK, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCHMARK, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
 
-    connectTrace.BlockConnected(pindexNew, std::move(pthisBlock));
+    if (!pipeline) {
+        connectTrace.BlockConnected(pindexNew, std::move(pthisBlock));
+    }
     return true;
 }
 
@@ -3060,6 +3129,12 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
         fBlocksDisconnected = true;
     }
 
+    // During initial block download, the script checks of each block overlap with connecting the next one.
+    std::unique_ptr<ScriptCheckPipeline> pipeline;
+    if (nScriptCheckThreads && IsInitialBlockDownload()) {
+        pipeline = MakeUnique<ScriptCheckPipeline>(&scriptcheckqueue);
+    }
+
     // Build list of new blocks to connect.
     std::vector<CBlockIndex*> vpindexToConnect;
     bool fContinue = true;
@@ -3079,7 +3154,12 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
 
         // Connect new blocks.
         for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
-            if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
+            bool fConnected = ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool, pipeline.get());
+            if (fConnected && pipeline && (pindexConnect == vpindexToConnect.front() || pcoinsTip->DynamicMemoryUsage() > nCoinCacheUsage)) {
+                // Join the last block of the batch, or write the chain state before the cache grows any further.
+                fConnected = FinishScriptCheckPipeline(state, chainparams, *pipeline, connectTrace, disconnectpool);
+            }
+            if (!fConnected) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
                     if (state.GetReason() != ValidationInvalidReason::BLOCK_MUTATED) {
@@ -3098,7 +3178,7 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
                 }
             } else {
                 PruneBlockIndexCandidates();
-                if (!pindexOldTip || m_chain.Tip()->nChainWork > pindexOldTip->nChainWork) {
+                if ((!pindexOldTip || m_chain.Tip()->nChainWork > pindexOldTip->nChainWork) && !(pipeline && pipeline->pindex)) {
                     // We're in a better position than we were. Return temporarily to release the lock.
                     fContinue = false;
                     break;
@@ -3107,6 +3187,9 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
         }
     }
 
+    // No block with unverified scripts is left connected once cs_main is released
+    assert(!pipeline || !pipeline->pindex);
+
     if (fBlocksDisconnected) {
         // If any blocks were disconnected, disconnectpool may be non empty.  Add
         // any disconnected transactions back to the mempool.
@@ -3426,11 +3509,15 @@ void ResetBlockFailureFlags(CBlockIndex *pindex) {
 }
 
 CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block, bool fProofOfStake, enum BlockStatus nStatus)
+{
+    return AddToBlockIndex(block, block.GetHash(), fProofOfStake, nStatus);
+}
+
+CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block, const uint256& hash, bool fProofOfStake, enum BlockStatus nStatus)
 {
     AssertLockHeld(cs_main);
 
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator it = m_block_index.find(hash);
     if (it != m_block_index.end())
         return it->second;
@@ -3928,10 +4015,14 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
 }
 
 bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fProofOfStake)
+{
+    return AcceptBlockHeader(block, block.GetHash(), state, chainparams, ppindex, fProofOfStake);
+}
+
+bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fProofOfStake)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = m_block_index.find(hash);
     CBlockIndex *pindex = nullptr;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
@@ -3969,7 +4060,7 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState
 
         if (llmq::chainLocksHandler->HasConflictingChainLock(pindexPrev->nHeight + 1, hash)) {
             if (pindex == nullptr)
-                AddToBlockIndex(block, block.nNonce == 0, BLOCK_CONFLICT_CHAINLOCK);
+                AddToBlockIndex(block, hash, block.nNonce == 0, BLOCK_CONFLICT_CHAINLOCK);
             return state.Invalid(ValidationInvalidReason::CONSENSUS, error("%s: header %s conflicts with chainlock", __func__, hash.ToString()), REJECT_INVALID, "bad-chainlock");
         }
 
@@ -4012,7 +4103,7 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState
         }
     }
     if (pindex == nullptr)
-        pindex = AddToBlockIndex(block, fProofOfStake);
+        pindex = AddToBlockIndex(block, hash, fProofOfStake);
 
     if (ppindex)
         *ppindex = pindex;
@@ -4023,25 +4114,48 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState
     return true;
 }
 
+void GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers, std::vector<uint256>& hashes)
+{
+    hashes.resize(headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        hashes[i] = headers[i].GetHash();
+    }
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
+    std::vector<uint256> hashes;
+    GetBlockHeaderHashes(headers, hashes);
+    return ProcessNewBlockHeaders(headers, hashes, state, chainparams, ppindex, first_invalid);
+}
+
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, const std::vector<uint256>& hashes, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
+{
+    assert(hashes.size() == headers.size());
     if (first_invalid != nullptr) first_invalid->SetNull();
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
-            CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            bool accepted = g_blockman.AcceptBlockHeader(header, state, chainparams, &pindex, header.nFlags & CBlockIndex::BLOCK_PROOF_OF_STAKE);
-            ::ChainstateActive().CheckBlockIndex(chainparams.GetConsensus());
+        // Insert the whole batch without rehashing the block index in between
+        g_blockman.m_block_index.reserve(g_blockman.m_block_index.size() + headers.size());
 
+        bool accepted = true;
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
+            CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
+            accepted = g_blockman.AcceptBlockHeader(header, hashes[i], state, chainparams, &pindex, header.nFlags & CBlockIndex::BLOCK_PROOF_OF_STAKE);
             if (!accepted) {
                 if (first_invalid) *first_invalid = header;
-                return false;
+                break;
             }
             if (ppindex) {
                 *ppindex = pindex;
             }
         }
+        ::ChainstateActive().CheckBlockIndex(chainparams.GetConsensus());
+        if (!accepted) {
+            return false;
+        }
     }
     NotifyHeaderTip();
     return true;
@@ -4573,17 +4687,10 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_RE
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("%s: transaction index %s\n", __func__, "enabled");
 
-    // Check whether we have an address index
-    pblocktree->ReadFlag("addressindex", fAddressIndex);
-    LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
-
-    // Check whether we have a timestamp index
-    pblocktree->ReadFlag("timestampindex", fTimestampIndex);
-    LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
-
-    // Check whether we have a spent index
-    pblocktree->ReadFlag("spentindex", fSpentIndex);
-    LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
+    // The address, timestamp and spent indexes have their own databases now and are rebuilt by the index threads
+    if (!pblocktree->EraseLegacyIndexes()) {
+        return false;
+    }
 
     return true;
 }
@@ -5013,18 +5120,6 @@ bool LoadBlockIndex(const CChainParams& chainparams)
 
         // Use the provided setting for -txindex in the new database
         pblocktree->WriteFlag("txindex", true);
-
-        // Use the provided setting for -addressindex in the new database
-        fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
-        pblocktree->WriteFlag("addressindex", fAddressIndex);
-
-        // Use the provided setting for -timestampindex in the new database
-        fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
-        pblocktree->WriteFlag("timestampindex", fTimestampIndex);
-
-        // Use the provided setting for -spentindex in the new database
-        fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
-        pblocktree->WriteFlag("spentindex", fSpentIndex);
     }
     return true;
 }
@@ -37,6 +37,7 @@ class CBlockIndex;
 class CBlockTreeDB;
 class CBlockUndo;
 class CChainParams;
+class CCoinsViewBackgroundFlush;
 class CCoinsViewDB;
 class CInv;
 class CConnman;
@@ -85,6 +86,12 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of coin prefetch threads allowed */
+static const int MAX_PREFETCH_THREADS = 16;
+/** -prefetchthreads default (number of threads reading the spent coins of a block before it is connected) */
+static const int DEFAULT_PREFETCH_THREADS = 4;
+/** Minimum number of inputs of a block to read their coins on the coin prefetch threads */
+static const unsigned int MIN_PARALLEL_PREFETCH_INPUTS = 16;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 128;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -158,6 +165,7 @@ extern uint256 g_best_block;
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
 extern int nScriptCheckThreads;
+extern int nCoinPrefetchThreads;
 extern bool fTxIndex;
 extern bool fAddressIndex;
 extern bool fTimestampIndex;
@@ -241,6 +249,14 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
  */
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& block, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex = nullptr, CBlockHeader* first_invalid = nullptr) LOCKS_EXCLUDED(cs_main);
 
+/**
+ * Same as above, but with the header hashes already known, e.g. because the caller needed them as well.
+ */
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, const std::vector<uint256>& hashes, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex = nullptr, CBlockHeader* first_invalid = nullptr) LOCKS_EXCLUDED(cs_main);
+
+/** Fill hashes with the hashes of a batch of headers, so that they don't have to be computed while holding cs_main. */
+void GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers, std::vector<uint256>& hashes);
+
 /** Open a block file (blk?????.dat) */
 FILE* OpenBlockFile(const FlatFilePos &pos, bool fReadOnly = false);
 /** Translation to a filesystem path */
@@ -258,6 +274,14 @@ bool LoadChainTip(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_m
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck(int worker_num);
+/** Run an instance of the coin prefetching thread */
+void ThreadCoinPrefetch(int worker_num);
+/**
+ * Read the coins spent by a block which are not in cache yet from base, the view below cache, on the coin prefetch
+ * threads and add them to cache. Inputs which spend outputs of the same block are skipped. base must be safe to read
+ * from several threads at once and must not be modified while this runs.
+ */
+void PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& base);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256& hash, CTransactionRef& tx, const Consensus::Params& params, uint256& hashBlock, const CBlockIndex* const blockIndex = nullptr);
 /**
@@ -379,6 +403,7 @@ bool GetAddressIndex(uint160 addressHash, int type,
                      int start = 0, int end = 0);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value);
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
@@ -442,6 +467,9 @@ enum DisconnectResult
 };
 
 class ConnectTrace;
+class ScriptCheckPipeline;
+template <typename T>
+class CCheckQueueControl;
 
 /** @see CChainState::FlushStateToDisk */
 enum class FlushStateMode {
@@ -512,6 +540,7 @@ public:
     void Unload() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     CBlockIndex* AddToBlockIndex(const CBlockHeader& block, bool fProofOfStake, enum BlockStatus nStatus = BLOCK_VALID_TREE) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    CBlockIndex* AddToBlockIndex(const CBlockHeader& block, const uint256& hash, bool fProofOfStake, enum BlockStatus nStatus = BLOCK_VALID_TREE) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Create a new block index entry for a given block hash */
     CBlockIndex* InsertBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -525,6 +554,17 @@ public:
         const CChainParams& chainparams,
         CBlockIndex** ppindex,
         bool fProofOfStake) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /**
+     * Same as above with the hash of the header already known.
+     */
+    bool AcceptBlockHeader(
+        const CBlockHeader& block,
+        const uint256& hash,
+        CValidationState& state,
+        const CChainParams& chainparams,
+        CBlockIndex** ppindex,
+        bool fProofOfStake) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 };
 
 /**
@@ -616,11 +656,16 @@ public:
 
     // Block (dis)connection on a given view:
     DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view);
+    /**
+     * If pcontrol is given, the script checks are added to it instead of being waited for, and the caller must raise the block to BLOCK_VALID_SCRIPTS once they passed.
+     * The checks then refer to the precomputed data of the transactions stored in *ptxdata, which must be empty and kept alive (or moved) until they are joined.
+     */
     bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                      CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+                      CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false,
+                      CCheckQueueControl<CScriptCheck>* pcontrol = nullptr, std::vector<PrecomputedTransactionData>* ptxdata = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
-    // Block disconnection on our pcoinsTip:
-    bool DisconnectTip(CValidationState& state, const CChainParams& chainparams, DisconnectedBlockTransactions* disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
+    // Block disconnection on our pcoinsTip (fNotify=false for a block whose connection wasn't announced yet):
+    bool DisconnectTip(CValidationState& state, const CChainParams& chainparams, DisconnectedBlockTransactions* disconnectpool, bool fNotify = true) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
 
     // Manual block validity manipulation:
     bool PreciousBlock(CValidationState& state, const CChainParams& params, CBlockIndex* pindex) LOCKS_EXCLUDED(cs_main);
@@ -647,7 +692,10 @@ public:
 
 private:
     bool ActivateBestChainStep(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
-    bool ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
+    bool ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool, ScriptCheckPipeline* pipeline = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
+    bool JoinPendingBlock(ScriptCheckPipeline& pipeline, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
+    bool DisconnectPendingBlock(CValidationState& state, const CChainParams& chainparams, ScriptCheckPipeline& pipeline) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
+    bool FinishScriptCheckPipeline(CValidationState& state, const CChainParams& chainparams, ScriptCheckPipeline& pipeline, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, ::mempool.cs);
 
     void InvalidBlockFound(CBlockIndex *pindex, const CValidationState &state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     CBlockIndex* FindMostWorkChain() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -689,6 +737,9 @@ PrevBlockMap& PrevBlockIndex();
 /** Global variable that points to the coins database (protected by cs_main) */
 extern std::unique_ptr<CCoinsViewDB> pcoinsdbview;
 
+/** Global variable that points to the view writing flushes of pcoinsTip to pcoinsdbview in the background (protected by cs_main). May be null. */
+extern std::unique_ptr<CCoinsViewBackgroundFlush> pcoinsflusher;
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern std::unique_ptr<CCoinsViewCache> pcoinsTip;
 
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+# Copyright (c) 2020 The BitGreen Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the paging of the address index RPCs.
+
+Pages requested with limit and cursor must add up to the unpaged result,
+also when a page ends in the middle of the entries of an address.
+"""
+
+from test_framework.test_framework import BitGreenTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+)
+
+
+class AddressIndexTest(BitGreenTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        self.extra_args = [['-addressindex']]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def get_pages(self, method, key, request, limit):
+        entries = []
+        cursor = None
+        while True:
+            params = dict(request, limit=limit)
+            if cursor is not None:
+                params['cursor'] = cursor
+            page = method(params)
+            assert len(page[key]) <= limit
+            entries += page[key]
+            if 'cursor' not in page:
+                return entries
+            assert_equal(len(page[key]), limit)
+            cursor = page['cursor']
+
+    def run_test(self):
+        node = self.nodes[0]
+        address1 = node.getnewaddress('', 'legacy')
+        address2 = node.getnewaddress('', 'legacy')
+        node.generatetoaddress(3, address1)
+        node.generatetoaddress(4, address2)
+        request = {'addresses': [address1, address2]}
+
+        self.log.info("Test that pages add up to the unpaged result across two addresses")
+        deltas = node.getaddressdeltas(request)
+        assert_equal(len(deltas), 7)
+        assert_equal([d['address'] for d in deltas], [address1] * 3 + [address2] * 4)
+        for limit in [1, 2, 3, 7, 100]:
+            assert_equal(self.get_pages(node.getaddressdeltas, 'deltas', request, limit), deltas)
+
+        txids = node.getaddresstxids(request)
+        assert_equal(len(txids), 7)
+        for limit in [1, 2, 5]:
+            assert_equal(sorted(self.get_pages(node.getaddresstxids, 'txids', request, limit)), sorted(txids))
+
+        def outpoints(utxos):
+            return sorted((u['txid'], u['outputIndex']) for u in utxos)
+        utxos = node.getaddressutxos(request)
+        assert_equal(len(utxos), 7)
+        for limit in [2, 4]:
+            assert_equal(outpoints(self.get_pages(node.getaddressutxos, 'utxos', request, limit)), outpoints(utxos))
+
+        self.log.info("Test that a cursor only resumes the request it was returned for")
+        cursor = node.getaddressdeltas(dict(request, limit=2))['cursor']
+        assert_raises_rpc_error(-8, "Cursor does not match the requested addresses", node.getaddressdeltas, {'addresses': [address2, address1], 'cursor': cursor})
+        assert_raises_rpc_error(-8, "Invalid cursor", node.getaddressdeltas, dict(request, cursor='zz'))
+        assert_raises_rpc_error(-8, "Limit is expected to be greater than 0", node.getaddressdeltas, dict(request, limit=0))
+
+
+if __name__ == '__main__':
+    AddressIndexTest().main()
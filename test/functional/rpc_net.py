@@ -31,6 +31,7 @@ class NetTest(BitGreenTestFramework):
     def run_test(self):
         self._test_connection_count()
         self._test_getnettotals()
+        self._test_getnetmsgstats()
         self._test_getnetworkinginfo()
         self._test_getaddednodeinfo()
         self._test_getpeerinfo()
@@ -70,6 +71,21 @@ class NetTest(BitGreenTestFramework):
             assert_greater_than_or_equal(after['bytesrecv_per_msg'].get('pong', 0), before['bytesrecv_per_msg'].get('pong', 0) + 32)
             assert_greater_than_or_equal(after['bytessent_per_msg'].get('ping', 0), before['bytessent_per_msg'].get('ping', 0) + 32)
 
+    def _test_getnetmsgstats(self):
+        # the version handshake was done with both peers
+        stats = self.nodes[0].getnetmsgstats()
+        assert_greater_than_or_equal(stats['version']['recv_msgs'], 2)
+        assert_greater_than_or_equal(stats['version']['sent_msgs'], 2)
+        assert_equal(stats['version']['process_time']['count'], stats['version']['recv_msgs'])
+
+        before = self.nodes[0].getnetmsgstats('pong')['pong']
+        self.nodes[0].ping()
+        wait_until(lambda: self.nodes[0].getnetmsgstats('pong')['pong']['recv_msgs'] >= before['recv_msgs'] + 2, timeout=1)
+        after = self.nodes[0].getnetmsgstats('pong')['pong']
+        assert_greater_than_or_equal(after['recv_bytes'], before['recv_bytes'] + 32 * 2)
+        assert_equal(sum(after['process_time']['buckets'].values()), after['process_time']['count'])
+        assert_raises_rpc_error(-8, "Unknown message type", self.nodes[0].getnetmsgstats, 'foo')
+
     def _test_getnetworkinginfo(self):
         assert_equal(self.nodes[0].getnetworkinfo()['networkactive'], True)
         assert_equal(self.nodes[0].getnetworkinfo()['connections'], 2)